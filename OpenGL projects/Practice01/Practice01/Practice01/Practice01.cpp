@@ -1,6 +1,7 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
+#include "PerfHUD.h"
 
 const char* vertexShaderSource = "#version 330 core\n"
 "layout (location = 0) in vec3 aPos;\n"
@@ -19,6 +20,9 @@ const char* fragmentShaderSource = "#version 330 core\n"
 //----input forward declaration
 void processInput(GLFWwindow* window);
 
+//----performance overlay, F3 shows and hides it
+PerfHUD perfHUD;
+
 int main() {
 
     //----initialize glfw library and set contexts
@@ -136,6 +140,8 @@ int main() {
         1, 2, 3    // second triangle
     };
 
+    const GLsizei indexCount = sizeof(indices) / sizeof(indices[0]);
+
     unsigned int VBO, VAO, EBO;
 
     //----Create the vertex buffer object
@@ -164,9 +170,12 @@ int main() {
 
 
 
+    perfHUD.init();
+
     //----MAIN RENDER LOOP
     while (!glfwWindowShouldClose(window))
     {
+        perfHUD.beginFrame();
         processInput(window);
 
         glUseProgram(shaderProgram);
@@ -177,15 +186,28 @@ int main() {
         //----Clear the viewport
         glClear(GL_COLOR_BUFFER_BIT);
 
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        //----count the draws as they are issued
+        HUDCounters hudCounters;
+        hudCounters.drawCalls = 0;
+        hudCounters.triangles = 0;
+
+        glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+        hudCounters.drawCalls++;
+        hudCounters.triangles += indexCount / 3;
         glBindVertexArray(0);
 
+        perfHUD.setCounters(hudCounters);
+        int framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        perfHUD.render(framebufferWidth, framebufferHeight);
+
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
 
     //exit
+    perfHUD.destroy();
     glfwTerminate();
     return 0;
 }
@@ -202,4 +224,6 @@ void processInput(GLFWwindow* window)
 {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
+
+    perfHUD.handleToggleKey(glfwGetKey(window, GLFW_KEY_F3) == GLFW_PRESS);
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
+#include "PerfHUD.h"
 
 const char* vertexShaderSource = "#version 330 core\n"
 "layout (location = 0) in vec3 aPos;\n"
@@ -23,6 +24,9 @@ const char* fragmentShaderSource = "#version 330 core\n"
 //----input forward declaration
 void processInput(GLFWwindow* window);
 
+//----performance overlay, F3 shows and hides it
+PerfHUD perfHUD;
+
 int main() {
 
     //----initialize glfw library and set contexts
@@ -141,6 +145,8 @@ int main() {
         1, 2, 3    // second triangle
     };
 
+    const GLsizei indexCount = sizeof(indices) / sizeof(indices[0]);
+
     unsigned int VBO, VAO, EBO;
 
     //----Create the vertex buffer object
@@ -171,9 +177,12 @@ int main() {
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
     glEnableVertexAttribArray(1);
 
+    perfHUD.init();
+
     //----MAIN RENDER LOOP
     while (!glfwWindowShouldClose(window))
     {
+        perfHUD.beginFrame();
         processInput(window);
 
         //----Define the color of the viewport when cleared
@@ -184,15 +193,28 @@ int main() {
         glUseProgram(shaderProgram);
         glBindVertexArray(VAO);
 
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        //----count the draws as they are issued
+        HUDCounters hudCounters;
+        hudCounters.drawCalls = 0;
+        hudCounters.triangles = 0;
+
+        glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+        hudCounters.drawCalls++;
+        hudCounters.triangles += indexCount / 3;
         glBindVertexArray(0);
 
+        perfHUD.setCounters(hudCounters);
+        int framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        perfHUD.render(framebufferWidth, framebufferHeight);
+
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
 
     //exit
+    perfHUD.destroy();
     glfwTerminate();
     return 0;
 }
@@ -209,4 +231,6 @@ void processInput(GLFWwindow* window)
 {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
+
+    perfHUD.handleToggleKey(glfwGetKey(window, GLFW_KEY_F3) == GLFW_PRESS);
 }
\ No newline at end of file
@@ -0,0 +1,83 @@
+#pragma once
+
+#ifndef FRAME_SCHEDULER_H
+#define FRAME_SCHEDULER_H
+
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+
+
+//Fixed timestep clock for the main loop.
+//
+//Time is read with glfwGetTimerValue and kept as whole timer ticks, so nothing drifts or loses
+//precision however long the app runs. Each frame, beginFrame() returns how many fixed simulation
+//steps are due. The caller runs exactly that many, then renders with getAlpha() to blend between
+//the last two simulated states. When a frame falls too far behind, the backlog is capped at
+//maxStepsPerFrame and the rest is dropped rather than fed back in (the "spiral of death").
+class FrameScheduler {
+
+public:
+
+	//needs glfwInit() to have run
+	FrameScheduler(double stepsPerSecond = 120.0, unsigned int maxStepsPerFrame = 8)
+		: maxSteps(maxStepsPerFrame), accumulator(0), lastTimer(0), stepCount(0), droppedTimer(0) {
+		frequency = glfwGetTimerFrequency();
+		stepLength = (uint64_t)(frequency / stepsPerSecond + 0.5);
+	}
+
+	//call right before the loop so the first frame does not see the whole startup as elapsed time
+	void start() {
+		lastTimer = glfwGetTimerValue();
+		accumulator = 0;
+	}
+
+	//number of fixed steps to simulate this frame
+	unsigned int beginFrame() {
+
+		uint64_t now = glfwGetTimerValue();
+		frameTimer = now - lastTimer;
+		lastTimer = now;
+		accumulator += frameTimer;
+
+		uint64_t limit = stepLength * maxSteps;
+		if (accumulator > limit) {
+			droppedTimer += accumulator - limit;
+			accumulator = limit;
+		}
+
+		unsigned int steps = (unsigned int)(accumulator / stepLength);
+		accumulator -= steps * stepLength;
+		stepCount += steps;
+		return steps;
+	}
+
+	//length of one simulation step, the same every step
+	double getStepSeconds() const { return (double)stepLength / frequency; }
+
+	//how far the present lies between the last simulated state (0) and the next one (1)
+	float getAlpha() const { return (float)((double)accumulator / stepLength); }
+
+	//simulated time since start(), an exact multiple of the step length
+	double getSimulationSeconds() const { return (double)(stepCount * stepLength) / frequency; }
+
+	uint64_t getStepCount() const { return stepCount; }
+
+	//wall clock time of the last frame
+	double getFrameSeconds() const { return (double)frameTimer / frequency; }
+
+	//time thrown away by the backlog cap
+	double getDroppedSeconds() const { return (double)droppedTimer / frequency; }
+
+private:
+
+	unsigned int maxSteps;
+	uint64_t frequency;
+	uint64_t stepLength;  //in timer ticks
+	uint64_t accumulator; //timer ticks not simulated yet
+	uint64_t lastTimer;
+	uint64_t frameTimer = 0;
+	uint64_t stepCount;
+	uint64_t droppedTimer;
+};
+#endif
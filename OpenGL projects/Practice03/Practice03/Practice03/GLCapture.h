@@ -0,0 +1,420 @@
+#pragma once
+
+#ifndef GL_CAPTURE_H
+#define GL_CAPTURE_H
+
+#include <glad/glad.h>
+#include "GLCalls.h"
+
+#include <fstream>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+#include <iostream>
+
+
+//Every GL call a trace can hold. Queries (glGet*) and GPU pacing (fences, timer queries) leave
+//the image as it was and are left out; any other call in GL_ALL_CALLS marks the trace incomplete.
+#define GL_CAPTURED_CALLS(X) \
+	X(Enable) X(Disable) X(Viewport) X(ClearColor) X(Clear) X(DepthFunc) X(DepthMask) X(BlendFunc) X(BlendFuncSeparate) \
+	X(ActiveTexture) X(PixelStorei) \
+	X(GenBuffers) X(DeleteBuffers) X(BindBuffer) X(BufferData) X(BufferSubData) \
+	X(GenVertexArrays) X(DeleteVertexArrays) X(BindVertexArray) X(VertexAttribPointer) X(EnableVertexAttribArray) \
+	X(GenTextures) X(DeleteTextures) X(BindTexture) X(TexParameteri) X(TexImage2D) X(GenerateMipmap) \
+	X(CreateShader) X(ShaderSource) X(CompileShader) X(DeleteShader) \
+	X(CreateProgram) X(AttachShader) X(LinkProgram) X(DeleteProgram) X(UseProgram) \
+	X(GetUniformLocation) X(Uniform1i) X(Uniform1f) X(Uniform2f) X(Uniform3f) X(Uniform4f) X(Uniform3fv) X(UniformMatrix4fv) \
+	X(DrawArrays) X(DrawElements) X(DrawElementsBaseVertex)
+
+enum GLCapturedCall {
+#define GL_CAPTURED_ENUM(name) GL_CAPTURED_##name,
+	GL_CAPTURED_CALLS(GL_CAPTURED_ENUM)
+#undef GL_CAPTURED_ENUM
+	GL_CAPTURED_COUNT,
+	GL_CAPTURED_FRAME = 0xffff //end of frame marker, the app's buffer swap
+};
+
+
+//Records the GL command stream into a binary trace for GLReplay.
+//
+//Like GLInterceptor it swaps glad's function pointers for shims, here ones that call through
+//and then append the call and its arguments to the trace. Arguments are stored as they were
+//passed; what a pointer refers to is stored in full (buffer and texture data, shader sources,
+//uniform arrays), and object names and uniform locations are stored as the app saw them so the
+//replayer can map them onto its own. endFrame() marks the end of a frame.
+//
+//Every other entry point in glad's table gets a shim too, one that only notes the call could not
+//be recorded: the first time each is hit it prints ERROR::CAPTURE::UNRECORDED_CALL, and stop()
+//writes how many there were into the header so GLReplay refuses the trace rather than replaying
+//a frame that is missing something.
+//
+//A trace layout: "GLTRACE", a version, the count of unrecorded calls and the viewport size when
+//the capture started (the window's), then records of a 16 bit call id and its arguments. Integers
+//are little endian at their GL width; pointer sized values are written as 64 bits.
+class GLCapture {
+
+public:
+
+	static const uint32_t VERSION = 3;
+
+	GLCapture() : installed(false), frames(0), calls(0), unrecordedCalls(0), unpackAlignment(4) {}
+
+	//call after gladLoadGLLoader, before the app creates anything it draws with
+	bool start(const char* path);
+	void stop();
+
+	bool isCapturing() const { return installed; }
+
+	//false once the app made a call the trace cannot hold
+	bool isComplete() const { return unrecordedCalls == 0; }
+
+	//what a trace cannot capture without changing the image: queries and GPU pacing
+	static bool isIgnored(GLCall call) {
+		switch (call) {
+		case GL_CALL_FenceSync: case GL_CALL_DeleteSync: case GL_CALL_GenQueries: case GL_CALL_DeleteQueries:
+		case GL_CALL_BeginQuery: case GL_CALL_EndQuery: case GL_CALL_QueryCounter:
+			return true;
+		default:
+			return glCallIsQuery(call);
+		}
+	}
+
+	void endFrame() {
+		if (!installed)
+			return;
+		write((uint16_t)GL_CAPTURED_FRAME);
+		frames++;
+	}
+
+	//----used by the shims
+	void begin(GLCapturedCall call) {
+		write((uint16_t)call);
+		calls++;
+	}
+
+	//a call with no GLCaptureWriter
+	void unrecorded(GLCall call) {
+		if (!installed)
+			return;
+		if (!reported[call])
+			std::cout << "ERROR::CAPTURE::UNRECORDED_CALL " << glCallName(call) << std::endl;
+		reported[call] = true;
+		unrecordedCalls++;
+	}
+
+	template <typename T>
+	void raw(T value) {
+		static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value, "pointer arguments need their own GLCaptureWriter");
+		write(value);
+	}
+
+	//offsets into bound buffers travel as pointers
+	void raw(const void* pointer) {
+		write((uint64_t)(uintptr_t)pointer);
+	}
+
+	void size(int64_t value) {
+		write(value);
+	}
+
+	void bytes(const void* data, uint64_t count) {
+		write((uint8_t)(data != NULL));
+		write(count);
+		if (data)
+			file.write((const char*)data, (std::streamsize)count);
+	}
+
+	void text(const char* string, int64_t length = -1) {
+		uint32_t count = (uint32_t)(length < 0 ? strlen(string) : (size_t)length);
+		write(count);
+		file.write(string, count);
+	}
+
+	void setUnpackAlignment(GLint alignment) { unpackAlignment = alignment; }
+
+	//bytes glTexImage2D reads from client memory with the current unpack alignment
+	uint64_t imageBytes(GLsizei width, GLsizei height, GLenum format, GLenum type) const {
+		uint64_t components = 4;
+		switch (format) {
+		case GL_RED: case GL_DEPTH_COMPONENT: components = 1; break;
+		case GL_RG: components = 2; break;
+		case GL_RGB: case GL_BGR: components = 3; break;
+		}
+		uint64_t componentBytes = 1;
+		switch (type) {
+		case GL_HALF_FLOAT: case GL_UNSIGNED_SHORT: case GL_SHORT: componentBytes = 2; break;
+		case GL_FLOAT: case GL_UNSIGNED_INT: case GL_INT: componentBytes = 4; break;
+		}
+		uint64_t row = (uint64_t)width * components * componentBytes;
+		row = (row + unpackAlignment - 1) / unpackAlignment * unpackAlignment;
+		return row * height;
+	}
+
+private:
+
+	bool installed;
+	std::ofstream file;
+	unsigned int frames;
+	unsigned int calls;
+	uint32_t unrecordedCalls;
+	bool reported[GL_CALL_COUNT];
+	GLint unpackAlignment;
+
+	template <typename T>
+	void write(T value) {
+		file.write((const char*)&value, sizeof(T));
+	}
+};
+
+inline GLCapture& glCapture() {
+	static GLCapture capture;
+	return capture;
+}
+
+
+//How one call is written. The default stores the result, if any, and then every argument by
+//value; calls passing pointers to data have their own below.
+template <int Call>
+struct GLCaptureWriter {
+	template <typename... Arguments>
+	static void write(GLCapture& capture, Arguments... arguments) {
+		capture.begin((GLCapturedCall)Call);
+		int expand[] = { 0, (capture.raw(arguments), 0)... };
+		(void)expand;
+	}
+};
+
+//glGen*: the names the app got back
+template <int Call>
+struct GLCaptureGenWriter {
+	static void write(GLCapture& capture, GLsizei count, GLuint* names) {
+		capture.begin((GLCapturedCall)Call);
+		capture.raw(count);
+		for (GLsizei i = 0; i < count; i++)
+			capture.raw(names[i]);
+	}
+};
+template <int Call>
+struct GLCaptureDeleteWriter {
+	static void write(GLCapture& capture, GLsizei count, const GLuint* names) {
+		capture.begin((GLCapturedCall)Call);
+		capture.raw(count);
+		for (GLsizei i = 0; i < count; i++)
+			capture.raw(names[i]);
+	}
+};
+template <> struct GLCaptureWriter<GL_CAPTURED_GenBuffers> : GLCaptureGenWriter<GL_CAPTURED_GenBuffers> {};
+template <> struct GLCaptureWriter<GL_CAPTURED_GenVertexArrays> : GLCaptureGenWriter<GL_CAPTURED_GenVertexArrays> {};
+template <> struct GLCaptureWriter<GL_CAPTURED_GenTextures> : GLCaptureGenWriter<GL_CAPTURED_GenTextures> {};
+template <> struct GLCaptureWriter<GL_CAPTURED_DeleteBuffers> : GLCaptureDeleteWriter<GL_CAPTURED_DeleteBuffers> {};
+template <> struct GLCaptureWriter<GL_CAPTURED_DeleteVertexArrays> : GLCaptureDeleteWriter<GL_CAPTURED_DeleteVertexArrays> {};
+template <> struct GLCaptureWriter<GL_CAPTURED_DeleteTextures> : GLCaptureDeleteWriter<GL_CAPTURED_DeleteTextures> {};
+
+template <> struct GLCaptureWriter<GL_CAPTURED_PixelStorei> {
+	static void write(GLCapture& capture, GLenum parameter, GLint value) {
+		if (parameter == GL_UNPACK_ALIGNMENT)
+			capture.setUnpackAlignment(value);
+		capture.begin(GL_CAPTURED_PixelStorei);
+		capture.raw(parameter);
+		capture.raw(value);
+	}
+};
+
+template <> struct GLCaptureWriter<GL_CAPTURED_BufferData> {
+	static void write(GLCapture& capture, GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+		capture.begin(GL_CAPTURED_BufferData);
+		capture.raw(target);
+		capture.bytes(data, (uint64_t)size);
+		capture.raw(usage);
+	}
+};
+template <> struct GLCaptureWriter<GL_CAPTURED_BufferSubData> {
+	static void write(GLCapture& capture, GLenum target, GLintptr offset, GLsizeiptr size, const void* data) {
+		capture.begin(GL_CAPTURED_BufferSubData);
+		capture.raw(target);
+		capture.size(offset);
+		capture.bytes(data, (uint64_t)size);
+	}
+};
+
+template <> struct GLCaptureWriter<GL_CAPTURED_TexImage2D> {
+	static void write(GLCapture& capture, GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels) {
+		capture.begin(GL_CAPTURED_TexImage2D);
+		capture.raw(target);
+		capture.raw(level);
+		capture.raw(internalFormat);
+		capture.raw(width);
+		capture.raw(height);
+		capture.raw(border);
+		capture.raw(format);
+		capture.raw(type);
+		capture.bytes(pixels, capture.imageBytes(width, height, format, type));
+	}
+};
+
+template <> struct GLCaptureWriter<GL_CAPTURED_ShaderSource> {
+	static void write(GLCapture& capture, GLuint shader, GLsizei count, const GLchar* const* strings, const GLint* lengths) {
+		capture.begin(GL_CAPTURED_ShaderSource);
+		capture.raw(shader);
+		capture.raw(count);
+		for (GLsizei i = 0; i < count; i++)
+			capture.text(strings[i], lengths ? lengths[i] : -1);
+	}
+};
+
+template <> struct GLCaptureWriter<GL_CAPTURED_GetUniformLocation> {
+	static void write(GLCapture& capture, GLint location, GLuint program, const GLchar* name) {
+		capture.begin(GL_CAPTURED_GetUniformLocation);
+		capture.raw(location);
+		capture.raw(program);
+		capture.text(name);
+	}
+};
+
+template <int Call, int Components>
+struct GLCaptureUniformArrayWriter {
+	static void write(GLCapture& capture, GLint location, GLsizei count, const GLfloat* values) {
+		capture.begin((GLCapturedCall)Call);
+		capture.raw(location);
+		capture.raw(count);
+		capture.bytes(values, (uint64_t)count * Components * sizeof(GLfloat));
+	}
+};
+template <> struct GLCaptureWriter<GL_CAPTURED_Uniform3fv> : GLCaptureUniformArrayWriter<GL_CAPTURED_Uniform3fv, 3> {};
+
+template <> struct GLCaptureWriter<GL_CAPTURED_UniformMatrix4fv> {
+	static void write(GLCapture& capture, GLint location, GLsizei count, GLboolean transpose, const GLfloat* values) {
+		capture.begin(GL_CAPTURED_UniformMatrix4fv);
+		capture.raw(location);
+		capture.raw(count);
+		capture.raw(transpose);
+		capture.bytes(values, (uint64_t)count * 16 * sizeof(GLfloat));
+	}
+};
+
+
+//The shim standing in for one glad pointer: call the real function, then record the call, so
+//glGen* and glCreate* are written with the names they returned.
+template <int Call, typename Function>
+struct GLCaptureShim;
+
+template <int Call, typename... Arguments>
+struct GLCaptureShim<Call, void (APIENTRYP)(Arguments...)> {
+	typedef void (APIENTRYP Function)(Arguments...);
+	static Function original;
+
+	static void APIENTRY call(Arguments... arguments) {
+		original(arguments...);
+		GLCaptureWriter<Call>::write(glCapture(), arguments...);
+	}
+};
+
+template <int Call, typename Result, typename... Arguments>
+struct GLCaptureShim<Call, Result (APIENTRYP)(Arguments...)> {
+	typedef Result (APIENTRYP Function)(Arguments...);
+	static Function original;
+
+	static Result APIENTRY call(Arguments... arguments) {
+		Result result = original(arguments...);
+		GLCaptureWriter<Call>::write(glCapture(), result, arguments...);
+		return result;
+	}
+};
+
+//The shim for a call GLCapture has no writer for. Call is a GLCall, not a GLCapturedCall.
+template <int Call, typename Function>
+struct GLUnrecordedShim;
+
+template <int Call, typename Result, typename... Arguments>
+struct GLUnrecordedShim<Call, Result (APIENTRYP)(Arguments...)> {
+	typedef Result (APIENTRYP Function)(Arguments...);
+	static Function original;
+
+	static Result APIENTRY call(Arguments... arguments) {
+		glCapture().unrecorded((GLCall)Call);
+		return original(arguments...);
+	}
+};
+
+template <int Call, typename... Arguments>
+typename GLCaptureShim<Call, void (APIENTRYP)(Arguments...)>::Function GLCaptureShim<Call, void (APIENTRYP)(Arguments...)>::original = NULL;
+template <int Call, typename Result, typename... Arguments>
+typename GLCaptureShim<Call, Result (APIENTRYP)(Arguments...)>::Function GLCaptureShim<Call, Result (APIENTRYP)(Arguments...)>::original = NULL;
+template <int Call, typename Result, typename... Arguments>
+typename GLUnrecordedShim<Call, Result (APIENTRYP)(Arguments...)>::Function GLUnrecordedShim<Call, Result (APIENTRYP)(Arguments...)>::original = NULL;
+
+
+inline bool GLCapture::start(const char* path) {
+
+	if (installed)
+		return true;
+
+	file.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		std::cout << "ERROR::GL_CAPTURE::FILE_NOT_OPENED " << path << std::endl;
+		return false;
+	}
+	file.write("GLTRACE", 7);
+	write(VERSION);
+	write((uint32_t)0); //unrecorded calls, filled in by stop()
+	GLint viewport[4] = {};
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	write((uint32_t)viewport[2]);
+	write((uint32_t)viewport[3]);
+
+	bool captured[GL_CALL_COUNT] = {};
+#define GL_CAPTURED_INSTALL(name) \
+	captured[GL_CALL_##name] = true; \
+	if (glad_gl##name) { \
+		GLCaptureShim<GL_CAPTURED_##name, decltype(glad_gl##name)>::original = glad_gl##name; \
+		glad_gl##name = &GLCaptureShim<GL_CAPTURED_##name, decltype(glad_gl##name)>::call; \
+	}
+	GL_CAPTURED_CALLS(GL_CAPTURED_INSTALL)
+#undef GL_CAPTURED_INSTALL
+
+#define GL_UNRECORDED_INSTALL(name) \
+	if (glad_gl##name && !captured[GL_CALL_##name] && !isIgnored(GL_CALL_##name)) { \
+		GLUnrecordedShim<GL_CALL_##name, decltype(glad_gl##name)>::original = glad_gl##name; \
+		glad_gl##name = &GLUnrecordedShim<GL_CALL_##name, decltype(glad_gl##name)>::call; \
+	}
+	GL_ALL_CALLS(GL_UNRECORDED_INSTALL)
+#undef GL_UNRECORDED_INSTALL
+
+	for (int i = 0; i < GL_CALL_COUNT; i++)
+		reported[i] = false;
+	frames = calls = unrecordedCalls = 0;
+	unpackAlignment = 4;
+	installed = true;
+	return true;
+}
+
+inline void GLCapture::stop() {
+
+	if (!installed)
+		return;
+
+#define GL_CAPTURED_UNINSTALL(name) \
+	if (GLCaptureShim<GL_CAPTURED_##name, decltype(glad_gl##name)>::original) \
+		glad_gl##name = GLCaptureShim<GL_CAPTURED_##name, decltype(glad_gl##name)>::original;
+	GL_CAPTURED_CALLS(GL_CAPTURED_UNINSTALL)
+#undef GL_CAPTURED_UNINSTALL
+
+#define GL_UNRECORDED_UNINSTALL(name) \
+	if (GLUnrecordedShim<GL_CALL_##name, decltype(glad_gl##name)>::original) { \
+		glad_gl##name = GLUnrecordedShim<GL_CALL_##name, decltype(glad_gl##name)>::original; \
+		GLUnrecordedShim<GL_CALL_##name, decltype(glad_gl##name)>::original = NULL; \
+	}
+	GL_ALL_CALLS(GL_UNRECORDED_UNINSTALL)
+#undef GL_UNRECORDED_UNINSTALL
+
+	std::cout << "GL_CAPTURE::TRACE " << frames << " frames, " << calls << " calls, " << (uint64_t)file.tellp() << " bytes" << std::endl;
+	if (unrecordedCalls) {
+		std::cout << "ERROR::CAPTURE::INCOMPLETE_TRACE " << unrecordedCalls << " calls were not recorded" << std::endl;
+		file.seekp(7 + sizeof(VERSION));
+		write(unrecordedCalls);
+	}
+	file.close();
+	installed = false;
+}
+#endif
@@ -0,0 +1,493 @@
+#pragma once
+
+#ifndef GL_INTERCEPTOR_H
+#define GL_INTERCEPTOR_H
+
+#include <glad/glad.h>
+#include "GLCalls.h"
+#include "GLMemoryHooks.h"
+
+#include <vector>
+#include <map>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+
+
+//Opt-in counting layer over glad's function pointer table.
+//
+//glad routes every glFoo through a pointer glad_glFoo. install() saves every pointer in the
+//table (GL_ALL_CALLS) and puts a shim in its place that counts the call, times it on the CPU and, for the calls that matter,
+//looks at the arguments: bytes handed to buffer and texture uploads, and binds that set what is
+//already bound. uninstall() puts the original pointers back. Until install() nothing is touched,
+//so leaving it off costs nothing at all.
+//
+//Counters are per frame: beginFrame() keeps the finished frame for printLastFrame() and adds it
+//to the running totals. Only the main thread's context is expected; the counters are not atomic.
+//
+//GL object sizes are not its business: GLMemoryHooks reports those whether this is installed or not.
+class GLInterceptor {
+
+public:
+
+	enum Kind { KIND_DRAW, KIND_STATE, KIND_UNIFORM, KIND_UPLOAD, KIND_QUERY, KIND_OTHER };
+
+	struct Counters {
+		unsigned int calls[GL_CALL_COUNT];
+		unsigned int redundant[GL_CALL_COUNT]; //binds of what was already bound
+		uint64_t nanoseconds[GL_CALL_COUNT];
+		uint64_t bytesUploaded;
+		uint64_t triangles; //drawn as triangles, strips or fans
+
+		unsigned int totalCalls() const {
+			unsigned int total = 0;
+			for (int i = 0; i < GL_CALL_COUNT; i++)
+				total += calls[i];
+			return total;
+		}
+		unsigned int kindCalls(Kind kind) const {
+			unsigned int total = 0;
+			for (int i = 0; i < GL_CALL_COUNT; i++) {
+				if (callKind((GLCall)i) == kind)
+					total += calls[i];
+			}
+			return total;
+		}
+		unsigned int drawCalls() const {
+			unsigned int total = 0;
+			for (int i = 0; i < GL_CALL_COUNT; i++) {
+				if (isDrawCall((GLCall)i))
+					total += calls[i];
+			}
+			return total;
+		}
+	};
+
+	bool timeCalls; //a steady_clock read on each side of every call
+
+	GLInterceptor() : timeCalls(true), installed(false), frames(0) {
+		clear(current);
+		clear(lastFrame);
+		clear(total);
+	}
+
+	//call after gladLoadGLLoader
+	void install();
+	void uninstall();
+
+	bool isInstalled() const { return installed; }
+
+	void beginFrame() {
+		if (!installed)
+			return;
+		lastFrame = current;
+		for (int i = 0; i < GL_CALL_COUNT; i++) {
+			total.calls[i] += current.calls[i];
+			total.redundant[i] += current.redundant[i];
+			total.nanoseconds[i] += current.nanoseconds[i];
+		}
+		total.bytesUploaded += current.bytesUploaded;
+		total.triangles += current.triangles;
+		frames++;
+		clear(current);
+	}
+
+	const Counters& getLastFrame() const { return lastFrame; }
+	const Counters& getTotal() const { return total; }
+	unsigned int getFrameCount() const { return frames; }
+
+	static const char* callName(GLCall call) {
+		return glCallName(call);
+	}
+
+	//glDraw* and glMultiDraw*, what reaches the GPU as a draw; glClear counts as KIND_DRAW but not here
+	static bool isDrawCall(GLCall call) {
+		const char* name = glCallName(call);
+		return (strncmp(name, "glDraw", 6) == 0 && strncmp(name, "glDrawBuffer", 12) != 0) || strncmp(name, "glMultiDraw", 11) == 0;
+	}
+
+	static Kind callKind(GLCall call) {
+		static Kind kinds[GL_CALL_COUNT];
+		static bool classified = false;
+		if (!classified) {
+			for (int i = 0; i < GL_CALL_COUNT; i++)
+				kinds[i] = classify((GLCall)i);
+			classified = true;
+		}
+		return kinds[call];
+	}
+
+	//one line per call made last frame, most frequent first, with a bar for the count
+	void printLastFrame() const {
+		print("GL_INTERCEPTOR::FRAME", lastFrame, 1);
+	}
+
+	//the average frame since install()
+	void printAverage() const {
+		print("GL_INTERCEPTOR::AVERAGE", total, std::max(frames, 1u));
+	}
+
+	//----used by the shims
+	void recordCall(GLCall call, uint64_t nanoseconds) {
+		current.calls[call]++;
+		current.nanoseconds[call] += nanoseconds;
+	}
+
+	void recordUpload(uint64_t bytes) {
+		current.bytesUploaded += bytes;
+	}
+
+	void recordDraw(GLenum mode, GLsizei count, GLsizei instances) {
+		uint64_t triangles = 0;
+		if (mode == GL_TRIANGLES)
+			triangles = count / 3;
+		else if ((mode == GL_TRIANGLE_STRIP || mode == GL_TRIANGLE_FAN) && count > 2)
+			triangles = count - 2;
+		current.triangles += triangles * instances;
+	}
+
+	//slot tells apart binding points of the same call, e.g. buffer targets or texture units
+	void recordBind(GLCall call, uint64_t slot, GLuint name) {
+		uint64_t key = ((uint64_t)call << 48) ^ slot;
+		std::map<uint64_t, GLuint>::iterator found = bindings.find(key);
+		if (found != bindings.end() && found->second == name)
+			current.redundant[call]++;
+		else
+			bindings[key] = name;
+	}
+
+	//name last bound through call at slot, 0 when nothing is
+	GLuint boundName(GLCall call, uint64_t slot) const {
+		std::map<uint64_t, GLuint>::const_iterator found = bindings.find(((uint64_t)call << 48) ^ slot);
+		return found != bindings.end() ? found->second : 0;
+	}
+
+	//deleting a bound object unbinds it
+	void recordDelete(GLCall bindCall, GLuint name) {
+		for (std::map<uint64_t, GLuint>::iterator it = bindings.begin(); it != bindings.end(); ++it) {
+			if ((it->first >> 48) == (uint64_t)bindCall && it->second == name)
+				it->second = 0;
+		}
+	}
+
+	void recordActiveTexture(GLenum unit) {
+		activeTexture = unit;
+	}
+
+	GLenum getActiveTexture() const { return activeTexture; }
+
+private:
+
+	bool installed;
+	unsigned int frames;
+	Counters current;
+	Counters lastFrame;
+	Counters total;
+	std::map<uint64_t, GLuint> bindings; //last name bound per call and slot
+	GLenum activeTexture = GL_TEXTURE0;
+
+	//by name, so every call in the table lands somewhere without a hand kept list
+	static Kind classify(GLCall call) {
+		static const char* const state[] = {
+			"glBind", "glEnable", "glDisable", "glUseProgram", "glActiveTexture", "glViewport", "glScissor", "glClearColor",
+			"glClearDepth", "glClearStencil", "glBlend", "glDepth", "glStencil", "glColorMask", "glCullFace", "glFrontFace",
+			"glPolygon", "glLineWidth", "glPointSize", "glPointParameter", "glHint", "glLogicOp", "glSampleCoverage",
+			"glSampleMask", "glProvokingVertex", "glPrimitiveRestartIndex", "glDrawBuffer", "glReadBuffer", "glPixelStore",
+			"glTexParameter", "glSamplerParameter", "glVertexAttribPointer", "glVertexAttribIPointer", "glVertexAttribDivisor"
+		};
+		static const char* const upload[] = {
+			"glBufferData", "glBufferSubData", "glTexImage", "glTexSubImage", "glCompressedTex", "glCopyTex",
+			"glCopyBufferSubData", "glGenerateMipmap", "glRenderbufferStorage"
+		};
+		const char* name = glCallName(call);
+		for (const char* prefix : state) {
+			if (strncmp(name, prefix, strlen(prefix)) == 0)
+				return KIND_STATE;
+		}
+		if (isDrawCall(call) || strncmp(name, "glClear", 7) == 0)
+			return KIND_DRAW;
+		if (strncmp(name, "glUniform", 9) == 0)
+			return KIND_UNIFORM;
+		for (const char* prefix : upload) {
+			if (strncmp(name, prefix, strlen(prefix)) == 0)
+				return KIND_UPLOAD;
+		}
+		if (glCallIsQuery(call) || call == GL_CALL_GetUniformLocation)
+			return KIND_QUERY;
+		return KIND_OTHER;
+	}
+
+	static void clear(Counters& counters) {
+		for (int i = 0; i < GL_CALL_COUNT; i++) {
+			counters.calls[i] = 0;
+			counters.redundant[i] = 0;
+			counters.nanoseconds[i] = 0;
+		}
+		counters.bytesUploaded = 0;
+		counters.triangles = 0;
+	}
+
+	void print(const char* title, const Counters& counters, unsigned int frameCount) const {
+
+		std::vector<int> order;
+		unsigned int most = 1;
+		for (int i = 0; i < GL_CALL_COUNT; i++) {
+			if (counters.calls[i]) {
+				order.push_back(i);
+				most = std::max(most, counters.calls[i]);
+			}
+		}
+		std::sort(order.begin(), order.end(), [&counters](int a, int b) { return counters.calls[a] > counters.calls[b]; });
+
+		std::cout << title << " " << (double)counters.totalCalls() / frameCount << " calls: "
+			<< (double)counters.kindCalls(KIND_DRAW) / frameCount << " draw, "
+			<< (double)counters.kindCalls(KIND_STATE) / frameCount << " state, "
+			<< (double)counters.kindCalls(KIND_UNIFORM) / frameCount << " uniform, "
+			<< (double)counters.kindCalls(KIND_UPLOAD) / frameCount << " upload, "
+			<< (double)counters.kindCalls(KIND_QUERY) / frameCount << " query, "
+			<< (double)counters.kindCalls(KIND_OTHER) / frameCount << " other, "
+			<< (double)counters.bytesUploaded / frameCount << " bytes uploaded, "
+			<< (double)counters.triangles / frameCount << " triangles" << std::endl;
+
+		for (int i : order) {
+			std::string name = callName((GLCall)i);
+			name.resize(std::max(name.size(), (size_t)26), ' ');
+			std::cout << "    " << name << (double)counters.calls[i] / frameCount
+				<< "\t" << counters.nanoseconds[i] / 1000.0 / frameCount << " us";
+			if (counters.redundant[i])
+				std::cout << "\t" << (double)counters.redundant[i] / frameCount << " redundant";
+			std::cout << "\t" << std::string((size_t)(40.0 * counters.calls[i] / most + 0.5), '#') << std::endl;
+		}
+	}
+};
+
+inline GLInterceptor& glInterceptor() {
+	static GLInterceptor interceptor;
+	return interceptor;
+}
+
+
+//Argument inspection for the calls whose arguments are worth counting; the rest do nothing.
+template <int Call>
+struct GLCallObserver {
+	template <typename... Arguments>
+	static void observe(GLInterceptor&, Arguments...) {}
+};
+
+template <> struct GLCallObserver<GL_CALL_UseProgram> {
+	static void observe(GLInterceptor& interceptor, GLuint program) { interceptor.recordBind(GL_CALL_UseProgram, 0, program); }
+};
+template <> struct GLCallObserver<GL_CALL_BindVertexArray> {
+	static void observe(GLInterceptor& interceptor, GLuint vertexArray) { interceptor.recordBind(GL_CALL_BindVertexArray, 0, vertexArray); }
+};
+template <> struct GLCallObserver<GL_CALL_BindBuffer> {
+	//the element array binding is part of the vertex array object, so its slot is per VAO
+	static void observe(GLInterceptor& interceptor, GLenum target, GLuint buffer) {
+		uint64_t slot = target;
+		if (target == GL_ELEMENT_ARRAY_BUFFER)
+			slot |= (uint64_t)interceptor.boundName(GL_CALL_BindVertexArray, 0) << 32;
+		interceptor.recordBind(GL_CALL_BindBuffer, slot, buffer);
+	}
+};
+template <> struct GLCallObserver<GL_CALL_BindFramebuffer> {
+	static void observe(GLInterceptor& interceptor, GLenum target, GLuint framebuffer) { interceptor.recordBind(GL_CALL_BindFramebuffer, target, framebuffer); }
+};
+template <> struct GLCallObserver<GL_CALL_ActiveTexture> {
+	static void observe(GLInterceptor& interceptor, GLenum unit) {
+		interceptor.recordBind(GL_CALL_ActiveTexture, 0, unit);
+		interceptor.recordActiveTexture(unit);
+	}
+};
+template <> struct GLCallObserver<GL_CALL_BindTexture> {
+	static void observe(GLInterceptor& interceptor, GLenum target, GLuint texture) {
+		interceptor.recordBind(GL_CALL_BindTexture, ((uint64_t)interceptor.getActiveTexture() << 32) | target, texture);
+	}
+};
+template <> struct GLCallObserver<GL_CALL_BindBufferBase> {
+	static void observe(GLInterceptor& interceptor, GLenum target, GLuint index, GLuint buffer) {
+		interceptor.recordBind(GL_CALL_BindBufferBase, ((uint64_t)target << 32) | index, buffer);
+	}
+};
+template <> struct GLCallObserver<GL_CALL_BindSampler> {
+	static void observe(GLInterceptor& interceptor, GLuint unit, GLuint sampler) { interceptor.recordBind(GL_CALL_BindSampler, unit, sampler); }
+};
+template <> struct GLCallObserver<GL_CALL_BindRenderbuffer> {
+	static void observe(GLInterceptor& interceptor, GLenum target, GLuint renderbuffer) { interceptor.recordBind(GL_CALL_BindRenderbuffer, target, renderbuffer); }
+};
+template <> struct GLCallObserver<GL_CALL_BufferData> {
+	static void observe(GLInterceptor& interceptor, GLenum, GLsizeiptr size, const void* data, GLenum) {
+		if (data)
+			interceptor.recordUpload((uint64_t)size);
+	}
+};
+template <> struct GLCallObserver<GL_CALL_BufferSubData> {
+	static void observe(GLInterceptor& interceptor, GLenum, GLintptr, GLsizeiptr size, const void*) {
+		interceptor.recordUpload((uint64_t)size);
+	}
+};
+
+template <> struct GLCallObserver<GL_CALL_TexImage2D> {
+	static void observe(GLInterceptor& interceptor, GLenum, GLint, GLint, GLsizei width, GLsizei height, GLint, GLenum format, GLenum type, const void* pixels) {
+		if (pixels)
+			interceptor.recordUpload(glImageBytes(width, height, format, type));
+	}
+};
+template <> struct GLCallObserver<GL_CALL_TexSubImage2D> {
+	static void observe(GLInterceptor& interceptor, GLenum, GLint, GLint, GLint, GLsizei width, GLsizei height, GLenum format, GLenum type, const void*) {
+		interceptor.recordUpload(glImageBytes(width, height, format, type));
+	}
+};
+template <> struct GLCallObserver<GL_CALL_TexImage3D> {
+	static void observe(GLInterceptor& interceptor, GLenum, GLint, GLint, GLsizei width, GLsizei height, GLsizei depth, GLint, GLenum format, GLenum type, const void* pixels) {
+		if (pixels)
+			interceptor.recordUpload(glImageBytes(width, height, format, type) * depth);
+	}
+};
+template <> struct GLCallObserver<GL_CALL_TexSubImage3D> {
+	static void observe(GLInterceptor& interceptor, GLenum, GLint, GLint, GLint, GLint, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void*) {
+		interceptor.recordUpload(glImageBytes(width, height, format, type) * depth);
+	}
+};
+
+
+template <> struct GLCallObserver<GL_CALL_DrawArrays> {
+	static void observe(GLInterceptor& interceptor, GLenum mode, GLint, GLsizei count) { interceptor.recordDraw(mode, count, 1); }
+};
+template <> struct GLCallObserver<GL_CALL_DrawElements> {
+	static void observe(GLInterceptor& interceptor, GLenum mode, GLsizei count, GLenum, const void*) { interceptor.recordDraw(mode, count, 1); }
+};
+template <> struct GLCallObserver<GL_CALL_DrawElementsBaseVertex> {
+	static void observe(GLInterceptor& interceptor, GLenum mode, GLsizei count, GLenum, const void*, GLint) { interceptor.recordDraw(mode, count, 1); }
+};
+template <> struct GLCallObserver<GL_CALL_DrawArraysInstanced> {
+	static void observe(GLInterceptor& interceptor, GLenum mode, GLint, GLsizei count, GLsizei instances) { interceptor.recordDraw(mode, count, instances); }
+};
+template <> struct GLCallObserver<GL_CALL_DrawElementsInstanced> {
+	static void observe(GLInterceptor& interceptor, GLenum mode, GLsizei count, GLenum, const void*, GLsizei instances) { interceptor.recordDraw(mode, count, instances); }
+};
+template <> struct GLCallObserver<GL_CALL_DrawElementsInstancedBaseVertex> {
+	static void observe(GLInterceptor& interceptor, GLenum mode, GLsizei count, GLenum, const void*, GLsizei instances, GLint) { interceptor.recordDraw(mode, count, instances); }
+};
+template <> struct GLCallObserver<GL_CALL_DrawRangeElements> {
+	static void observe(GLInterceptor& interceptor, GLenum mode, GLuint, GLuint, GLsizei count, GLenum, const void*) { interceptor.recordDraw(mode, count, 1); }
+};
+template <> struct GLCallObserver<GL_CALL_DrawRangeElementsBaseVertex> {
+	static void observe(GLInterceptor& interceptor, GLenum mode, GLuint, GLuint, GLsizei count, GLenum, const void*, GLint) { interceptor.recordDraw(mode, count, 1); }
+};
+template <> struct GLCallObserver<GL_CALL_MultiDrawArrays> {
+	static void observe(GLInterceptor& interceptor, GLenum mode, const GLint*, const GLsizei* counts, GLsizei draws) {
+		for (GLsizei i = 0; i < draws; i++)
+			interceptor.recordDraw(mode, counts[i], 1);
+	}
+};
+template <> struct GLCallObserver<GL_CALL_MultiDrawElements> {
+	static void observe(GLInterceptor& interceptor, GLenum mode, const GLsizei* counts, GLenum, const void* const*, GLsizei draws) {
+		for (GLsizei i = 0; i < draws; i++)
+			interceptor.recordDraw(mode, counts[i], 1);
+	}
+};
+template <> struct GLCallObserver<GL_CALL_MultiDrawElementsBaseVertex> {
+	static void observe(GLInterceptor& interceptor, GLenum mode, const GLsizei* counts, GLenum, const void* const*, GLsizei draws, const GLint*) {
+		for (GLsizei i = 0; i < draws; i++)
+			interceptor.recordDraw(mode, counts[i], 1);
+	}
+};
+
+template <> struct GLCallObserver<GL_CALL_DeleteBuffers> {
+	static void observe(GLInterceptor& interceptor, GLsizei count, const GLuint* names) {
+		for (GLsizei i = 0; i < count; i++)
+			interceptor.recordDelete(GL_CALL_BindBuffer, names[i]);
+	}
+};
+template <> struct GLCallObserver<GL_CALL_DeleteTextures> {
+	static void observe(GLInterceptor& interceptor, GLsizei count, const GLuint* names) {
+		for (GLsizei i = 0; i < count; i++)
+			interceptor.recordDelete(GL_CALL_BindTexture, names[i]);
+	}
+};
+template <> struct GLCallObserver<GL_CALL_DeleteRenderbuffers> {
+	static void observe(GLInterceptor& interceptor, GLsizei count, const GLuint* names) {
+		for (GLsizei i = 0; i < count; i++)
+			interceptor.recordDelete(GL_CALL_BindRenderbuffer, names[i]);
+	}
+};
+
+
+//The shim that takes the place of one glad pointer. One instantiation per call, each with the
+//exact signature of the function it stands in for.
+template <int Call, typename Function>
+struct GLShim;
+
+template <int Call, typename Result, typename... Arguments>
+struct GLShim<Call, Result (APIENTRYP)(Arguments...)> {
+
+	typedef Result (APIENTRYP Function)(Arguments...);
+	static Function original;
+
+	//adds the time between construction and destruction, so it also covers calls returning void
+	struct Timer {
+		GLInterceptor& interceptor;
+		std::chrono::steady_clock::time_point start;
+		bool timed;
+
+		Timer(GLInterceptor& owner) : interceptor(owner), timed(owner.timeCalls) {
+			if (timed)
+				start = std::chrono::steady_clock::now();
+		}
+		~Timer() {
+			uint64_t nanoseconds = timed ? (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() : 0;
+			interceptor.recordCall((GLCall)Call, nanoseconds);
+		}
+	};
+
+	static Result APIENTRY call(Arguments... arguments) {
+		GLInterceptor& interceptor = glInterceptor();
+		{
+			MemoryTagScope tag(MEMORY_TAG_TOOLS);
+			GLCallObserver<Call>::observe(interceptor, arguments...);
+		}
+		Timer timer(interceptor);
+		return original(arguments...);
+	}
+};
+
+template <int Call, typename Result, typename... Arguments>
+typename GLShim<Call, Result (APIENTRYP)(Arguments...)>::Function GLShim<Call, Result (APIENTRYP)(Arguments...)>::original = NULL;
+
+
+inline void GLInterceptor::install() {
+
+	if (installed)
+		return;
+
+	//functions the driver does not provide stay NULL
+#define GL_CALL_INSTALL(name) \
+	if (glad_gl##name) { \
+		GLShim<GL_CALL_##name, decltype(glad_gl##name)>::original = glad_gl##name; \
+		glad_gl##name = &GLShim<GL_CALL_##name, decltype(glad_gl##name)>::call; \
+	}
+	GL_ALL_CALLS(GL_CALL_INSTALL)
+#undef GL_CALL_INSTALL
+
+	bindings.clear();
+	activeTexture = GL_TEXTURE0;
+	installed = true;
+}
+
+inline void GLInterceptor::uninstall() {
+
+	if (!installed)
+		return;
+
+#define GL_CALL_UNINSTALL(name) \
+	if (GLShim<GL_CALL_##name, decltype(glad_gl##name)>::original) \
+		glad_gl##name = GLShim<GL_CALL_##name, decltype(glad_gl##name)>::original;
+	GL_ALL_CALLS(GL_CALL_UNINSTALL)
+#undef GL_CALL_UNINSTALL
+
+	installed = false;
+}
+#endif
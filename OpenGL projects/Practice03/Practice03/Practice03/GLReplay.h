@@ -0,0 +1,510 @@
+#pragma once
+
+#ifndef GL_REPLAY_H
+#define GL_REPLAY_H
+
+#include <glad/glad.h>
+
+#include "GLCapture.h"
+
+#include <fstream>
+#include <vector>
+#include <string>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+
+
+//Plays a GLCapture trace back into the current context as fast as it will go.
+//
+//Object names and uniform locations in the trace are the ones the capturing app was given; the
+//replayer keeps a map from each to what this context returned. Everything up to the first frame
+//marker is setup (shader compiles, uploads) and timed on its own. Each frame after that ends with
+//glFinish so its time covers the driver and the GPU, not just the call submission.
+//
+//fitTo() replays into a framebuffer of another size than the captured window: every viewport is
+//scaled by the ratio of the two, so a trace captured at 1600x1200 draws the same image at 640x480.
+class GLReplay {
+
+public:
+
+	GLReplay() : setupMilliseconds(0.0), capturedWidth(0), capturedHeight(0), targetWidth(0), targetHeight(0), currentProgram(0), drawCalls(0), failed(false) {}
+
+	bool open(const char* path) {
+		file.open(path, std::ios::in | std::ios::binary);
+		if (!file.is_open()) {
+			std::cout << "ERROR::GL_REPLAY::FILE_NOT_OPENED " << path << std::endl;
+			return false;
+		}
+		char magic[7] = {};
+		file.read(magic, 7);
+		uint32_t version = read<uint32_t>();
+		if (!file || std::string(magic, 7) != "GLTRACE" || version != GLCapture::VERSION) {
+			std::cout << "ERROR::GL_REPLAY::NOT_A_TRACE " << path << std::endl;
+			return false;
+		}
+		uint32_t unrecordedCalls = read<uint32_t>();
+		if (unrecordedCalls) {
+			std::cout << "ERROR::GL_REPLAY::INCOMPLETE_TRACE " << path << " is missing " << unrecordedCalls << " calls" << std::endl;
+			return false;
+		}
+		capturedWidth = (GLsizei)read<uint32_t>();
+		capturedHeight = (GLsizei)read<uint32_t>();
+		return true;
+	}
+
+	//the size of the framebuffer replayed into, when it is not the captured window's
+	void fitTo(GLsizei width, GLsizei height) {
+		targetWidth = width;
+		targetHeight = height;
+	}
+
+	//replay the whole trace; false if it holds a call this build doesn't know
+	bool run() {
+
+		frameMilliseconds.clear();
+		frameDrawCalls.clear();
+		std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+		bool setup = true;
+
+		uint16_t call;
+		while (file.read((char*)&call, sizeof(call))) {
+
+			if (call != GL_CAPTURED_FRAME) {
+				if (!execute((GLCapturedCall)call) || failed) {
+					std::cout << "ERROR::GL_REPLAY::BAD_RECORD " << call << " after frame " << frameMilliseconds.size() << std::endl;
+					return false;
+				}
+				continue;
+			}
+
+			glFinish();
+			std::chrono::steady_clock::time_point frameEnd = std::chrono::steady_clock::now();
+			double milliseconds = std::chrono::duration<double, std::milli>(frameEnd - frameStart).count();
+			if (setup)
+				setupMilliseconds = milliseconds;
+			else {
+				frameMilliseconds.push_back(milliseconds);
+				frameDrawCalls.push_back(drawCalls);
+			}
+			setup = false;
+			drawCalls = 0;
+			frameStart = frameEnd;
+		}
+		glFinish();
+		return true;
+	}
+
+	void printReport() const {
+		std::cout << "GL_REPLAY::SETUP " << setupMilliseconds << " ms" << std::endl;
+		if (frameMilliseconds.empty()) {
+			std::cout << "GL_REPLAY::NO_FRAMES" << std::endl;
+			return;
+		}
+		std::vector<double> sorted = frameMilliseconds;
+		std::sort(sorted.begin(), sorted.end());
+		double total = 0.0;
+		for (double milliseconds : sorted)
+			total += milliseconds;
+		std::cout << "GL_REPLAY::FRAMES " << sorted.size()
+			<< " mean " << total / sorted.size() << " ms"
+			<< " min " << sorted.front()
+			<< " p50 " << percentile(sorted, 0.50)
+			<< " p95 " << percentile(sorted, 0.95)
+			<< " p99 " << percentile(sorted, 0.99)
+			<< " max " << sorted.back() << std::endl;
+	}
+
+	//one line per frame, for diffing two drivers or two builds
+	bool writeFrameTimes(const char* path) const {
+		std::ofstream out(path);
+		if (!out.is_open()) {
+			std::cout << "ERROR::GL_REPLAY::FILE_NOT_OPENED " << path << std::endl;
+			return false;
+		}
+		out << "frame,ms\n";
+		for (size_t i = 0; i < frameMilliseconds.size(); i++)
+			out << i << "," << frameMilliseconds[i] << "\n";
+		return true;
+	}
+
+	const std::vector<double>& getFrameMilliseconds() const { return frameMilliseconds; }
+	const std::vector<unsigned int>& getFrameDrawCalls() const { return frameDrawCalls; }
+	double getSetupMilliseconds() const { return setupMilliseconds; }
+
+	//delete what the trace created and never deleted itself
+	void destroy() {
+		for (auto& name : buffers)
+			glDeleteBuffers(1, &name.second);
+		for (auto& name : vertexArrays)
+			glDeleteVertexArrays(1, &name.second);
+		for (auto& name : textures)
+			glDeleteTextures(1, &name.second);
+		for (auto& name : programs)
+			glDeleteProgram(name.second);
+		for (auto& name : shaders)
+			glDeleteShader(name.second);
+		buffers.clear();
+		vertexArrays.clear();
+		textures.clear();
+		programs.clear();
+		shaders.clear();
+		locations.clear();
+		file.close();
+	}
+
+private:
+
+	std::ifstream file;
+	std::vector<double> frameMilliseconds;
+	std::vector<unsigned int> frameDrawCalls;
+	double setupMilliseconds;
+	GLsizei capturedWidth, capturedHeight; //viewport when the capture started
+	GLsizei targetWidth, targetHeight;     //0 replays viewports as captured
+
+	//captured name -> replayed name
+	std::unordered_map<GLuint, GLuint> buffers, vertexArrays, textures, shaders, programs;
+	//(captured program, captured location) -> replayed location
+	std::map<std::pair<GLuint, GLint>, GLint> locations;
+	GLuint currentProgram; //captured name of the program in use
+	unsigned int drawCalls; //in the frame being replayed
+	std::vector<unsigned char> scratch;
+	std::string text;
+	bool failed;
+
+	static double percentile(const std::vector<double>& sorted, double fraction) {
+		size_t index = (size_t)(fraction * (sorted.size() - 1) + 0.5);
+		return sorted[index];
+	}
+
+	template <typename T>
+	T read() {
+		T value = T();
+		file.read((char*)&value, sizeof(T));
+		if (!file)
+			failed = true;
+		return value;
+	}
+
+	const void* readPointer() {
+		return (const void*)(uintptr_t)read<uint64_t>();
+	}
+
+	//a GLCapture::bytes block; NULL when the app passed no data
+	const void* readBytes(uint64_t& count) {
+		bool present = read<uint8_t>() != 0;
+		count = read<uint64_t>();
+		if (!present || failed)
+			return NULL;
+		scratch.resize((size_t)count);
+		file.read((char*)scratch.data(), (std::streamsize)count);
+		if (!file)
+			failed = true;
+		return scratch.data();
+	}
+
+	const std::string& readText() {
+		uint32_t count = read<uint32_t>();
+		text.resize(count);
+		if (count)
+			file.read(&text[0], count);
+		if (!file)
+			failed = true;
+		return text;
+	}
+
+	static GLuint lookup(const std::unordered_map<GLuint, GLuint>& names, GLuint captured) {
+		if (captured == 0)
+			return 0;
+		std::unordered_map<GLuint, GLuint>::const_iterator found = names.find(captured);
+		return found == names.end() ? 0 : found->second;
+	}
+
+	GLint location(GLint captured) {
+		if (captured < 0)
+			return -1;
+		std::map<std::pair<GLuint, GLint>, GLint>::const_iterator found = locations.find(std::make_pair(currentProgram, captured));
+		return found == locations.end() ? -1 : found->second;
+	}
+
+	template <typename Generate>
+	void generate(std::unordered_map<GLuint, GLuint>& names, Generate function) {
+		GLsizei count = read<GLsizei>();
+		for (GLsizei i = 0; i < count && !failed; i++) {
+			GLuint captured = read<GLuint>();
+			GLuint name = 0;
+			function(1, &name);
+			names[captured] = name;
+		}
+	}
+
+	template <typename Delete>
+	void remove(std::unordered_map<GLuint, GLuint>& names, Delete function) {
+		GLsizei count = read<GLsizei>();
+		for (GLsizei i = 0; i < count && !failed; i++) {
+			GLuint captured = read<GLuint>();
+			std::unordered_map<GLuint, GLuint>::iterator found = names.find(captured);
+			if (found == names.end())
+				continue;
+			function(1, &found->second);
+			names.erase(found);
+		}
+	}
+
+	bool execute(GLCapturedCall call) {
+
+		switch (call) {
+
+		//----state
+		case GL_CAPTURED_Enable: { GLenum cap = read<GLenum>(); glEnable(cap); break; }
+		case GL_CAPTURED_Disable: { GLenum cap = read<GLenum>(); glDisable(cap); break; }
+		case GL_CAPTURED_Viewport: {
+			GLint x = read<GLint>(), y = read<GLint>();
+			GLsizei width = read<GLsizei>(), height = read<GLsizei>();
+			if (targetWidth > 0 && capturedWidth > 0 && capturedHeight > 0) {
+				x = (GLint)((int64_t)x * targetWidth / capturedWidth);
+				y = (GLint)((int64_t)y * targetHeight / capturedHeight);
+				width = (GLsizei)((int64_t)width * targetWidth / capturedWidth);
+				height = (GLsizei)((int64_t)height * targetHeight / capturedHeight);
+			}
+			glViewport(x, y, width, height);
+			break;
+		}
+		case GL_CAPTURED_ClearColor: {
+			GLfloat r = read<GLfloat>(), g = read<GLfloat>(), b = read<GLfloat>(), a = read<GLfloat>();
+			glClearColor(r, g, b, a);
+			break;
+		}
+		case GL_CAPTURED_Clear: { GLbitfield mask = read<GLbitfield>(); glClear(mask); break; }
+		case GL_CAPTURED_DepthFunc: { GLenum function = read<GLenum>(); glDepthFunc(function); break; }
+		case GL_CAPTURED_DepthMask: { GLboolean write = read<GLboolean>(); glDepthMask(write); break; }
+		case GL_CAPTURED_BlendFunc: {
+			GLenum source = read<GLenum>(), destination = read<GLenum>();
+			glBlendFunc(source, destination);
+			break;
+		}
+		case GL_CAPTURED_BlendFuncSeparate: {
+			GLenum sourceColor = read<GLenum>(), destinationColor = read<GLenum>();
+			GLenum sourceAlpha = read<GLenum>(), destinationAlpha = read<GLenum>();
+			glBlendFuncSeparate(sourceColor, destinationColor, sourceAlpha, destinationAlpha);
+			break;
+		}
+		case GL_CAPTURED_ActiveTexture: { GLenum unit = read<GLenum>(); glActiveTexture(unit); break; }
+		case GL_CAPTURED_PixelStorei: {
+			GLenum parameter = read<GLenum>();
+			GLint value = read<GLint>();
+			glPixelStorei(parameter, value);
+			break;
+		}
+
+		//----buffers and vertex arrays
+		case GL_CAPTURED_GenBuffers: generate(buffers, glGenBuffers); break;
+		case GL_CAPTURED_DeleteBuffers: remove(buffers, glDeleteBuffers); break;
+		case GL_CAPTURED_BindBuffer: {
+			GLenum target = read<GLenum>();
+			GLuint buffer = read<GLuint>();
+			glBindBuffer(target, lookup(buffers, buffer));
+			break;
+		}
+		case GL_CAPTURED_BufferData: {
+			GLenum target = read<GLenum>();
+			uint64_t size;
+			const void* data = readBytes(size);
+			GLenum usage = read<GLenum>();
+			glBufferData(target, (GLsizeiptr)size, data, usage);
+			break;
+		}
+		case GL_CAPTURED_BufferSubData: {
+			GLenum target = read<GLenum>();
+			int64_t offset = read<int64_t>();
+			uint64_t size;
+			const void* data = readBytes(size);
+			glBufferSubData(target, (GLintptr)offset, (GLsizeiptr)size, data);
+			break;
+		}
+		case GL_CAPTURED_GenVertexArrays: generate(vertexArrays, glGenVertexArrays); break;
+		case GL_CAPTURED_DeleteVertexArrays: remove(vertexArrays, glDeleteVertexArrays); break;
+		case GL_CAPTURED_BindVertexArray: { GLuint array = read<GLuint>(); glBindVertexArray(lookup(vertexArrays, array)); break; }
+		case GL_CAPTURED_VertexAttribPointer: {
+			GLuint index = read<GLuint>();
+			GLint size = read<GLint>();
+			GLenum type = read<GLenum>();
+			GLboolean normalized = read<GLboolean>();
+			GLsizei stride = read<GLsizei>();
+			const void* offset = readPointer();
+			glVertexAttribPointer(index, size, type, normalized, stride, offset);
+			break;
+		}
+		case GL_CAPTURED_EnableVertexAttribArray: { GLuint index = read<GLuint>(); glEnableVertexAttribArray(index); break; }
+
+		//----textures
+		case GL_CAPTURED_GenTextures: generate(textures, glGenTextures); break;
+		case GL_CAPTURED_DeleteTextures: remove(textures, glDeleteTextures); break;
+		case GL_CAPTURED_BindTexture: {
+			GLenum target = read<GLenum>();
+			GLuint texture = read<GLuint>();
+			glBindTexture(target, lookup(textures, texture));
+			break;
+		}
+		case GL_CAPTURED_TexParameteri: {
+			GLenum target = read<GLenum>(), parameter = read<GLenum>();
+			GLint value = read<GLint>();
+			glTexParameteri(target, parameter, value);
+			break;
+		}
+		case GL_CAPTURED_TexImage2D: {
+			GLenum target = read<GLenum>();
+			GLint level = read<GLint>(), internalFormat = read<GLint>();
+			GLsizei width = read<GLsizei>(), height = read<GLsizei>();
+			GLint border = read<GLint>();
+			GLenum format = read<GLenum>(), type = read<GLenum>();
+			uint64_t size;
+			const void* pixels = readBytes(size);
+			glTexImage2D(target, level, internalFormat, width, height, border, format, type, pixels);
+			break;
+		}
+		case GL_CAPTURED_GenerateMipmap: { GLenum target = read<GLenum>(); glGenerateMipmap(target); break; }
+
+		//----shaders and programs
+		case GL_CAPTURED_CreateShader: {
+			GLuint captured = read<GLuint>();
+			GLenum type = read<GLenum>();
+			shaders[captured] = glCreateShader(type);
+			break;
+		}
+		case GL_CAPTURED_ShaderSource: {
+			GLuint shader = read<GLuint>();
+			GLsizei count = read<GLsizei>();
+			std::vector<std::string> sources;
+			for (GLsizei i = 0; i < count && !failed; i++)
+				sources.push_back(readText());
+			std::vector<const GLchar*> strings;
+			std::vector<GLint> lengths;
+			for (const std::string& source : sources) {
+				strings.push_back(source.c_str());
+				lengths.push_back((GLint)source.size());
+			}
+			glShaderSource(lookup(shaders, shader), count, strings.data(), lengths.data());
+			break;
+		}
+		case GL_CAPTURED_CompileShader: { GLuint shader = read<GLuint>(); glCompileShader(lookup(shaders, shader)); break; }
+		case GL_CAPTURED_DeleteShader: {
+			GLuint shader = read<GLuint>();
+			glDeleteShader(lookup(shaders, shader));
+			shaders.erase(shader);
+			break;
+		}
+		case GL_CAPTURED_CreateProgram: { GLuint captured = read<GLuint>(); programs[captured] = glCreateProgram(); break; }
+		case GL_CAPTURED_AttachShader: {
+			GLuint program = read<GLuint>(), shader = read<GLuint>();
+			glAttachShader(lookup(programs, program), lookup(shaders, shader));
+			break;
+		}
+		case GL_CAPTURED_LinkProgram: { GLuint program = read<GLuint>(); glLinkProgram(lookup(programs, program)); break; }
+		case GL_CAPTURED_DeleteProgram: {
+			GLuint program = read<GLuint>();
+			glDeleteProgram(lookup(programs, program));
+			programs.erase(program);
+			break;
+		}
+		case GL_CAPTURED_UseProgram: {
+			currentProgram = read<GLuint>();
+			glUseProgram(lookup(programs, currentProgram));
+			break;
+		}
+
+		//----uniforms
+		case GL_CAPTURED_GetUniformLocation: {
+			GLint captured = read<GLint>();
+			GLuint program = read<GLuint>();
+			const std::string& name = readText();
+			if (captured >= 0)
+				locations[std::make_pair(program, captured)] = glGetUniformLocation(lookup(programs, program), name.c_str());
+			break;
+		}
+		case GL_CAPTURED_Uniform1i: {
+			GLint at = read<GLint>(), value = read<GLint>();
+			glUniform1i(location(at), value);
+			break;
+		}
+		case GL_CAPTURED_Uniform1f: {
+			GLint at = read<GLint>();
+			GLfloat value = read<GLfloat>();
+			glUniform1f(location(at), value);
+			break;
+		}
+		case GL_CAPTURED_Uniform2f: {
+			GLint at = read<GLint>();
+			GLfloat x = read<GLfloat>(), y = read<GLfloat>();
+			glUniform2f(location(at), x, y);
+			break;
+		}
+		case GL_CAPTURED_Uniform3f: {
+			GLint at = read<GLint>();
+			GLfloat x = read<GLfloat>(), y = read<GLfloat>(), z = read<GLfloat>();
+			glUniform3f(location(at), x, y, z);
+			break;
+		}
+		case GL_CAPTURED_Uniform4f: {
+			GLint at = read<GLint>();
+			GLfloat x = read<GLfloat>(), y = read<GLfloat>(), z = read<GLfloat>(), w = read<GLfloat>();
+			glUniform4f(location(at), x, y, z, w);
+			break;
+		}
+		case GL_CAPTURED_Uniform3fv: {
+			GLint at = read<GLint>();
+			GLsizei count = read<GLsizei>();
+			uint64_t size;
+			const void* values = readBytes(size);
+			glUniform3fv(location(at), count, (const GLfloat*)values);
+			break;
+		}
+		case GL_CAPTURED_UniformMatrix4fv: {
+			GLint at = read<GLint>();
+			GLsizei count = read<GLsizei>();
+			GLboolean transpose = read<GLboolean>();
+			uint64_t size;
+			const void* values = readBytes(size);
+			glUniformMatrix4fv(location(at), count, transpose, (const GLfloat*)values);
+			break;
+		}
+
+		//----draws
+		case GL_CAPTURED_DrawArrays: {
+			GLenum mode = read<GLenum>();
+			GLint first = read<GLint>();
+			GLsizei count = read<GLsizei>();
+			glDrawArrays(mode, first, count);
+			drawCalls++;
+			break;
+		}
+		case GL_CAPTURED_DrawElements: {
+			GLenum mode = read<GLenum>();
+			GLsizei count = read<GLsizei>();
+			GLenum type = read<GLenum>();
+			const void* indices = readPointer();
+			glDrawElements(mode, count, type, indices);
+			drawCalls++;
+			break;
+		}
+		case GL_CAPTURED_DrawElementsBaseVertex: {
+			GLenum mode = read<GLenum>();
+			GLsizei count = read<GLsizei>();
+			GLenum type = read<GLenum>();
+			const void* indices = readPointer();
+			GLint baseVertex = read<GLint>();
+			glDrawElementsBaseVertex(mode, count, type, indices, baseVertex);
+			drawCalls++;
+			break;
+		}
+
+		default:
+			return false;
+		}
+		return true;
+	}
+};
+#endif
@@ -0,0 +1,147 @@
+#pragma once
+
+#ifndef GOLDEN_IMAGE_H
+#define GOLDEN_IMAGE_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdlib>
+#include <iostream>
+
+
+//An RGBA8 image as glReadPixels returns it: bottom row first, 4 bytes per pixel.
+struct Image {
+	int width = 0;
+	int height = 0;
+	std::vector<unsigned char> pixels;
+
+	Image() {}
+	Image(int imageWidth, int imageHeight) : width(imageWidth), height(imageHeight), pixels((size_t)imageWidth * imageHeight * 4) {}
+
+	//binary PPM, top row first so any viewer shows it the right way up; alpha is dropped
+	bool writePPM(const std::string& path) const {
+		std::ofstream out(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!out.is_open()) {
+			std::cout << "ERROR::IMAGE::FILE_NOT_OPENED " << path << std::endl;
+			return false;
+		}
+		out << "P6\n" << width << " " << height << "\n255\n";
+		std::vector<unsigned char> row((size_t)width * 3);
+		for (int y = height - 1; y >= 0; y--) {
+			const unsigned char* source = &pixels[(size_t)y * width * 4];
+			for (int x = 0; x < width; x++) {
+				row[x * 3 + 0] = source[x * 4 + 0];
+				row[x * 3 + 1] = source[x * 4 + 1];
+				row[x * 3 + 2] = source[x * 4 + 2];
+			}
+			out.write((const char*)row.data(), row.size());
+		}
+		return true;
+	}
+
+	bool readPPM(const std::string& path) {
+		std::ifstream in(path.c_str(), std::ios::in | std::ios::binary);
+		if (!in.is_open())
+			return false;
+		std::string magic;
+		int maxValue = 0;
+		in >> magic >> width >> height >> maxValue;
+		in.get(); //the single whitespace before the samples
+		if (!in || magic != "P6" || maxValue != 255 || width <= 0 || height <= 0) {
+			std::cout << "ERROR::IMAGE::NOT_A_PPM " << path << std::endl;
+			return false;
+		}
+		pixels.assign((size_t)width * height * 4, 255);
+		std::vector<unsigned char> row((size_t)width * 3);
+		for (int y = height - 1; y >= 0; y--) {
+			in.read((char*)row.data(), row.size());
+			unsigned char* target = &pixels[(size_t)y * width * 4];
+			for (int x = 0; x < width; x++) {
+				target[x * 4 + 0] = row[x * 3 + 0];
+				target[x * 4 + 1] = row[x * 3 + 1];
+				target[x * 4 + 2] = row[x * 3 + 2];
+			}
+		}
+		if (!in) {
+			std::cout << "ERROR::IMAGE::TRUNCATED " << path << std::endl;
+			return false;
+		}
+		return true;
+	}
+};
+
+
+//Compares a rendered image against a stored reference, with a tolerance for what the eye can't see.
+//
+//Two drivers, or one driver before and after a change in draw order, rarely agree to the bit:
+//rasterization rules, filtering and blending round differently. So pixels are compared by their
+//perceived difference, not their bytes. The difference is the distance in YIQ space weighted the
+//way the eye weights brightness and the two chroma axes (Kotsarenko and Ramos, as used by
+//pixelmatch), scaled so 1 is black against white. A pixel is off when it exceeds `threshold`, and
+//the image passes while the off pixels stay under `maxMismatchFraction` of the total.
+struct ImageComparison {
+	bool sizeMatches = false;
+	size_t mismatched = 0;
+	size_t total = 0;
+	float maxDifference = 0.0f;
+	Image difference; //off pixels in red over a faded copy of the reference
+
+	bool passes(float maxMismatchFraction) const {
+		return sizeMatches && mismatched <= (size_t)(maxMismatchFraction * total);
+	}
+};
+
+class GoldenImage {
+
+public:
+
+	static ImageComparison compare(const Image& reference, const Image& rendered, float threshold) {
+
+		ImageComparison result;
+		if (reference.width != rendered.width || reference.height != rendered.height)
+			return result;
+
+		result.sizeMatches = true;
+		result.total = (size_t)reference.width * reference.height;
+		result.difference = Image(reference.width, reference.height);
+
+		for (size_t i = 0; i < result.total; i++) {
+			const unsigned char* a = &reference.pixels[i * 4];
+			const unsigned char* b = &rendered.pixels[i * 4];
+			unsigned char* out = &result.difference.pixels[i * 4];
+
+			float difference = perceivedDifference(a, b);
+			if (difference > result.maxDifference)
+				result.maxDifference = difference;
+
+			if (difference > threshold) {
+				result.mismatched++;
+				out[0] = 255; out[1] = 0; out[2] = 0;
+			}
+			else {
+				unsigned char faded = (unsigned char)(192 + luma(a) / 4.0f);
+				out[0] = out[1] = out[2] = faded;
+			}
+			out[3] = 255;
+		}
+		return result;
+	}
+
+	//0 for the same color, 1 for black against white
+	static float perceivedDifference(const unsigned char* a, const unsigned char* b) {
+		float r = (float)a[0] - b[0], g = (float)a[1] - b[1], bl = (float)a[2] - b[2];
+		float y = r * 0.29889531f + g * 0.58662247f + bl * 0.11448223f;
+		float i = r * 0.59597799f - g * 0.27417610f - bl * 0.32180189f;
+		float q = r * 0.21147017f - g * 0.52261711f + bl * 0.31114694f;
+		float delta = 0.5053f * y * y + 0.299f * i * i + 0.1957f * q * q;
+		return delta / 35215.0f; //the delta of black against white
+	}
+
+private:
+
+	static float luma(const unsigned char* pixel) {
+		return pixel[0] * 0.29889531f + pixel[1] * 0.58662247f + pixel[2] * 0.11448223f;
+	}
+};
+#endif
@@ -0,0 +1,207 @@
+#pragma once
+
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#ifdef HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include <cstring>
+#include <iostream>
+
+
+//A GL context with no window on screen, rendering into its own framebuffer object.
+//
+//Built with HEADLESS_EGL, which the Headless|x64 configuration defines along with linking
+//libEGL.lib from $(EGLDir), it is an EGL surfaceless context (Mesa llvmpipe runs it on machines
+//without a GPU or a display server). Otherwise it falls back to a hidden GLFW window, which still
+//needs a desktop session but never shows anything. Either way the default framebuffer is unused:
+//everything is drawn into the color and depth renderbuffers made by create().
+class HeadlessContext {
+
+public:
+
+	HeadlessContext() : width(0), height(0), framebuffer(0), colorBuffer(0), depthBuffer(0), window(NULL)
+#ifdef HEADLESS_EGL
+		, display(EGL_NO_DISPLAY), context(EGL_NO_CONTEXT)
+#endif
+	{}
+
+	//make a core profile context of at least major.minor current, load glad and bind the framebuffer
+	bool create(int targetWidth, int targetHeight, int major, int minor) {
+
+		width = targetWidth;
+		height = targetHeight;
+
+		if (!createContext(major, minor))
+			return false;
+
+		if (!gladLoadGLLoader(getLoader())) {
+			std::cout << "ERROR::HEADLESS_CONTEXT::GLAD_NOT_LOADED" << std::endl;
+			destroy();
+			return false;
+		}
+
+		glGenRenderbuffers(1, &colorBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+		glGenRenderbuffers(1, &depthBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+
+		glGenFramebuffers(1, &framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			std::cout << "ERROR::HEADLESS_CONTEXT::FRAMEBUFFER_INCOMPLETE" << std::endl;
+			destroy();
+			return false;
+		}
+		glViewport(0, 0, width, height);
+		return true;
+	}
+
+	//the proc address function for glad and loadGLExtensions
+	GLADloadproc getLoader() const {
+#ifdef HEADLESS_EGL
+		return &eglLoad;
+#else
+		return (GLADloadproc)glfwGetProcAddress;
+#endif
+	}
+
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+	unsigned int getFramebuffer() const { return framebuffer; }
+
+	//llvmpipe, softpipe, SwiftShader, Microsoft's GDI fallback: images are right, but frame times say
+	//nothing about a GPU, so time budgets are not held against them. Asks the current context.
+	static bool isSoftwareRenderer() {
+		const char* renderer = (const char*)glGetString(GL_RENDERER);
+		if (renderer == NULL)
+			return false;
+		static const char* const software[] = { "llvmpipe", "softpipe", "SwiftShader", "Software Rasterizer", "GDI Generic" };
+		for (const char* name : software) {
+			if (strstr(renderer, name))
+				return true;
+		}
+		return false;
+	}
+
+	//read the color buffer back, bottom row first, 4 bytes per pixel
+	void readPixels(unsigned char* rgba) const {
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+	}
+
+	void destroy() {
+		if (framebuffer) {
+			glDeleteFramebuffers(1, &framebuffer);
+			glDeleteRenderbuffers(1, &colorBuffer);
+			glDeleteRenderbuffers(1, &depthBuffer);
+			framebuffer = colorBuffer = depthBuffer = 0;
+		}
+#ifdef HEADLESS_EGL
+		if (display != EGL_NO_DISPLAY) {
+			eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+			if (context != EGL_NO_CONTEXT)
+				eglDestroyContext(display, context);
+			eglTerminate(display);
+			display = EGL_NO_DISPLAY;
+			context = EGL_NO_CONTEXT;
+		}
+#else
+		if (window) {
+			glfwDestroyWindow(window);
+			glfwTerminate();
+			window = NULL;
+		}
+#endif
+	}
+
+private:
+
+	int width, height;
+	unsigned int framebuffer;
+	unsigned int colorBuffer;
+	unsigned int depthBuffer;
+	GLFWwindow* window;
+
+#ifdef HEADLESS_EGL
+	EGLDisplay display;
+	EGLContext context;
+
+	static void* eglLoad(const char* name) {
+		return (void*)eglGetProcAddress(name);
+	}
+
+	bool createContext(int major, int minor) {
+
+		//the surfaceless platform needs no X or Wayland; plain EGL_DEFAULT_DISPLAY is the fallback
+		PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (getPlatformDisplay)
+			display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+		if (display == EGL_NO_DISPLAY)
+			display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+		if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL)) {
+			std::cout << "ERROR::HEADLESS_CONTEXT::EGL_DISPLAY_NOT_INITIALIZED" << std::endl;
+			display = EGL_NO_DISPLAY;
+			return false;
+		}
+
+		if (!eglBindAPI(EGL_OPENGL_API)) {
+			std::cout << "ERROR::HEADLESS_CONTEXT::EGL_NO_OPENGL_API" << std::endl;
+			destroy();
+			return false;
+		}
+
+		//nothing is ever drawn to an EGL surface, so a context without a config will do when the
+		//surfaceless platform offers no configs at all
+		EGLint configAttributes[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+		EGLConfig config = EGL_NO_CONFIG_KHR;
+		EGLint configCount = 0;
+		if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0)
+			config = EGL_NO_CONFIG_KHR;
+
+		EGLint contextAttributes[] = {
+			EGL_CONTEXT_MAJOR_VERSION, major,
+			EGL_CONTEXT_MINOR_VERSION, minor,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE
+		};
+		context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+		if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+			std::cout << "ERROR::HEADLESS_CONTEXT::EGL_CONTEXT_NOT_CREATED " << major << "." << minor << std::endl;
+			destroy();
+			return false;
+		}
+		return true;
+	}
+#else
+	bool createContext(int major, int minor) {
+
+		glfwInit();
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, major);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, minor);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+		window = glfwCreateWindow(width, height, "Headless", NULL, NULL);
+		if (window == NULL) {
+			std::cout << "ERROR::HEADLESS_CONTEXT::WINDOW_NOT_CREATED " << major << "." << minor << std::endl;
+			glfwTerminate();
+			return false;
+		}
+		glfwMakeContextCurrent(window);
+		return true;
+	}
+#endif
+};
+#endif
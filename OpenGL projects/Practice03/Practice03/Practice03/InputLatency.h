@@ -0,0 +1,243 @@
+#pragma once
+
+#ifndef INPUT_LATENCY_H
+#define INPUT_LATENCY_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "MemoryTracker.h"
+
+#include <fstream>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+
+
+enum InputKind {
+	INPUT_MOUSE, //cursor moved; applied to the camera in the callback, seen when the view matrix is built
+	INPUT_KEY,   //a key the app reacts to went down or up; seen by the next processInput
+	INPUT_KIND_COUNT
+};
+
+
+//How long input takes to reach the screen, measured the way GLFW's tests/inputlag.c thinks about it.
+//
+//Every event is stamped with glfwGetTimerValue in its callback, so the clock starts when glfw
+//hands the event over, not when the loop gets around to it. consume() marks where the app
+//actually uses that kind of input: the event belongs to the frame being built at that moment.
+//Events nothing consumed yet stay pending, so a key press that lands on a frame that runs no
+//fixed step waits for the next one, and that wait shows up in the numbers.
+//
+//Two latencies are kept per event:
+//  input to submit  - up to beforeSwap(), when the frame is handed to the driver
+//  input to present - up to the fence placed right after glfwSwapBuffers signaling, i.e. the GPU
+//                     having finished the frame and the swap. Fences are polled without waiting,
+//                     at every beforeSwap() and afterSwap(), so a present time is late by at most
+//                     the gap between polls; frames still in flight at exit are waited for.
+//
+//Compare the two to see where latency comes from: submit is the CPU side (polling order, fixed
+//steps), the difference is queueing in the driver and the swap chain (vsync, frames in flight).
+class InputLatency {
+
+public:
+
+	InputLatency() : enabled(false), frequency(1), frameIndex(0), droppedSamples(0) {}
+
+	//needs glfwInit(); events are ignored until this runs
+	void enable() {
+		enabled = true;
+		frequency = glfwGetTimerFrequency();
+	}
+
+	bool isEnabled() const { return enabled; }
+
+	//from the glfw callback, as early as possible
+	void recordEvent(InputKind kind) {
+		if (!enabled)
+			return;
+		uint64_t now = glfwGetTimerValue();
+		MemoryTagScope tag(MEMORY_TAG_TOOLS);
+		pending.push_back(Event { kind, now, NOT_CONSUMED });
+	}
+
+	//where the app applies input of this kind; everything of that kind so far is in this frame
+	void consume(InputKind kind) {
+		for (Event& event : pending) {
+			if (event.kind == kind && event.frame == NOT_CONSUMED)
+				event.frame = frameIndex;
+		}
+	}
+
+	//right before glfwSwapBuffers: the frame's commands are all issued
+	void beforeSwap() {
+		if (!enabled)
+			return;
+		uint64_t now = glfwGetTimerValue();
+		pollFences();
+
+		MemoryTagScope tag(MEMORY_TAG_TOOLS);
+		Frame frame;
+		frame.submitTimer = now;
+		frame.fence = 0;
+		for (size_t i = 0; i < pending.size();) {
+			if (pending[i].frame == frameIndex) {
+				frame.events.push_back(pending[i]);
+				pending[i] = pending.back();
+				pending.pop_back();
+			}
+			else
+				i++;
+		}
+		inFlight.push_back(frame);
+	}
+
+	//right after glfwSwapBuffers: the fence signals once the GPU is through the frame and the swap
+	void afterSwap() {
+		if (!enabled)
+			return;
+		if (!inFlight.empty() && inFlight.back().fence == 0)
+			inFlight.back().fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glFlush(); //the fence has to reach the GPU before polling it can ever succeed
+		pollFences();
+		frameIndex++;
+	}
+
+	//waits out the frames still in flight, then drops the fences; needs the context. The samples
+	//stay for printReport() and writeEvents().
+	void destroy() {
+		for (Frame& frame : inFlight) {
+			if (frame.fence) {
+				glClientWaitSync(frame.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+				complete(frame, glfwGetTimerValue());
+				glDeleteSync(frame.fence);
+			}
+		}
+		inFlight.clear();
+	}
+
+	void printReport() const {
+		if (!enabled)
+			return;
+		static const char* names[INPUT_KIND_COUNT] = { "mouse", "key" };
+		std::cout << "INPUT_LATENCY::FRAMES " << frameIndex << ", events never consumed " << pending.size();
+		if (droppedSamples)
+			std::cout << ", " << droppedSamples << " events past the sample limit not kept";
+		std::cout << std::endl;
+		for (int kind = 0; kind < INPUT_KIND_COUNT; kind++) {
+			std::vector<double> submit, present;
+			for (const Sample& sample : samples) {
+				if (sample.kind != kind)
+					continue;
+				submit.push_back(sample.submitMilliseconds);
+				present.push_back(sample.presentMilliseconds);
+			}
+			printDistribution(names[kind], "to submit ", submit);
+			printDistribution(names[kind], "to present", present);
+		}
+	}
+
+	//one line per event, for plotting against frame pacing settings
+	bool writeEvents(const char* path) const {
+		std::ofstream out(path);
+		if (!out.is_open()) {
+			std::cout << "ERROR::INPUT_LATENCY::FILE_NOT_OPENED " << path << std::endl;
+			return false;
+		}
+		static const char* names[INPUT_KIND_COUNT] = { "mouse", "key" };
+		out << "kind,frame,submit_ms,present_ms\n";
+		for (const Sample& sample : samples)
+			out << names[sample.kind] << "," << sample.frame << "," << sample.submitMilliseconds << "," << sample.presentMilliseconds << "\n";
+		return true;
+	}
+
+private:
+
+	static const uint64_t NOT_CONSUMED = ~0ull;
+	static const size_t MAX_SAMPLES = 1 << 20; //over a quarter hour of 1000 Hz mouse input, 32 MB
+
+	struct Event {
+		InputKind kind;
+		uint64_t timer;
+		uint64_t frame;
+	};
+
+	struct Frame {
+		uint64_t submitTimer;
+		GLsync fence;
+		std::vector<Event> events;
+	};
+
+	struct Sample {
+		InputKind kind;
+		uint64_t frame;
+		double submitMilliseconds;
+		double presentMilliseconds;
+	};
+
+	bool enabled;
+	uint64_t frequency;
+	uint64_t frameIndex;
+	size_t droppedSamples;
+	std::vector<Event> pending;
+	std::deque<Frame> inFlight; //oldest first; fences signal in order
+	std::vector<Sample> samples;
+
+	void pollFences() {
+		uint64_t now = glfwGetTimerValue();
+		while (!inFlight.empty() && inFlight.front().fence) {
+			GLenum status = glClientWaitSync(inFlight.front().fence, 0, 0);
+			if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+				break;
+			complete(inFlight.front(), now);
+			glDeleteSync(inFlight.front().fence);
+			inFlight.pop_front();
+		}
+	}
+
+	void complete(const Frame& frame, uint64_t presentTimer) {
+		MemoryTagScope tag(MEMORY_TAG_TOOLS);
+		for (const Event& event : frame.events) {
+			if (samples.size() >= MAX_SAMPLES) {
+				droppedSamples++;
+				continue;
+			}
+			Sample sample;
+			sample.kind = event.kind;
+			sample.frame = event.frame;
+			sample.submitMilliseconds = milliseconds(frame.submitTimer - event.timer);
+			sample.presentMilliseconds = milliseconds(presentTimer - event.timer);
+			samples.push_back(sample);
+		}
+	}
+
+	double milliseconds(uint64_t timer) const {
+		return (double)timer * 1000.0 / frequency;
+	}
+
+	static void printDistribution(const char* kind, const char* stage, std::vector<double>& values) {
+		if (values.empty()) {
+			std::cout << "INPUT_LATENCY::" << kind << " " << stage << " no events" << std::endl;
+			return;
+		}
+		std::sort(values.begin(), values.end());
+		double total = 0.0;
+		for (double value : values)
+			total += value;
+		std::cout << "INPUT_LATENCY::" << kind << " " << stage << " " << values.size() << " events"
+			<< " mean " << total / values.size() << " ms"
+			<< " min " << values.front()
+			<< " p50 " << percentile(values, 0.50)
+			<< " p95 " << percentile(values, 0.95)
+			<< " p99 " << percentile(values, 0.99)
+			<< " max " << values.back() << std::endl;
+	}
+
+	static double percentile(const std::vector<double>& sorted, double fraction) {
+		size_t index = (size_t)(fraction * (sorted.size() - 1) + 0.5);
+		return sorted[index];
+	}
+};
+#endif
@@ -0,0 +1,615 @@
+#pragma once
+
+#ifndef PERF_HUD_H
+#define PERF_HUD_H
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+
+//What the app knows about its own frame; anything left at -1 shows as "-".
+struct HUDCounters {
+	long long drawCalls = -1;
+	long long triangles = -1;
+	long long stateChanges = -1;
+	long long cpuMemoryBytes = -1;
+	long long gpuMemoryBytes = -1;
+};
+
+
+//In-app performance overlay: a scrolling CPU/GPU frame time graph, frame time percentiles and
+//the counters the app hands it, drawn in the top left corner.
+//
+//All of it is one glDrawArrays of textured quads. Text comes from a 5x7 bitmap font baked into a
+//small R8 atlas by init(); the graph and the panel sample a solid cell of the same atlas, so there
+//is one program, one texture and one vertex buffer. The CPU time of a frame runs from beginFrame()
+//to render(); the GPU time comes from timestamp queries around the same span, read back
+//QUERY_LATENCY frames later so the HUD never waits on the GPU.
+//
+//Its own cost is bounded and shown on its last line: the quad count has a fixed cap, the text is
+//rebuilt a few times a second, and while hidden it issues two timestamp queries a frame and does
+//nothing else. render() puts back the GL state it changes.
+class PerfHUD {
+
+public:
+
+	static const int HISTORY = 240;      //frames in the graph and the percentiles
+	static const int MAX_QUADS = 2048;
+	static const int QUERY_LATENCY = 4;  //frames between issuing a timestamp and reading it
+	static const int LINE_COUNT = 5;
+	static const int LINE_LENGTH = 160;
+
+	PerfHUD() : visible(false), keyHeld(false), scale(2), program(0), vertexArray(0), vertexBuffer(0), atlas(0), screenLocation(-1),
+		frames(0), hudCpuMs(0.0), hudGpuMs(0.0), lastQuads(0) {
+		memset(queries, 0, sizeof(queries));
+		memset(issued, 0, sizeof(issued));
+		std::fill(frameMs, frameMs + HISTORY, -1.0f);
+		std::fill(cpuMs, cpuMs + HISTORY, -1.0f);
+		std::fill(gpuMs, gpuMs + HISTORY, -1.0f);
+		memset(lines, 0, sizeof(lines));
+	}
+
+	//needs a current context; call after gladLoadGLLoader
+	bool init();
+	void destroy();
+
+	//feed it the toggle key every input poll; it flips on the press, not while the key is held
+	void handleToggleKey(bool pressed) {
+		if (pressed && !keyHeld)
+			visible = !visible;
+		keyHeld = pressed;
+	}
+
+	void setVisible(bool show) { visible = show; }
+	bool isVisible() const { return visible; }
+
+	//screen pixels per font pixel
+	void setScale(int pixels) { scale = std::max(1, pixels); }
+
+	//first thing in the frame
+	void beginFrame();
+
+	void setCounters(const HUDCounters& frameCounters) { counters = frameCounters; }
+
+	//last thing before the swap, with the size of the framebuffer being drawn to
+	void render(int width, int height);
+
+	double getOwnCpuMs() const { return hudCpuMs; }
+	double getOwnGpuMs() const { return hudGpuMs; }
+
+private:
+
+	typedef std::chrono::steady_clock Clock;
+
+	static const int GLYPH_WIDTH = 5, GLYPH_HEIGHT = 7;
+	static const int CELL_WIDTH = 6, CELL_HEIGHT = 8;
+	static const int ATLAS_COLUMNS = 16, ATLAS_ROWS = 5; //64 glyphs and the solid cell
+	static const int FIRST_GLYPH = 32, GLYPH_COUNT = 64; //space to underscore; lower case draws as upper case
+
+	struct Vertex {
+		float x, y;
+		float u, v;
+		uint32_t color; //RGBA, a byte each
+	};
+
+	//timestamps per frame: frame start, frame end (which is also the HUD's start), HUD end
+	enum { QUERY_FRAME_START, QUERY_FRAME_END, QUERY_HUD_END, QUERIES_PER_FRAME };
+
+	//the GL state render() and init() change, to put back afterwards
+	struct SavedState {
+		GLint program, vertexArray, arrayBuffer, activeTexture, texture, unpackAlignment;
+		GLint viewport[4];
+		GLint blendSourceRGB, blendDestinationRGB, blendSourceAlpha, blendDestinationAlpha;
+		GLboolean blend, depthTest, cullFace, scissorTest;
+
+		void save() {
+			glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+			glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &vertexArray);
+			glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &arrayBuffer);
+			glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture);
+			glActiveTexture(GL_TEXTURE0);
+			glGetIntegerv(GL_TEXTURE_BINDING_2D, &texture);
+			glGetIntegerv(GL_UNPACK_ALIGNMENT, &unpackAlignment);
+			glGetIntegerv(GL_VIEWPORT, viewport);
+			glGetIntegerv(GL_BLEND_SRC_RGB, &blendSourceRGB);
+			glGetIntegerv(GL_BLEND_DST_RGB, &blendDestinationRGB);
+			glGetIntegerv(GL_BLEND_SRC_ALPHA, &blendSourceAlpha);
+			glGetIntegerv(GL_BLEND_DST_ALPHA, &blendDestinationAlpha);
+			blend = glIsEnabled(GL_BLEND);
+			depthTest = glIsEnabled(GL_DEPTH_TEST);
+			cullFace = glIsEnabled(GL_CULL_FACE);
+			scissorTest = glIsEnabled(GL_SCISSOR_TEST);
+		}
+
+		void restore() const {
+			setEnabled(GL_BLEND, blend);
+			setEnabled(GL_DEPTH_TEST, depthTest);
+			setEnabled(GL_CULL_FACE, cullFace);
+			setEnabled(GL_SCISSOR_TEST, scissorTest);
+			glBlendFuncSeparate(blendSourceRGB, blendDestinationRGB, blendSourceAlpha, blendDestinationAlpha);
+			glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment);
+			glBindTexture(GL_TEXTURE_2D, texture);
+			glActiveTexture(activeTexture);
+			glBindBuffer(GL_ARRAY_BUFFER, arrayBuffer);
+			glBindVertexArray(vertexArray);
+			glUseProgram(program);
+		}
+
+		static void setEnabled(GLenum capability, GLboolean enabled) {
+			if (enabled)
+				glEnable(capability);
+			else
+				glDisable(capability);
+		}
+	};
+
+	bool visible;
+	bool keyHeld;
+	int scale;
+
+	GLuint program;
+	GLuint vertexArray;
+	GLuint vertexBuffer;
+	GLuint atlas;
+	GLint screenLocation;
+	GLuint queries[QUERY_LATENCY][QUERIES_PER_FRAME];
+	bool issued[QUERY_LATENCY][QUERIES_PER_FRAME];
+
+	//frame f lives at f % HISTORY; -1 until known
+	unsigned int frames; //begun so far
+	Clock::time_point frameStart;
+	Clock::time_point lastTextUpdate;
+	float frameMs[HISTORY];
+	float cpuMs[HISTORY];
+	float gpuMs[HISTORY];
+
+	HUDCounters counters;
+	char lines[LINE_COUNT][LINE_LENGTH];
+
+	std::vector<Vertex> vertices; //never grows past MAX_QUADS * 6
+	double hudCpuMs;
+	double hudGpuMs;
+	int lastQuads;
+
+	static const unsigned char* glyphRows(int glyph) {
+		static const unsigned char font[GLYPH_COUNT][GLYPH_HEIGHT] = {
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, //space
+		{ 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04 }, //!
+		{ 0x0a, 0x0a, 0x0a, 0x00, 0x00, 0x00, 0x00 }, //"
+		{ 0x0a, 0x0a, 0x1f, 0x0a, 0x1f, 0x0a, 0x0a }, //#
+		{ 0x04, 0x0f, 0x14, 0x0e, 0x05, 0x1e, 0x04 }, //$
+		{ 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 }, //%
+		{ 0x0c, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0d }, //&
+		{ 0x04, 0x04, 0x08, 0x00, 0x00, 0x00, 0x00 }, //'
+		{ 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02 }, //(
+		{ 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08 }, //)
+		{ 0x00, 0x04, 0x15, 0x0e, 0x15, 0x04, 0x00 }, //*
+		{ 0x00, 0x04, 0x04, 0x1f, 0x04, 0x04, 0x00 }, //+
+		{ 0x00, 0x00, 0x00, 0x00, 0x0c, 0x04, 0x08 }, //,
+		{ 0x00, 0x00, 0x00, 0x1f, 0x00, 0x00, 0x00 }, //-
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x0c }, //.
+		{ 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 }, ///
+		{ 0x0e, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0e }, //0
+		{ 0x04, 0x0c, 0x04, 0x04, 0x04, 0x04, 0x0e }, //1
+		{ 0x0e, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1f }, //2
+		{ 0x1f, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0e }, //3
+		{ 0x02, 0x06, 0x0a, 0x12, 0x1f, 0x02, 0x02 }, //4
+		{ 0x1f, 0x10, 0x1e, 0x01, 0x01, 0x11, 0x0e }, //5
+		{ 0x06, 0x08, 0x10, 0x1e, 0x11, 0x11, 0x0e }, //6
+		{ 0x1f, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 }, //7
+		{ 0x0e, 0x11, 0x11, 0x0e, 0x11, 0x11, 0x0e }, //8
+		{ 0x0e, 0x11, 0x11, 0x0f, 0x01, 0x02, 0x0c }, //9
+		{ 0x00, 0x0c, 0x0c, 0x00, 0x0c, 0x0c, 0x00 }, //:
+		{ 0x00, 0x0c, 0x0c, 0x00, 0x0c, 0x04, 0x08 }, //;
+		{ 0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02 }, //<
+		{ 0x00, 0x00, 0x1f, 0x00, 0x1f, 0x00, 0x00 }, //=
+		{ 0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08 }, //>
+		{ 0x0e, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 }, //?
+		{ 0x0e, 0x11, 0x01, 0x0d, 0x15, 0x15, 0x0e }, //@
+		{ 0x0e, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11 }, //A
+		{ 0x1e, 0x11, 0x11, 0x1e, 0x11, 0x11, 0x1e }, //B
+		{ 0x0e, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0e }, //C
+		{ 0x1c, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1c }, //D
+		{ 0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x1f }, //E
+		{ 0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x10 }, //F
+		{ 0x0e, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0f }, //G
+		{ 0x11, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11 }, //H
+		{ 0x0e, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0e }, //I
+		{ 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0c }, //J
+		{ 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 }, //K
+		{ 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1f }, //L
+		{ 0x11, 0x1b, 0x15, 0x15, 0x11, 0x11, 0x11 }, //M
+		{ 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 }, //N
+		{ 0x0e, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e }, //O
+		{ 0x1e, 0x11, 0x11, 0x1e, 0x10, 0x10, 0x10 }, //P
+		{ 0x0e, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0d }, //Q
+		{ 0x1e, 0x11, 0x11, 0x1e, 0x14, 0x12, 0x11 }, //R
+		{ 0x0f, 0x10, 0x10, 0x0e, 0x01, 0x01, 0x1e }, //S
+		{ 0x1f, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 }, //T
+		{ 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e }, //U
+		{ 0x11, 0x11, 0x11, 0x11, 0x11, 0x0a, 0x04 }, //V
+		{ 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0a }, //W
+		{ 0x11, 0x11, 0x0a, 0x04, 0x0a, 0x11, 0x11 }, //X
+		{ 0x11, 0x11, 0x11, 0x0a, 0x04, 0x04, 0x04 }, //Y
+		{ 0x1f, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1f }, //Z
+		{ 0x0e, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0e }, //[
+		{ 0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00 }, //backslash
+		{ 0x0e, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0e }, //]
+		{ 0x04, 0x0a, 0x11, 0x00, 0x00, 0x00, 0x00 }, //^
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1f }, //_
+		};
+		return font[glyph];
+	}
+
+	static uint32_t rgba(unsigned int r, unsigned int g, unsigned int b, unsigned int a) {
+		return r | (g << 8) | (b << 16) | (a << 24);
+	}
+
+	void quad(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1, uint32_t color) {
+		if (vertices.size() + 6 > (size_t)MAX_QUADS * 6)
+			return;
+		Vertex corners[4] = {
+			{ x0, y0, u0, v0, color }, { x1, y0, u1, v0, color },
+			{ x1, y1, u1, v1, color }, { x0, y1, u0, v1, color }
+		};
+		vertices.push_back(corners[0]);
+		vertices.push_back(corners[1]);
+		vertices.push_back(corners[2]);
+		vertices.push_back(corners[0]);
+		vertices.push_back(corners[2]);
+		vertices.push_back(corners[3]);
+	}
+
+	void solid(float x0, float y0, float x1, float y1, uint32_t color) {
+		//middle of the solid cell, which sits after the glyphs
+		float u = (GLYPH_COUNT % ATLAS_COLUMNS * CELL_WIDTH + 2.5f) / (ATLAS_COLUMNS * CELL_WIDTH);
+		float v = (GLYPH_COUNT / ATLAS_COLUMNS * CELL_HEIGHT + 3.5f) / (ATLAS_ROWS * CELL_HEIGHT);
+		quad(x0, y0, x1, y1, u, v, u, v, color);
+	}
+
+	//returns the x after the last character
+	float text(float x, float y, const char* string, uint32_t color) {
+		float atlasWidth = (float)(ATLAS_COLUMNS * CELL_WIDTH), atlasHeight = (float)(ATLAS_ROWS * CELL_HEIGHT);
+		for (const char* c = string; *c; c++) {
+			int character = (*c >= 'a' && *c <= 'z') ? *c - 'a' + 'A' : *c;
+			int glyph = character - FIRST_GLYPH;
+			if (glyph > 0 && glyph < GLYPH_COUNT) {
+				float u = (float)(glyph % ATLAS_COLUMNS * CELL_WIDTH), v = (float)(glyph / ATLAS_COLUMNS * CELL_HEIGHT);
+				quad(x, y, x + GLYPH_WIDTH * scale, y + GLYPH_HEIGHT * scale,
+					u / atlasWidth, v / atlasHeight, (u + GLYPH_WIDTH) / atlasWidth, (v + GLYPH_HEIGHT) / atlasHeight, color);
+			}
+			x += CELL_WIDTH * scale;
+		}
+		return x;
+	}
+
+	static void formatCount(char* out, size_t size, long long value) {
+		if (value < 0)
+			snprintf(out, size, "-");
+		else if (value >= 10000000)
+			snprintf(out, size, "%.1fM", value / 1.0e6);
+		else if (value >= 100000)
+			snprintf(out, size, "%.1fK", value / 1.0e3);
+		else
+			snprintf(out, size, "%lld", value);
+	}
+
+	static void formatBytes(char* out, size_t size, long long value) {
+		if (value < 0)
+			snprintf(out, size, "-");
+		else
+			snprintf(out, size, "%.1f MB", value / (1024.0 * 1024.0));
+	}
+
+	//nearest rank over the known samples of a history ring; -1 when there are none
+	static float percentile(const float* history, float fraction) {
+		float sorted[HISTORY];
+		int count = 0;
+		for (int i = 0; i < HISTORY; i++) {
+			if (history[i] >= 0.0f)
+				sorted[count++] = history[i];
+		}
+		if (count == 0)
+			return -1.0f;
+		std::sort(sorted, sorted + count);
+		int index = (int)(count * fraction);
+		return sorted[index < count ? index : count - 1];
+	}
+
+	static float mean(const float* history) {
+		float total = 0.0f;
+		int count = 0;
+		for (int i = 0; i < HISTORY; i++) {
+			if (history[i] >= 0.0f) {
+				total += history[i];
+				count++;
+			}
+		}
+		return count ? total / count : -1.0f;
+	}
+
+	void updateText();
+	void buildQuads();
+	void readQueries(unsigned int frame);
+};
+
+
+inline bool PerfHUD::init() {
+
+	const char* vertexSource =
+		"#version 330 core\n"
+		"layout (location = 0) in vec2 position;\n"
+		"layout (location = 1) in vec2 texCoord;\n"
+		"layout (location = 2) in vec4 color;\n"
+		"uniform vec2 screen;\n"
+		"out vec2 uv;\n"
+		"out vec4 tint;\n"
+		"void main() {\n"
+		"    uv = texCoord;\n"
+		"    tint = color;\n"
+		"    gl_Position = vec4(position.x / screen.x * 2.0 - 1.0, 1.0 - position.y / screen.y * 2.0, 0.0, 1.0);\n"
+		"}\n";
+	const char* fragmentSource =
+		"#version 330 core\n"
+		"uniform sampler2D atlas;\n"
+		"in vec2 uv;\n"
+		"in vec4 tint;\n"
+		"out vec4 FragColor;\n"
+		"void main() {\n"
+		"    FragColor = vec4(tint.rgb, tint.a * texture(atlas, uv).r);\n"
+		"}\n";
+
+	GLuint shaders[2] = { glCreateShader(GL_VERTEX_SHADER), glCreateShader(GL_FRAGMENT_SHADER) };
+	const char* sources[2] = { vertexSource, fragmentSource };
+	program = glCreateProgram();
+	for (int i = 0; i < 2; i++) {
+		glShaderSource(shaders[i], 1, &sources[i], NULL);
+		glCompileShader(shaders[i]);
+		glAttachShader(program, shaders[i]);
+	}
+	glLinkProgram(program);
+	glDeleteShader(shaders[0]);
+	glDeleteShader(shaders[1]);
+
+	GLint linked = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (!linked) {
+		char infoLog[512];
+		glGetProgramInfoLog(program, 512, NULL, infoLog);
+		std::cout << "ERROR::PERF_HUD::PROGRAM_NOT_LINKED\n" << infoLog << std::endl;
+		glDeleteProgram(program);
+		program = 0;
+		return false;
+	}
+	screenLocation = glGetUniformLocation(program, "screen");
+
+	SavedState saved;
+	saved.save();
+
+	glUseProgram(program);
+	glUniform1i(glGetUniformLocation(program, "atlas"), 0);
+
+	//----font atlas: one byte per texel, glyphs in 6x8 cells, then a solid cell for the graph and panel
+	const int atlasWidth = ATLAS_COLUMNS * CELL_WIDTH, atlasHeight = ATLAS_ROWS * CELL_HEIGHT;
+	std::vector<unsigned char> texels((size_t)atlasWidth * atlasHeight, 0);
+	for (int glyph = 0; glyph <= GLYPH_COUNT; glyph++) {
+		int cellX = glyph % ATLAS_COLUMNS * CELL_WIDTH, cellY = glyph / ATLAS_COLUMNS * CELL_HEIGHT;
+		for (int y = 0; y < GLYPH_HEIGHT; y++) {
+			for (int x = 0; x < GLYPH_WIDTH; x++) {
+				bool set = glyph == GLYPH_COUNT || (glyphRows(glyph)[y] >> (GLYPH_WIDTH - 1 - x) & 1);
+				texels[(size_t)(cellY + y) * atlasWidth + cellX + x] = set ? 255 : 0;
+			}
+		}
+	}
+	glGenTextures(1, &atlas);
+	glBindTexture(GL_TEXTURE_2D, atlas);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, atlasWidth, atlasHeight, 0, GL_RED, GL_UNSIGNED_BYTE, texels.data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	//----vertices are rewritten every frame
+	glGenVertexArrays(1, &vertexArray);
+	glGenBuffers(1, &vertexBuffer);
+	glBindVertexArray(vertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(MAX_QUADS * 6 * sizeof(Vertex)), NULL, GL_STREAM_DRAW);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, x));
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, u));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void*)offsetof(Vertex, color));
+	glEnableVertexAttribArray(2);
+
+	saved.restore();
+
+	glGenQueries(QUERY_LATENCY * QUERIES_PER_FRAME, &queries[0][0]);
+	vertices.reserve((size_t)MAX_QUADS * 6);
+	lastTextUpdate = Clock::now();
+	return true;
+}
+
+inline void PerfHUD::destroy() {
+	if (!program)
+		return;
+	glDeleteQueries(QUERY_LATENCY * QUERIES_PER_FRAME, &queries[0][0]);
+	glDeleteBuffers(1, &vertexBuffer);
+	glDeleteVertexArrays(1, &vertexArray);
+	glDeleteTextures(1, &atlas);
+	glDeleteProgram(program);
+	program = vertexArray = vertexBuffer = atlas = 0;
+	std::vector<Vertex>().swap(vertices);
+}
+
+inline void PerfHUD::beginFrame() {
+
+	if (!program)
+		return;
+
+	Clock::time_point now = Clock::now();
+	if (frames > 0)
+		frameMs[(frames - 1) % HISTORY] = std::chrono::duration<float, std::milli>(now - frameStart).count();
+	frameStart = now;
+
+	//the slot this frame reuses belonged to the frame QUERY_LATENCY back
+	if (frames >= QUERY_LATENCY)
+		readQueries(frames - QUERY_LATENCY);
+
+	unsigned int slot = frames % QUERY_LATENCY;
+	frameMs[frames % HISTORY] = cpuMs[frames % HISTORY] = gpuMs[frames % HISTORY] = -1.0f;
+	issued[slot][QUERY_FRAME_END] = issued[slot][QUERY_HUD_END] = false;
+	glQueryCounter(queries[slot][QUERY_FRAME_START], GL_TIMESTAMP);
+	issued[slot][QUERY_FRAME_START] = true;
+	frames++;
+}
+
+inline void PerfHUD::readQueries(unsigned int frame) {
+
+	unsigned int slot = frame % QUERY_LATENCY;
+	if (!issued[slot][QUERY_FRAME_START] || !issued[slot][QUERY_FRAME_END])
+		return;
+
+	//results come in order, so the last one being there means all are; if not, skip the frame
+	GLuint last = queries[slot][issued[slot][QUERY_HUD_END] ? QUERY_HUD_END : QUERY_FRAME_END];
+	GLint available = 0;
+	glGetQueryObjectiv(last, GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+		return;
+
+	GLuint64 start = 0, end = 0;
+	glGetQueryObjectui64v(queries[slot][QUERY_FRAME_START], GL_QUERY_RESULT, &start);
+	glGetQueryObjectui64v(queries[slot][QUERY_FRAME_END], GL_QUERY_RESULT, &end);
+	gpuMs[frame % HISTORY] = (float)((end - start) / 1.0e6);
+	if (issued[slot][QUERY_HUD_END]) {
+		GLuint64 hudEnd = 0;
+		glGetQueryObjectui64v(queries[slot][QUERY_HUD_END], GL_QUERY_RESULT, &hudEnd);
+		hudGpuMs = (hudEnd - end) / 1.0e6;
+	}
+}
+
+inline void PerfHUD::render(int width, int height) {
+
+	if (!program || frames == 0 || width <= 0 || height <= 0)
+		return;
+
+	Clock::time_point start = Clock::now();
+	unsigned int frame = frames - 1;
+	unsigned int slot = frame % QUERY_LATENCY;
+	cpuMs[frame % HISTORY] = std::chrono::duration<float, std::milli>(start - frameStart).count();
+	glQueryCounter(queries[slot][QUERY_FRAME_END], GL_TIMESTAMP);
+	issued[slot][QUERY_FRAME_END] = true;
+
+	if (!visible)
+		return;
+
+	if (std::chrono::duration<double>(start - lastTextUpdate).count() >= 0.25 || lines[0][0] == 0) {
+		updateText();
+		lastTextUpdate = start;
+	}
+	vertices.clear();
+	buildQuads();
+
+	SavedState saved;
+	saved.save();
+
+	glViewport(0, 0, width, height);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_CULL_FACE);
+	glDisable(GL_SCISSOR_TEST);
+	glEnable(GL_BLEND);
+	glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+	glUseProgram(program);
+	glUniform2f(screenLocation, (float)width, (float)height);
+	glBindTexture(GL_TEXTURE_2D, atlas); //unit 0, made active by save()
+	glBindVertexArray(vertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(MAX_QUADS * 6 * sizeof(Vertex)), NULL, GL_STREAM_DRAW); //orphan last frame's
+	glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)(vertices.size() * sizeof(Vertex)), vertices.data());
+	glDrawArrays(GL_TRIANGLES, 0, (GLsizei)vertices.size());
+
+	saved.restore();
+
+	glQueryCounter(queries[slot][QUERY_HUD_END], GL_TIMESTAMP);
+	issued[slot][QUERY_HUD_END] = true;
+
+	lastQuads = (int)(vertices.size() / 6);
+	hudCpuMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+inline void PerfHUD::updateText() {
+
+	float p50 = percentile(frameMs, 0.50f), p95 = percentile(frameMs, 0.95f), p99 = percentile(frameMs, 0.99f);
+	float averageFrame = mean(frameMs);
+	snprintf(lines[0], LINE_LENGTH, "FPS %.0f   FRAME P50 %.2f  P95 %.2f  P99 %.2f MS",
+		averageFrame > 0.0f ? 1000.0f / averageFrame : 0.0f, p50, p95, p99);
+	snprintf(lines[1], LINE_LENGTH, "CPU %.2f MS", mean(cpuMs));
+	snprintf(lines[2], LINE_LENGTH, "GPU %.2f MS", mean(gpuMs));
+
+	char draws[16], triangles[16], states[16], cpuMemory[24], gpuMemory[24];
+	formatCount(draws, sizeof(draws), counters.drawCalls);
+	formatCount(triangles, sizeof(triangles), counters.triangles);
+	formatCount(states, sizeof(states), counters.stateChanges);
+	formatBytes(cpuMemory, sizeof(cpuMemory), counters.cpuMemoryBytes);
+	formatBytes(gpuMemory, sizeof(gpuMemory), counters.gpuMemoryBytes);
+	snprintf(lines[3], LINE_LENGTH, "DRAWS %s  TRIS %s  STATE %s  MEM %s  GPU MEM %s", draws, triangles, states, cpuMemory, gpuMemory);
+	snprintf(lines[4], LINE_LENGTH, "HUD %.3f MS CPU  %.3f MS GPU  %d/%d QUADS", hudCpuMs, hudGpuMs, lastQuads, MAX_QUADS);
+}
+
+inline void PerfHUD::buildQuads() {
+
+	const uint32_t white = rgba(235, 235, 235, 255), grey = rgba(150, 150, 150, 255);
+	const uint32_t cpuColor = rgba(90, 220, 110, 255), gpuColor = rgba(250, 160, 60, 255);
+
+	float margin = 4.0f * scale;
+	float lineHeight = (CELL_HEIGHT + 2.0f) * scale;
+	float graphWidth = HISTORY * 2.0f;
+	float graphHeight = 30.0f * scale;
+	float textWidth = 0.0f;
+	for (int i = 0; i < LINE_COUNT; i++)
+		textWidth = std::max(textWidth, (float)strlen(lines[i]) * CELL_WIDTH * scale);
+	float panelWidth = std::max(textWidth, graphWidth) + 2.0f * margin;
+	float panelHeight = 4 * lineHeight + margin * 3.0f + graphHeight + lineHeight;
+
+	//----panel, then text
+	solid(0.0f, 0.0f, panelWidth, panelHeight, rgba(0, 0, 0, 170));
+	float x = margin, y = margin;
+	text(x, y, lines[0], white);
+	y += lineHeight;
+	float next = text(x, y, lines[1], cpuColor);
+	text(next + 2.0f * CELL_WIDTH * scale, y, lines[2], gpuColor);
+	y += lineHeight;
+	text(x, y, lines[3], white);
+	y += lineHeight;
+	text(x, y, lines[4], grey);
+	y += lineHeight + margin;
+
+	//----graph: two columns per frame, CPU then GPU, oldest on the left; 0 to 33.3 ms tall
+	const float graphMs = 1000.0f / 30.0f;
+	float bottom = y + graphHeight;
+	solid(x, y, x + graphWidth, bottom, rgba(255, 255, 255, 25));
+	unsigned int shown = std::min(frames, (unsigned int)HISTORY);
+	for (unsigned int i = 0; i < shown; i++) {
+		unsigned int frame = frames - shown + i;
+		float column = x + (HISTORY - shown + i) * 2.0f;
+		float cpu = cpuMs[frame % HISTORY], gpu = gpuMs[frame % HISTORY];
+		if (cpu >= 0.0f)
+			solid(column, bottom - graphHeight * std::min(cpu / graphMs, 1.0f), column + 1.0f, bottom, cpuColor);
+		if (gpu >= 0.0f)
+			solid(column + 1.0f, bottom - graphHeight * std::min(gpu / graphMs, 1.0f), column + 2.0f, bottom, gpuColor);
+	}
+	float target = bottom - graphHeight * (1000.0f / 60.0f) / graphMs; //the 60 Hz line
+	solid(x, target, x + graphWidth, target + 1.0f, rgba(255, 255, 255, 120));
+}
+#endif
@@ -4,23 +4,43 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <string>
+#include <algorithm>
 #include "Shader.h"
+#include "FrameScheduler.h"
+#include "GLInterceptor.h"
+#include "GLMemoryHooks.h"
+#include "MemoryTracker.h"
+#include "GLCapture.h"
+#include "GLReplay.h"
+#include "HeadlessContext.h"
+#include "GoldenImage.h"
+#include "PerfHUD.h"
+#include "InputLatency.h"
 #include "stb_image.h"
 
 //Method Declaration
 
 //----input forward declaration
-void processInput(GLFWwindow* window);
+void processInput(GLFWwindow* window, float stepSeconds);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
+
+//----golden image and budget check of a captured trace; frameBudgetMs < 0 picks the default
+int runRegression(const char* tracePath, const char* referencePath, bool updateReference, double frameBudgetMs);
 
 //Variable Declaration
 
-//----Time
-float deltaTime = 0.0f; //I've done enough work in Unity to know what this is lol.
-float lastFrame = 0.0f;
+//----Simulation
+double cubeAngle = 0.0;         //degrees, advanced once per fixed step
+double previousCubeAngle = 0.0; //state before the last step, for interpolation
 
 //----Camera Manipulation
 glm::vec3 cameraPos = glm::vec3(0.0f, 0.0f, 3.0f);
+glm::vec3 previousCameraPos = cameraPos;
 glm::vec3 cameraFront = glm::vec3(0.0f, 0.0f, -1.0f);
 glm::vec3 cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
 
@@ -32,7 +52,74 @@ float lastY = 600;
 
 bool firstMouse = true;
 
-int main() {
+//----performance overlay, F3 shows and hides it
+PerfHUD perfHUD;
+
+//----time from each input event to the frame that shows it (--input-latency)
+InputLatency inputLatency;
+
+int main(int argc, char** argv) {
+
+    //----optional switches
+    bool glStats = false;      //count every GL call per frame (prints a histogram on exit)
+    bool memoryReport = false; //heap and GL object accounting (prints totals and leaks on exit)
+    const char* capturePath = NULL; //--capture <trace>: record every GL call until the window closes
+    const char* replayPath = NULL;  //--replay <trace> [frames.csv]: play a trace back headless and exit
+    const char* frameTimesPath = NULL;
+    bool regress = false;           //--regress [trace] [reference.ppm] [frame budget ms]: replay, compare the last frame, check budgets
+    const char* regressPath = "golden/practice03.trace";
+    const char* referencePath = "golden/practice03.ppm";
+    double regressFrameBudgetMs = -1.0; //0 turns the time budget off
+    bool updateReference = false;   //--update-references: record the reference from the replay instead of comparing
+    bool measureInputLatency = false; //--input-latency [events.csv]: input to submit and to present, printed on exit
+    const char* inputEventsPath = NULL;
+    for (int i = 1; i < argc; i++) {
+        glStats = glStats || strcmp(argv[i], "--gl-stats") == 0;
+        memoryReport = memoryReport || strcmp(argv[i], "--memory") == 0;
+        if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc)
+            capturePath = argv[++i];
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                frameTimesPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--regress") == 0) {
+            regress = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                regressPath = argv[++i];
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                referencePath = argv[++i];
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                regressFrameBudgetMs = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--update-references") == 0)
+            updateReference = true;
+        else if (strcmp(argv[i], "--input-latency") == 0) {
+            measureInputLatency = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                inputEventsPath = argv[++i];
+        }
+    }
+
+    if (regress)
+        return runRegression(regressPath, referencePath, updateReference, regressFrameBudgetMs);
+
+    //----replay needs none of the app: no window, no input, no assets
+    if (replayPath) {
+        HeadlessContext headless;
+        if (!headless.create(1600, 1200, 3, 3))
+            return -1;
+        GLReplay replay;
+        bool replayed = replay.open(replayPath) && replay.run();
+        if (replayed) {
+            replay.printReport();
+            if (frameTimesPath)
+                replay.writeFrameTimes(frameTimesPath);
+        }
+        replay.destroy();
+        headless.destroy();
+        return replayed ? 0 : -1;
+    }
 
     //----initialize glfw library and set contexts
     glfwInit();
@@ -54,6 +141,11 @@ int main() {
     glfwSetCursorPosCallback(window, mouse_callback);
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
+    //----keys are still read with glfwGetKey; the callback only timestamps them
+    glfwSetKeyCallback(window, key_callback);
+    if (measureInputLatency)
+        inputLatency.enable();
+
     //----initialize GLAD
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
     {
@@ -61,6 +153,25 @@ int main() {
         return -1;
     }
 
+    //----GL object sizes are always tracked; the interceptor's per call counters are opt-in
+    glMemoryHooks().install();
+    if (glStats) {
+        glInterceptor().timeCalls = true;
+        glInterceptor().install();
+    }
+
+    //----installed over the interceptor so it records what the app calls, and comes off first
+    if (capturePath) {
+        MemoryTagScope tag(MEMORY_TAG_TOOLS);
+        glCapture().start(capturePath);
+    }
+
+    //----leaks are whatever is allocated from here on and still alive at exit; what glfw and the
+    //----driver set up for the context is theirs
+    markMemoryBaseline();
+
+    perfHUD.init();
+
     //----Set Up the Viewport-------------------------------------------------------
         //----create the viewport. Viewport exists within the window.
     glViewport(0, 0, 1600, 1200);
@@ -71,7 +182,11 @@ int main() {
     //----register viewport resize callback
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
  
-    Shader practice03Shader("_vertexShader.vs", "_fragmentShader.fs");
+    //----built inside a lambda so only the shader's own allocations get the shader tag
+    Shader practice03Shader = [] {
+        MemoryTagScope tag(MEMORY_TAG_SHADER);
+        return Shader("_vertexShader.vs", "_fragmentShader.fs");
+    }();
 
     //----Create the rectangle's vertices
     float vertices[] = {
@@ -175,6 +290,7 @@ int main() {
     else {
         std::cout << "Failed to load texture 1" << std::endl;
     }
+    stbi_image_free(data);
 
 
     //--------TEXTURE 2-----------------------------------------
@@ -223,15 +339,34 @@ int main() {
 
 
 
+    //----simulation runs at a fixed 120 steps per second whatever the frame rate
+    FrameScheduler scheduler(120.0, 8);
+    scheduler.start();
+
     //----MAIN RENDER LOOP-----------------------------------------------------------------------
     while (!glfwWindowShouldClose(window))
     {
-        //----Calculate deltaTime
-        float currentFrame = glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
-        
-        processInput(window);
+        glInterceptor().beginFrame();
+        perfHUD.beginFrame();
+
+        //----Run the simulation steps that are due
+        unsigned int steps = scheduler.beginFrame();
+        float stepSeconds = (float)scheduler.getStepSeconds();
+        for (unsigned int step = 0; step < steps; step++) {
+            previousCameraPos = cameraPos;
+            previousCubeAngle = cubeAngle;
+
+            processInput(window, stepSeconds);
+            cubeAngle = fmod(cubeAngle + 50.0 * scheduler.getStepSeconds(), 360.0);
+        }
+
+        //----Render between the last two simulated states
+        float alpha = scheduler.getAlpha();
+        double angleStep = cubeAngle - previousCubeAngle;
+        if (angleStep < 0.0)
+            angleStep += 360.0; //wrapped around during the last step
+        float renderAngle = (float)(previousCubeAngle + angleStep * alpha);
+        glm::vec3 renderCameraPos = glm::mix(previousCameraPos, cameraPos, alpha);
 
         //----Define the color of the viewport when cleared
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
@@ -249,13 +384,14 @@ int main() {
 
         //----Model matrix
         glm::mat4 model = glm::mat4(1.0f);
-        model = glm::rotate(model, (float)glfwGetTime() * glm::radians(50.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        model = glm::rotate(model, glm::radians(renderAngle), glm::vec3(0.0f, 1.0f, 0.0f));
 
         int modelLoc = glGetUniformLocation(practice03Shader.ID, "model");
         glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
 
-        //----View matrix
-        glm::mat4 view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
+        //----View matrix (the mouse moved the camera as its events came in)
+        inputLatency.consume(INPUT_MOUSE);
+        glm::mat4 view = glm::lookAt(renderCameraPos, renderCameraPos + cameraFront, cameraUp);
         
         int viewLoc = glGetUniformLocation(practice03Shader.ID, "view");
         glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
@@ -266,14 +402,63 @@ int main() {
         glDrawArrays(GL_TRIANGLES, 0, 36);
 
 
+        //----GL counters come from the interceptor (--gl-stats), object sizes from the memory
+        //----hooks; the overlay stays out of captured traces
+        HUDCounters hudCounters;
+        if (glInterceptor().isInstalled()) {
+            const GLInterceptor::Counters& glCounters = glInterceptor().getLastFrame();
+            hudCounters.drawCalls = glCounters.drawCalls();
+            hudCounters.triangles = (long long)glCounters.triangles;
+            hudCounters.stateChanges = glCounters.kindCalls(GLInterceptor::KIND_STATE);
+        }
+        hudCounters.gpuMemoryBytes = 0;
+        for (int category = 0; category < GPU_MEMORY_CATEGORY_COUNT; category++)
+            hudCounters.gpuMemoryBytes += (long long)gpuMemory().getStats(category).liveBytes;
+        hudCounters.cpuMemoryBytes = 0;
+        for (int tag = 0; tag < MEMORY_TAG_COUNT; tag++)
+            hudCounters.cpuMemoryBytes += (long long)cpuMemory().getStats(tag).liveBytes;
+        perfHUD.setCounters(hudCounters);
+        if (!glCapture().isCapturing()) {
+            int framebufferWidth, framebufferHeight;
+            glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+            perfHUD.render(framebufferWidth, framebufferHeight);
+        }
+
+        glCapture().endFrame();
+
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
+        inputLatency.beforeSwap();
         glfwSwapBuffers(window);
+        inputLatency.afterSwap();
         glfwPollEvents();
     }
 
 
     //exit
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+    glDeleteTextures(1, &texture1);
+    glDeleteTextures(1, &texture2);
+    glDeleteProgram(practice03Shader.ID);
+    perfHUD.destroy();
+    inputLatency.destroy();
+    glCapture().stop();
+
+    if (glStats) {
+        glInterceptor().printLastFrame();
+        glInterceptor().printAverage();
+    }
+    if (memoryReport) {
+        printMemoryReport();
+        printMemoryLeaks();
+    }
+    inputLatency.printReport();
+    if (measureInputLatency && inputEventsPath)
+        inputLatency.writeEvents(inputEventsPath);
+    glInterceptor().uninstall();
+    glMemoryHooks().uninstall();
     glfwTerminate();
     return 0;
 }
@@ -283,12 +468,94 @@ int main() {
 
 
 
+int runRegression(const char* tracePath, const char* referencePath, bool updateReference, double frameBudgetMs) {
+
+    //----what the scene may cost: one textured cube is one draw, and 60 Hz with room to spare on a
+    //----GPU. A software rasterizer gets no time budget unless one is given; the draw budget always holds.
+    const unsigned int drawBudget = 1;
+
+    //----replayed at a fixed small size whatever the window was, which keeps the reference small
+    const int width = 640;
+    const int height = 480;
+
+    HeadlessContext headless;
+    if (!headless.create(width, height, 3, 3))
+        return -1;
+    std::cout << "REGRESSION::RENDERER " << (const char*)glGetString(GL_RENDERER) << std::endl;
+    if (frameBudgetMs < 0.0)
+        frameBudgetMs = HeadlessContext::isSoftwareRenderer() ? 0.0 : 16.0;
+
+    GLReplay replay;
+    replay.fitTo(width, height);
+    if (!replay.open(tracePath) || !replay.run()) {
+        replay.destroy();
+        headless.destroy();
+        return -1;
+    }
+    replay.printReport();
+
+    //----the last frame stays in the framebuffer; the reference is only recorded from it when asked,
+    //----a missing one is a failure
+    Image rendered(headless.getWidth(), headless.getHeight());
+    headless.readPixels(rendered.pixels.data());
+    replay.destroy();
+    headless.destroy();
+
+    bool imagePassed = true;
+    Image reference;
+    if (updateReference) {
+        imagePassed = rendered.writePPM(referencePath);
+        std::cout << "REGRESSION::IMAGE " << referencePath << (imagePassed ? " reference written" : " FAIL reference not writable") << std::endl;
+    }
+    else if (!reference.readPPM(referencePath)) {
+        imagePassed = false;
+        rendered.writePPM(std::string(referencePath) + ".actual.ppm");
+        std::cout << "REGRESSION::IMAGE " << referencePath << " FAIL reference missing; rerun with --update-references to record it" << std::endl;
+    }
+    else {
+        ImageComparison comparison = GoldenImage::compare(reference, rendered, 0.01f);
+        imagePassed = comparison.passes(0.001f);
+        std::cout << "REGRESSION::IMAGE " << referencePath << (imagePassed ? " ok " : " FAIL ") << comparison.mismatched << "/" << comparison.total
+            << " pixels off, max difference " << comparison.maxDifference << std::endl;
+        if (!imagePassed) {
+            rendered.writePPM(std::string(referencePath) + ".actual.ppm");
+            if (comparison.sizeMatches)
+                comparison.difference.writePPM(std::string(referencePath) + ".diff.ppm");
+        }
+    }
+
+    std::vector<double> frameMs = replay.getFrameMilliseconds();
+    const std::vector<unsigned int>& draws = replay.getFrameDrawCalls();
+    if (frameMs.empty()) {
+        std::cout << "REGRESSION::FAIL trace has no frames" << std::endl;
+        return 1;
+    }
+    std::sort(frameMs.begin(), frameMs.end());
+    double p95 = frameMs[std::min(frameMs.size() - 1, frameMs.size() * 95 / 100)];
+    unsigned int maxDraws = *std::max_element(draws.begin(), draws.end());
+    bool withinTime = frameBudgetMs <= 0.0 || p95 <= frameBudgetMs;
+    bool withinDraws = maxDraws <= drawBudget;
+    std::cout << "REGRESSION::BUDGET frame p95 " << p95 << " ms (budget ";
+    if (frameBudgetMs > 0.0)
+        std::cout << frameBudgetMs;
+    else
+        std::cout << "off";
+    std::cout << ")" << (withinTime ? "" : " OVER")
+        << ", draws " << maxDraws << " (budget " << drawBudget << ")" << (withinDraws ? "" : " OVER") << std::endl;
+
+    bool passed = imagePassed && withinTime && withinDraws;
+    std::cout << "REGRESSION::" << (passed ? "PASSED" : "FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
+
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
     glViewport(0, 0, width, height);
 }
-void processInput(GLFWwindow* window)
+void processInput(GLFWwindow* window, float stepSeconds)
 {
-    const float cameraSpeed = 3 * deltaTime;
+    const float cameraSpeed = 3 * stepSeconds;
+
+    inputLatency.consume(INPUT_KEY);
 
     if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
         cameraPos += cameraSpeed * cameraFront;
@@ -304,9 +571,21 @@ void processInput(GLFWwindow* window)
     }
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
+
+    perfHUD.handleToggleKey(glfwGetKey(window, GLFW_KEY_F3) == GLFW_PRESS);
+}
+void key_callback(GLFWwindow* /*window*/, int key, int /*scancode*/, int action, int /*mods*/) {
+
+    //only the keys processInput reacts to, and only changes of state
+    bool handled = key == GLFW_KEY_W || key == GLFW_KEY_A || key == GLFW_KEY_S || key == GLFW_KEY_D
+        || key == GLFW_KEY_ESCAPE || key == GLFW_KEY_F3;
+    if (handled && action != GLFW_REPEAT)
+        inputLatency.recordEvent(INPUT_KEY);
 }
 void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
 
+    inputLatency.recordEvent(INPUT_MOUSE);
+
     if (firstMouse) {
         lastX = xpos;
         lastY = ypos;
@@ -1,2 +1,9 @@
+#include "MemoryTracker.h"
+
+//image data is counted under its own tag
+#define STBI_MALLOC(size)          trackedMalloc(size, MEMORY_TAG_IMAGE)
+#define STBI_REALLOC(block, size)  trackedRealloc(block, size, MEMORY_TAG_IMAGE)
+#define STBI_FREE(block)           trackedFree(block)
+
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
\ No newline at end of file
@@ -0,0 +1,17 @@
+#include "../Practice04/GlmKernels.h"
+
+#if defined(_MSC_VER)
+#define GLM_KERNELS_EXPORT extern "C" __declspec(dllexport)
+#else
+#define GLM_KERNELS_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+//defined by GlmKernels_AVX2.cpp and GlmKernels_AVX2Aligned.cpp, both in this DLL
+GlmKernelSet glmKernelsAVX2();
+GlmKernelSet glmKernelsAVX2Aligned();
+
+//the one export, looked up by loadGlmKernelsAVX2()
+GLM_KERNELS_EXPORT void glmKernelsAVX2Sets(GlmKernelSet* plain, GlmKernelSet* aligned) {
+	*plain = glmKernelsAVX2();
+	*aligned = glmKernelsAVX2Aligned();
+}
@@ -0,0 +1,6 @@
+#define GLM_FORCE_AVX2
+#define GLM_KERNELS_NAMESPACE glmAVX2
+#define GLM_KERNELS_NAME "avx2"
+#define GLM_KERNELS_FACTORY glmKernelsAVX2
+#define GLM_KERNELS_NEEDS_AVX2 true
+#include "../Practice04/GlmKernels.h"
@@ -0,0 +1,7 @@
+#define GLM_FORCE_AVX2
+#define GLM_FORCE_ALIGNED
+#define GLM_KERNELS_NAMESPACE glmAVX2Aligned
+#define GLM_KERNELS_NAME "avx2+aligned"
+#define GLM_KERNELS_FACTORY glmKernelsAVX2Aligned
+#define GLM_KERNELS_NEEDS_AVX2 true
+#include "../Practice04/GlmKernels.h"
@@ -0,0 +1,371 @@
+#pragma once
+
+#ifndef BENCHMARK_RUNNER_H
+#define BENCHMARK_RUNNER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/constants.hpp>
+#include "HeadlessContext.h"
+#include "GLExtensions.h"
+#include "GLStateCache.h"
+#include "Shader.h"
+#include "StaticBatch.h"
+#include "RenderQueue.h"
+#include "FrustumCulling.h"
+#include "IndirectRenderer.h"
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+
+struct BenchmarkOptions {
+	std::string scene = "cubes";       //"cubes" or "gpu-driven"
+	unsigned int frames = 500;         //measured frames
+	unsigned int warmupFrames = 30;    //rendered first and thrown away
+	int width = 1280;
+	int height = 720;
+	std::string output = "benchmark.json";
+};
+
+
+//Renders a named scene offscreen for a fixed number of frames and writes the timings as JSON.
+//
+//The camera follows a script indexed by frame number, never by wall time, so every run draws
+//exactly the same frames and two runs can be compared number for number. Each frame is finished
+//with glFinish before the next starts: that gives up CPU/GPU overlap, but the time of a frame is
+//then the time of that frame alone. Per frame it records the whole frame, the CPU submission part,
+//the GPU part from a GL_TIME_ELAPSED query, the draw calls and the state changes that reached GL.
+//
+//Scenes: "cubes" draws a grid of cubes through the frustum culler and the render queue, one draw
+//per visible cube; "gpu-driven" draws the same grid with the IndirectRenderer (needs GL 4.3).
+class BenchmarkRunner {
+
+	friend class RegressionRunner; //renders the same scenes to check images and budgets
+
+public:
+
+	static const int GRID_X = 32, GRID_Y = 8, GRID_Z = 32;
+
+	static bool isScene(const std::string& name) {
+		return name == "cubes" || name == "gpu-driven";
+	}
+
+	//0 on success, like main()
+	static int run(const BenchmarkOptions& options) {
+
+		if (!isScene(options.scene)) {
+			std::cout << "ERROR::BENCHMARK::UNKNOWN_SCENE " << options.scene << std::endl;
+			return -1;
+		}
+		bool gpuDriven = options.scene == "gpu-driven";
+
+		HeadlessContext context;
+		if (!context.create(options.width, options.height, gpuDriven ? 4 : 3, 3))
+			return -1;
+		loadGLExtensions(context.getLoader());
+		if (gpuDriven && !IndirectRenderer::isSupported()) {
+			std::cout << "ERROR::BENCHMARK::GPU_DRIVEN_NEEDS_GL_4_3" << std::endl;
+			context.destroy();
+			return -1;
+		}
+
+		std::vector<FrameSample> samples;
+		std::string renderer = (const char*)glGetString(GL_RENDERER);
+		unsigned int objectCount = 0;
+		{
+			Scene scene(gpuDriven);
+			objectCount = scene.objectCount;
+
+			for (unsigned int frame = 0; frame < options.warmupFrames + options.frames; frame++) {
+				FrameSample sample = scene.render(frame % options.frames, options.frames, (float)options.width / options.height);
+				if (frame >= options.warmupFrames)
+					samples.push_back(sample);
+			}
+			scene.destroy();
+		}
+		context.destroy();
+
+		if (!writeReport(options, renderer, objectCount, samples))
+			return -1;
+		printSummary(options, samples);
+		return 0;
+	}
+
+private:
+
+	struct FrameSample {
+		double frameMs;
+		double cpuMs;
+		double gpuMs;
+		unsigned int drawCalls;
+		unsigned int objectsDrawn;
+		unsigned int stateChanges;
+	};
+
+	//everything a benchmark scene owns; made and destroyed inside the headless context
+	struct Scene {
+
+		bool gpuDriven;
+		unsigned int objectCount;
+		Shader shader;
+		Shader* indirectShader;
+		BufferArena vertexArena;
+		BufferArena indexArena;
+		BufferArena uniformArena;   //the queue's per-object model matrices
+		BufferArena* instanceArena; //gpu-driven only
+		StaticBatchSet batches;
+		BatchedMesh cube;
+		IndirectRenderer* indirect;
+		CullingSet cullingSet;
+		std::vector<glm::mat4> models;
+		std::vector<unsigned int> visible;
+		RenderQueue queue;
+		GLStateCache state;
+		GLuint timer;
+
+		Scene(bool useGpuDriven)
+			: gpuDriven(useGpuDriven), objectCount(0), shader("_vertexShader.vs", "_fragmentShader.fs"), indirectShader(NULL),
+			  vertexArena(GL_ARRAY_BUFFER, 1 << 16), indexArena(GL_ELEMENT_ARRAY_BUFFER, 1 << 16),
+			  uniformArena(GL_UNIFORM_BUFFER, 8 << 20, uniformAlignment()), instanceArena(NULL), indirect(NULL), timer(0) {
+
+			//unit cube, positions only, which is all _vertexShader.vs reads
+			float vertices[] = {
+				-0.5f, -0.5f, -0.5f,   0.5f, -0.5f, -0.5f,   0.5f,  0.5f, -0.5f,  -0.5f,  0.5f, -0.5f,
+				-0.5f, -0.5f,  0.5f,   0.5f, -0.5f,  0.5f,   0.5f,  0.5f,  0.5f,  -0.5f,  0.5f,  0.5f
+			};
+			unsigned int indices[] = {
+				0, 2, 1, 0, 3, 2,   4, 5, 6, 4, 6, 7,   0, 4, 7, 0, 7, 3,
+				1, 2, 6, 1, 6, 5,   0, 1, 5, 0, 5, 4,   3, 7, 6, 3, 6, 2
+			};
+			VertexFormat format = { 3, { { 0, 3, 0 } } };
+			cube = batches.addMesh(format, vertices, 8, indices, 36);
+			batches.build(vertexArena, indexArena);
+
+			for (int x = 0; x < GRID_X; x++) {
+				for (int y = 0; y < GRID_Y; y++) {
+					for (int z = 0; z < GRID_Z; z++) {
+						glm::vec3 position((x - GRID_X / 2) * 2.0f, (y - GRID_Y / 2) * 2.0f, (z - GRID_Z / 2) * 2.0f);
+						models.push_back(glm::translate(glm::mat4(1.0f), position));
+						cullingSet.addSphere(position, 0.866f);
+					}
+				}
+			}
+			objectCount = (unsigned int)models.size();
+
+			if (gpuDriven) {
+				//96 bytes of object, 20 of command and 4 of index per cube
+				instanceArena = new BufferArena(GL_SHADER_STORAGE_BUFFER, 2 << 20, IndirectRenderer::instanceGranularity());
+				indirect = new IndirectRenderer(batches.batches[cube.batch], *instanceArena);
+				indirectShader = new Shader("_indirectVertexShader.vs", "_fragmentShader.fs");
+				StaticBatch::Range range = batches.batches[cube.batch].getRange(cube.mesh);
+				for (const glm::mat4& model : models)
+					indirect->addObject(range, model, glm::vec3(0.0f), 0.866f);
+			}
+
+			RenderQueue::bindObjectBlock(shader.ID);
+			glGenQueries(1, &timer);
+			state.invalidate();
+			state.setDepthTest(true);
+		}
+
+		static unsigned int uniformAlignment() {
+			GLint alignment = 256;
+			glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+			return (unsigned int)alignment;
+		}
+
+		//orbit around the grid, one full turn over the measured frames
+		static glm::mat4 scriptedView(unsigned int frame, unsigned int frames) {
+			float angle = glm::two_pi<float>() * frame / frames;
+			glm::vec3 eye(std::cos(angle) * 60.0f, 12.0f + 8.0f * std::sin(angle * 2.0f), std::sin(angle) * 60.0f);
+			return glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		}
+
+		FrameSample render(unsigned int frame, unsigned int frames, float aspect) {
+
+			typedef std::chrono::high_resolution_clock Clock;
+			Clock::time_point start = Clock::now();
+
+			FrameSample sample = {};
+			state.beginFrame();
+			glBeginQuery(GL_TIME_ELAPSED, timer);
+
+			state.clearColor(0.2f, 0.3f, 0.3f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			glm::mat4 view = scriptedView(frame, frames);
+			glm::mat4 projection = glm::perspective(glm::radians(45.0f), aspect, 0.1f, 200.0f);
+
+			unsigned int program = gpuDriven ? indirectShader->ID : shader.ID;
+			state.useProgram(program);
+			glUniformMatrix4fv(glGetUniformLocation(program, "view"), 1, GL_FALSE, glm::value_ptr(view));
+			glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+			glUniform3f(glGetUniformLocation(program, "objectColor"), 1.0f, 0.5f, 0.31f);
+			glUniform3f(glGetUniformLocation(program, "lightColor"), 1.0f, 1.0f, 1.0f);
+
+			if (gpuDriven) {
+				indirect->draw(state, projection * view, program);
+				sample.drawCalls = 1; //objectsDrawn is read back once the frame is finished, below
+			}
+			else {
+				cullingSet.cullSpheres(Frustum::fromMatrix(projection * view), visible);
+
+				const StaticBatch& batch = batches.batches[cube.batch];
+				StaticBatch::Range range = batch.getRange(cube.mesh);
+				int modelLocation = glGetUniformLocation(program, "model");
+				queue.clear();
+				for (unsigned int object : visible) {
+					RenderCommand command = {
+						RenderKey::opaque(0, program, 0, batch.getVAO(), 0.0f),
+						program, batch.getVAO(), 0,
+						modelLocation, queue.addTransform(models[object]),
+						range.firstIndex, range.count, range.baseVertex, true
+					};
+					queue.push(command);
+				}
+				queue.sort();
+				queue.uploadTransforms(uniformArena);
+				queue.execute(state);
+				sample.drawCalls = (unsigned int)visible.size();
+				sample.objectsDrawn = (unsigned int)visible.size();
+			}
+
+			glEndQuery(GL_TIME_ELAPSED);
+			Clock::time_point submitted = Clock::now();
+			glFinish();
+			Clock::time_point finished = Clock::now();
+
+			GLuint64 gpuNanoseconds = 0;
+			glGetQueryObjectui64v(timer, GL_QUERY_RESULT, &gpuNanoseconds);
+
+			//the GPU is idle after glFinish, so reading the culled commands back stalls nothing
+			//and stays out of the timings
+			if (gpuDriven)
+				sample.objectsDrawn = indirect->readDrawnCount();
+
+			sample.cpuMs = std::chrono::duration<double, std::milli>(submitted - start).count();
+			sample.frameMs = std::chrono::duration<double, std::milli>(finished - start).count();
+			sample.gpuMs = gpuNanoseconds / 1.0e6;
+			sample.stateChanges = state.getCurrentFrame().totalIssued();
+			return sample;
+		}
+
+		void destroy() {
+			if (indirect) {
+				indirect->destroy();
+				delete indirect;
+				delete indirectShader;
+				indirect = NULL;
+				instanceArena->destroy();
+				delete instanceArena;
+				instanceArena = NULL;
+			}
+			batches.destroy();
+			queue.releaseTransforms();
+			uniformArena.destroy();
+			vertexArena.destroy();
+			indexArena.destroy();
+			glDeleteProgram(shader.ID);
+			glDeleteQueries(1, &timer);
+		}
+	};
+
+	struct Summary {
+		double min, p50, p90, p95, p99, max, mean;
+	};
+
+	template <typename Field>
+	static Summary summarize(const std::vector<FrameSample>& samples, Field field) {
+		std::vector<double> values;
+		for (const FrameSample& sample : samples)
+			values.push_back((double)(sample.*field));
+		std::sort(values.begin(), values.end());
+
+		double total = 0.0;
+		for (double value : values)
+			total += value;
+
+		//nearest rank
+		size_t count = values.size();
+		Summary summary;
+		summary.min = values.front();
+		summary.max = values.back();
+		summary.mean = total / count;
+		summary.p50 = values[std::min(count - 1, count * 50 / 100)];
+		summary.p90 = values[std::min(count - 1, count * 90 / 100)];
+		summary.p95 = values[std::min(count - 1, count * 95 / 100)];
+		summary.p99 = values[std::min(count - 1, count * 99 / 100)];
+		return summary;
+	}
+
+	static void writeSummary(std::ostream& out, const char* name, const Summary& summary) {
+		out << "    \"" << name << "\": { \"min\": " << summary.min << ", \"p50\": " << summary.p50
+			<< ", \"p90\": " << summary.p90 << ", \"p95\": " << summary.p95 << ", \"p99\": " << summary.p99
+			<< ", \"max\": " << summary.max << ", \"mean\": " << summary.mean << " }";
+	}
+
+	static bool writeReport(const BenchmarkOptions& options, const std::string& renderer, unsigned int objectCount, const std::vector<FrameSample>& samples) {
+
+		std::ofstream out(options.output.c_str(), std::ios::out | std::ios::trunc);
+		if (!out.is_open() || samples.empty()) {
+			std::cout << "ERROR::BENCHMARK::REPORT_NOT_WRITTEN " << options.output << std::endl;
+			return false;
+		}
+
+		out << "{\n";
+		out << "  \"scene\": \"" << options.scene << "\",\n";
+		out << "  \"renderer\": \"" << renderer << "\",\n";
+		out << "  \"width\": " << options.width << ",\n";
+		out << "  \"height\": " << options.height << ",\n";
+		out << "  \"frames\": " << samples.size() << ",\n";
+		out << "  \"warmupFrames\": " << options.warmupFrames << ",\n";
+		out << "  \"objects\": " << objectCount << ",\n";
+		out << "  \"summary\": {\n";
+		writeSummary(out, "frameMs", summarize(samples, &FrameSample::frameMs));
+		out << ",\n";
+		writeSummary(out, "cpuMs", summarize(samples, &FrameSample::cpuMs));
+		out << ",\n";
+		writeSummary(out, "gpuMs", summarize(samples, &FrameSample::gpuMs));
+		out << ",\n";
+		writeSummary(out, "drawCalls", summarize(samples, &FrameSample::drawCalls));
+		out << ",\n";
+		writeSummary(out, "objectsDrawn", summarize(samples, &FrameSample::objectsDrawn));
+		out << ",\n";
+		writeSummary(out, "stateChanges", summarize(samples, &FrameSample::stateChanges));
+		out << "\n  },\n";
+
+		//frame by frame, columns in this order
+		out << "  \"columns\": [\"frameMs\", \"cpuMs\", \"gpuMs\", \"drawCalls\", \"objectsDrawn\", \"stateChanges\"],\n";
+		out << "  \"samples\": [\n";
+		for (size_t i = 0; i < samples.size(); i++) {
+			const FrameSample& sample = samples[i];
+			out << "    [" << sample.frameMs << ", " << sample.cpuMs << ", " << sample.gpuMs << ", "
+				<< sample.drawCalls << ", " << sample.objectsDrawn << ", " << sample.stateChanges << "]"
+				<< (i + 1 < samples.size() ? ",\n" : "\n");
+		}
+		out << "  ]\n}\n";
+		return true;
+	}
+
+	static void printSummary(const BenchmarkOptions& options, const std::vector<FrameSample>& samples) {
+		Summary frame = summarize(samples, &FrameSample::frameMs);
+		Summary cpu = summarize(samples, &FrameSample::cpuMs);
+		Summary gpu = summarize(samples, &FrameSample::gpuMs);
+		Summary draws = summarize(samples, &FrameSample::drawCalls);
+		std::cout << "BENCHMARK::" << options.scene << " " << samples.size() << " frames at " << options.width << "x" << options.height << std::endl;
+		std::cout << "    frame ms: p50 " << frame.p50 << " p95 " << frame.p95 << " p99 " << frame.p99 << " max " << frame.max << std::endl;
+		std::cout << "    cpu ms:   p50 " << cpu.p50 << " p95 " << cpu.p95 << " p99 " << cpu.p99 << std::endl;
+		std::cout << "    gpu ms:   p50 " << gpu.p50 << " p95 " << gpu.p95 << " p99 " << gpu.p99 << std::endl;
+		std::cout << "    draws:    mean " << draws.mean << " max " << draws.max << std::endl;
+		std::cout << "    written to " << options.output << std::endl;
+	}
+};
+#endif
@@ -0,0 +1,653 @@
+#pragma once
+
+#ifndef BUFFER_ARENA_H
+#define BUFFER_ARENA_H
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <cstdint>
+#include <cmath>
+#include <string>
+#include <iostream>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+
+//bit helpers used by the allocator's bin lookup
+inline unsigned int countLeadingZeros(unsigned int value) {
+#ifdef _MSC_VER
+	unsigned long index;
+	return _BitScanReverse(&index, value) ? 31 - index : 32;
+#else
+	return value ? __builtin_clz(value) : 32;
+#endif
+}
+
+inline unsigned int countTrailingZeros(unsigned int value) {
+#ifdef _MSC_VER
+	unsigned long index;
+	return _BitScanForward(&index, value) ? index : 32;
+#else
+	return value ? __builtin_ctz(value) : 32;
+#endif
+}
+
+
+//O(1) two-level segregated fit (TLSF) allocator over an abstract range of units.
+//It only hands out offsets, so it can manage any kind of memory, GL buffers included.
+//Sizes are binned as tiny floats (5 bit exponent, 3 bit mantissa): a 32 bit top level mask
+//picks the exponent and an 8 bit mask per exponent picks the mantissa, so finding a free
+//block that fits is two bit scans. Freed blocks merge with free neighbours immediately.
+class OffsetAllocator {
+
+public:
+
+	static const unsigned int NO_SPACE = 0xffffffff;
+
+	struct Allocation {
+		unsigned int offset;
+		unsigned int node;
+	};
+
+	struct Stats {
+		unsigned int capacity;
+		unsigned int usedUnits;
+		unsigned int freeUnits;
+		unsigned int largestFreeRegion;
+		unsigned int allocationCount;
+		unsigned int freeRegionCount;
+	};
+
+	OffsetAllocator(unsigned int capacityUnits = 0) {
+		reset(capacityUnits);
+	}
+
+	//forget every allocation and start over with a single free block
+	void reset(unsigned int capacityUnits) {
+
+		capacity = capacityUnits;
+		freeUnits = 0;
+		allocationCount = 0;
+		freeRegionCount = 0;
+
+		usedBinsTop = 0;
+		for (unsigned int i = 0; i < TOP_BINS; i++)
+			usedBins[i] = 0;
+		for (unsigned int i = 0; i < BIN_COUNT; i++)
+			binHeads[i] = NO_SPACE;
+
+		nodes.clear();
+		unusedNodes.clear();
+
+		if (capacity > 0)
+			insertFreeNode(0, capacity);
+	}
+
+	//returns offset NO_SPACE when nothing fits
+	Allocation allocate(unsigned int size) {
+
+		Allocation failed = { NO_SPACE, NO_SPACE };
+		if (size == 0 || size > capacity)
+			return failed;
+
+		//smallest bin whose every block is guaranteed to fit the request
+		unsigned int minBin = binRoundUp(size);
+		unsigned int minTop = minBin >> LEAF_BITS;
+		unsigned int minLeaf = minBin & LEAF_MASK;
+
+		unsigned int top = minTop;
+		unsigned int leaf = NO_SPACE;
+
+		if (usedBinsTop & (1u << top))
+			leaf = lowestSetBitFrom(usedBins[top], minLeaf);
+
+		if (leaf == NO_SPACE) {
+			top = minTop + 1 < TOP_BINS ? lowestSetBitFrom(usedBinsTop, minTop + 1) : NO_SPACE;
+			if (top == NO_SPACE)
+				return failed;
+			leaf = countTrailingZeros(usedBins[top]);
+		}
+
+		unsigned int bin = (top << LEAF_BITS) | leaf;
+		unsigned int nodeIndex = binHeads[bin];
+		removeFromBin(nodeIndex);
+
+		Node& node = nodes[nodeIndex];
+		unsigned int remainder = node.size - size;
+		freeUnits -= node.size; //the remainder is added back when it is reinserted
+		node.size = size;
+		node.used = true;
+		allocationCount++;
+
+		//give the tail back as a new free block placed right after this one
+		if (remainder > 0) {
+			unsigned int tail = insertFreeNode(nodes[nodeIndex].offset + size, remainder);
+			Node& head = nodes[nodeIndex];
+			nodes[tail].neighborPrev = nodeIndex;
+			nodes[tail].neighborNext = head.neighborNext;
+			if (head.neighborNext != NO_SPACE)
+				nodes[head.neighborNext].neighborPrev = tail;
+			head.neighborNext = tail;
+		}
+
+		Allocation allocation = { nodes[nodeIndex].offset, nodeIndex };
+		return allocation;
+	}
+
+	void free(Allocation allocation) {
+
+		if (allocation.node == NO_SPACE)
+			return;
+
+		Node& node = nodes[allocation.node];
+		unsigned int offset = node.offset;
+		unsigned int size = node.size;
+		unsigned int prev = node.neighborPrev;
+		unsigned int next = node.neighborNext;
+
+		freeUnits += size;
+		allocationCount--;
+		releaseNode(allocation.node);
+
+		//merge with the free neighbours on both sides
+		if (prev != NO_SPACE && !nodes[prev].used) {
+			offset = nodes[prev].offset;
+			size += nodes[prev].size;
+			unsigned int prevPrev = nodes[prev].neighborPrev;
+			removeFromBin(prev);
+			releaseNode(prev);
+			prev = prevPrev;
+		}
+		if (next != NO_SPACE && !nodes[next].used) {
+			size += nodes[next].size;
+			unsigned int nextNext = nodes[next].neighborNext;
+			removeFromBin(next);
+			releaseNode(next);
+			next = nextNext;
+		}
+
+		freeUnits -= size; //insertFreeNode adds it back
+		unsigned int merged = insertFreeNode(offset, size);
+		nodes[merged].neighborPrev = prev;
+		nodes[merged].neighborNext = next;
+		if (prev != NO_SPACE)
+			nodes[prev].neighborNext = merged;
+		if (next != NO_SPACE)
+			nodes[next].neighborPrev = merged;
+	}
+
+	unsigned int sizeOf(Allocation allocation) const {
+		return allocation.node == NO_SPACE ? 0 : nodes[allocation.node].size;
+	}
+
+	Stats getStats() const {
+
+		Stats stats;
+		stats.capacity = capacity;
+		stats.freeUnits = freeUnits;
+		stats.usedUnits = capacity - freeUnits;
+		stats.allocationCount = allocationCount;
+		stats.freeRegionCount = freeRegionCount;
+		stats.largestFreeRegion = 0;
+
+		//the highest used bin holds the largest blocks
+		if (usedBinsTop) {
+			unsigned int top = 31 - countLeadingZeros(usedBinsTop);
+			unsigned int leaf = 31 - countLeadingZeros(usedBins[top]);
+			for (unsigned int node = binHeads[(top << LEAF_BITS) | leaf]; node != NO_SPACE; node = nodes[node].binNext)
+				stats.largestFreeRegion = std::max(stats.largestFreeRegion, nodes[node].size);
+		}
+		return stats;
+	}
+
+private:
+
+	static const unsigned int MANTISSA_BITS = 3;
+	static const unsigned int MANTISSA_VALUE = 1 << MANTISSA_BITS;
+	static const unsigned int MANTISSA_MASK = MANTISSA_VALUE - 1;
+	static const unsigned int LEAF_BITS = 3;
+	static const unsigned int LEAF_MASK = (1 << LEAF_BITS) - 1;
+	static const unsigned int TOP_BINS = 32;
+	static const unsigned int BIN_COUNT = TOP_BINS << LEAF_BITS;
+
+	struct Node {
+		unsigned int offset;
+		unsigned int size;
+		unsigned int binPrev;
+		unsigned int binNext;
+		unsigned int neighborPrev;
+		unsigned int neighborNext;
+		bool used;
+	};
+
+	unsigned int capacity;
+	unsigned int freeUnits;
+	unsigned int allocationCount;
+	unsigned int freeRegionCount;
+
+	unsigned int usedBinsTop;
+	unsigned char usedBins[TOP_BINS];
+	unsigned int binHeads[BIN_COUNT];
+
+	std::vector<Node> nodes;
+	std::vector<unsigned int> unusedNodes;
+
+	//size -> bin, rounding up so any block in the bin is large enough
+	static unsigned int binRoundUp(unsigned int size) {
+		if (size < MANTISSA_VALUE)
+			return size;
+		unsigned int highestBit = 31 - countLeadingZeros(size);
+		unsigned int mantissaStart = highestBit - MANTISSA_BITS;
+		unsigned int exponent = mantissaStart + 1;
+		unsigned int mantissa = (size >> mantissaStart) & MANTISSA_MASK;
+		if (size & ((1u << mantissaStart) - 1))
+			mantissa++;
+		return (exponent << MANTISSA_BITS) + mantissa; //'+' lets the mantissa carry into the exponent
+	}
+
+	//size -> bin, rounding down so a block is filed under sizes it can always serve
+	static unsigned int binRoundDown(unsigned int size) {
+		if (size < MANTISSA_VALUE)
+			return size;
+		unsigned int highestBit = 31 - countLeadingZeros(size);
+		unsigned int mantissaStart = highestBit - MANTISSA_BITS;
+		unsigned int exponent = mantissaStart + 1;
+		unsigned int mantissa = (size >> mantissaStart) & MANTISSA_MASK;
+		return (exponent << MANTISSA_BITS) | mantissa;
+	}
+
+	static unsigned int lowestSetBitFrom(unsigned int mask, unsigned int start) {
+		unsigned int after = mask & ~((1u << start) - 1);
+		return after ? countTrailingZeros(after) : NO_SPACE;
+	}
+
+	unsigned int newNode() {
+		if (!unusedNodes.empty()) {
+			unsigned int index = unusedNodes.back();
+			unusedNodes.pop_back();
+			return index;
+		}
+		nodes.push_back(Node());
+		return (unsigned int)nodes.size() - 1;
+	}
+
+	void releaseNode(unsigned int index) {
+		nodes[index].used = false;
+		nodes[index].size = 0;
+		unusedNodes.push_back(index);
+	}
+
+	unsigned int insertFreeNode(unsigned int offset, unsigned int size) {
+
+		unsigned int bin = binRoundDown(size);
+		unsigned int top = bin >> LEAF_BITS;
+		unsigned int leaf = bin & LEAF_MASK;
+
+		unsigned int index = newNode();
+		Node& node = nodes[index];
+		node.offset = offset;
+		node.size = size;
+		node.used = false;
+		node.binPrev = NO_SPACE;
+		node.binNext = binHeads[bin];
+		node.neighborPrev = NO_SPACE;
+		node.neighborNext = NO_SPACE;
+
+		if (binHeads[bin] != NO_SPACE)
+			nodes[binHeads[bin]].binPrev = index;
+		binHeads[bin] = index;
+
+		usedBinsTop |= 1u << top;
+		usedBins[top] |= (unsigned char)(1u << leaf);
+
+		freeUnits += size;
+		freeRegionCount++;
+		return index;
+	}
+
+	void removeFromBin(unsigned int index) {
+
+		Node& node = nodes[index];
+		unsigned int bin = binRoundDown(node.size);
+
+		if (node.binPrev != NO_SPACE)
+			nodes[node.binPrev].binNext = node.binNext;
+		else
+			binHeads[bin] = node.binNext;
+
+		if (node.binNext != NO_SPACE)
+			nodes[node.binNext].binPrev = node.binPrev;
+
+		//clear the mask bits once the bin runs dry
+		if (binHeads[bin] == NO_SPACE) {
+			unsigned int top = bin >> LEAF_BITS;
+			usedBins[top] &= (unsigned char)~(1u << (bin & LEAF_MASK));
+			if (usedBins[top] == 0)
+				usedBinsTop &= ~(1u << top);
+		}
+
+		freeRegionCount--;
+	}
+};
+
+
+//A few large GL buffers carved up with an OffsetAllocator. Meshes, instance data and uniform
+//blocks are sub-allocated from the arena and streamed in with glBufferSubData, so adding data
+//never reallocates a buffer. Handles stay valid across defragment(); offsets do not, so read
+//them back with offsetOf() whenever getGeneration() changes.
+//
+//Writes go through GL_COPY_WRITE_BUFFER, whatever the arena's target, so filling an index
+//arena never rebinds the element buffer of the VAO that happens to be bound.
+class BufferArena {
+
+public:
+
+	static const unsigned int INVALID_HANDLE = 0xffffffff;
+
+	struct Stats {
+		size_t capacityBytes;
+		size_t bytesInUse;
+		size_t bytesFree;
+		size_t largestFreeBytes;
+		unsigned int allocationCount;
+		unsigned int freeRegionCount;
+		unsigned int totalAllocations;
+		unsigned int totalFrees;
+		unsigned int defragmentations;
+		float fragmentation; //0 when all free space is one block, approaching 1 as it splinters
+	};
+
+	//granularity is the alignment of every allocation, e.g. the vertex stride for vertex data
+	//or GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT for uniform blocks
+	BufferArena(GLenum bufferTarget, size_t capacityBytes, unsigned int granularityBytes = 16)
+		: target(bufferTarget), granularity(granularityBytes), buffer(0), generation(0),
+		  totalAllocations(0), totalFrees(0), defragmentations(0) {
+
+		allocator.reset((unsigned int)(capacityBytes / granularity));
+
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)allocator.getStats().capacity * granularity, NULL, GL_DYNAMIC_DRAW);
+	}
+
+	//reserve space; returns INVALID_HANDLE when the arena is full
+	unsigned int allocate(size_t bytes) {
+
+		OffsetAllocator::Allocation allocation = allocator.allocate(toUnits(bytes));
+		if (allocation.offset == OffsetAllocator::NO_SPACE) {
+			std::cout << "ERROR::BUFFER_ARENA::OUT_OF_SPACE " << bytes << " bytes requested" << std::endl;
+			return INVALID_HANDLE;
+		}
+
+		unsigned int handle;
+		if (!freeHandles.empty()) {
+			handle = freeHandles.back();
+			freeHandles.pop_back();
+			allocations[handle] = allocation;
+		}
+		else {
+			handle = (unsigned int)allocations.size();
+			allocations.push_back(allocation);
+		}
+
+		totalAllocations++;
+		return handle;
+	}
+
+	//reserve space and copy data into it in one go
+	unsigned int allocate(const void* data, size_t bytes) {
+		unsigned int handle = allocate(bytes);
+		if (handle != INVALID_HANDLE)
+			upload(handle, data, bytes);
+		return handle;
+	}
+
+	void free(unsigned int handle) {
+		if (handle == INVALID_HANDLE || allocations[handle].node == OffsetAllocator::NO_SPACE)
+			return;
+		allocator.free(allocations[handle]);
+		allocations[handle].node = OffsetAllocator::NO_SPACE;
+		freeHandles.push_back(handle);
+		totalFrees++;
+	}
+
+	//write into an allocation without touching the rest of the buffer
+	void upload(unsigned int handle, const void* data, size_t bytes, size_t byteOffset = 0) {
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, offsetOf(handle) + byteOffset, bytes, data);
+	}
+
+	//copy the first bytes of one allocation into another on the GPU, e.g. when growing a mesh
+	void copy(unsigned int from, unsigned int to, size_t bytes) {
+		glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offsetOf(from), offsetOf(to), bytes);
+	}
+
+	size_t offsetOf(unsigned int handle) const {
+		return (size_t)allocations[handle].offset * granularity;
+	}
+
+	size_t sizeOf(unsigned int handle) const {
+		return (size_t)allocator.sizeOf(allocations[handle]) * granularity;
+	}
+
+	unsigned int getBuffer() const { return buffer; }
+	GLenum getTarget() const { return target; }
+	unsigned int getGranularity() const { return granularity; }
+	unsigned int getGeneration() const { return generation; }
+
+	//Packs every live allocation to the front of a fresh buffer with glCopyBufferSubData,
+	//leaving all free space as one block. Any VAO that references the old buffer has to be
+	//rebuilt afterwards.
+	void defragment() {
+
+		std::vector<unsigned int> live;
+		for (unsigned int handle = 0; handle < allocations.size(); handle++) {
+			if (allocations[handle].node != OffsetAllocator::NO_SPACE)
+				live.push_back(handle);
+		}
+		std::sort(live.begin(), live.end(), [this](unsigned int a, unsigned int b) {
+			return allocations[a].offset < allocations[b].offset;
+		});
+
+		OffsetAllocator::Stats before = allocator.getStats();
+
+		unsigned int packed;
+		glGenBuffers(1, &packed);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, packed);
+		glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)before.capacity * granularity, NULL, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+
+		//allocating in offset order from an empty allocator hands out consecutive offsets
+		std::vector<unsigned int> sizes(live.size());
+		for (size_t i = 0; i < live.size(); i++)
+			sizes[i] = allocator.sizeOf(allocations[live[i]]);
+
+		allocator.reset(before.capacity);
+
+		for (size_t i = 0; i < live.size(); i++) {
+			OffsetAllocator::Allocation moved = allocator.allocate(sizes[i]);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+				(GLintptr)allocations[live[i]].offset * granularity, (GLintptr)moved.offset * granularity,
+				(GLsizeiptr)sizes[i] * granularity);
+			allocations[live[i]] = moved;
+		}
+
+		glDeleteBuffers(1, &buffer);
+		buffer = packed;
+		generation++;
+		defragmentations++;
+	}
+
+	Stats getStats() const {
+
+		OffsetAllocator::Stats units = allocator.getStats();
+
+		Stats stats;
+		stats.capacityBytes = (size_t)units.capacity * granularity;
+		stats.bytesInUse = (size_t)units.usedUnits * granularity;
+		stats.bytesFree = (size_t)units.freeUnits * granularity;
+		stats.largestFreeBytes = (size_t)units.largestFreeRegion * granularity;
+		stats.allocationCount = units.allocationCount;
+		stats.freeRegionCount = units.freeRegionCount;
+		stats.totalAllocations = totalAllocations;
+		stats.totalFrees = totalFrees;
+		stats.defragmentations = defragmentations;
+		stats.fragmentation = units.freeUnits ? 1.0f - (float)units.largestFreeRegion / (float)units.freeUnits : 0.0f;
+		return stats;
+	}
+
+	void printStats(const char* name) const {
+		Stats stats = getStats();
+		std::cout << "BUFFER_ARENA::" << name
+			<< " used " << stats.bytesInUse << "/" << stats.capacityBytes << " bytes"
+			<< ", allocations " << stats.allocationCount
+			<< ", free regions " << stats.freeRegionCount
+			<< ", fragmentation " << stats.fragmentation * 100.0f << "%" << std::endl;
+	}
+
+	void destroy() {
+		glDeleteBuffers(1, &buffer);
+		buffer = 0;
+	}
+
+	//Streams meshes in and out of a 64 MB arena the way a level load would, then compacts it.
+	//Needs a current GL context. Prints the cost of allocate/free, the fragmentation the churn
+	//leaves behind, and what defragment() costs and gets back; every live allocation is read back
+	//afterwards to check the move kept its contents.
+	static void benchmark() {
+
+		const size_t capacity = 64 << 20;
+		const unsigned int meshes = 2000;
+		const unsigned int churn = 20000;
+
+		std::mt19937 random(27);
+		std::uniform_real_distribution<float> logSize(8.0f, 16.0f); //256 B to 64 KB, log uniform
+		auto meshBytes = [&]() { return (size_t)std::pow(2.0f, logSize(random)) & ~(size_t)3; };
+
+		BufferArena arena(GL_ARRAY_BUFFER, capacity);
+		std::vector<unsigned int> live;
+		std::vector<uint32_t> seeds;  //by handle; the words of allocation h are seeds[h] + i
+		std::vector<size_t> written; //by handle; allocations are rounded up past what was written
+		std::vector<uint32_t> words;
+		uint32_t nextSeed = 1;
+
+		auto fill = [&](unsigned int handle, size_t bytes) {
+			if (seeds.size() <= handle) {
+				seeds.resize(handle + 1);
+				written.resize(handle + 1);
+			}
+			seeds[handle] = nextSeed;
+			written[handle] = bytes;
+			nextSeed += 0x10000;
+			words.resize(bytes / 4);
+			for (size_t i = 0; i < words.size(); i++)
+				words[i] = seeds[handle] + (uint32_t)i;
+			arena.upload(handle, words.data(), bytes);
+		};
+
+		//----load
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (unsigned int i = 0; i < meshes; i++) {
+			size_t bytes = meshBytes();
+			unsigned int handle = arena.allocate(bytes);
+			if (handle == INVALID_HANDLE)
+				break;
+			fill(handle, bytes);
+			live.push_back(handle);
+		}
+		glFinish();
+		double loadTime = elapsed(start);
+		arena.printStats("after load");
+
+		//----stream: every step unloads one mesh and loads another of a different size
+		double allocateTime = 0.0, freeTime = 0.0;
+		unsigned int failed = 0;
+		for (unsigned int i = 0; i < churn; i++) {
+			if (!live.empty()) {
+				size_t victim = random() % live.size();
+				start = std::chrono::steady_clock::now();
+				arena.free(live[victim]);
+				freeTime += elapsed(start);
+				live[victim] = live.back();
+				live.pop_back();
+			}
+
+			size_t bytes = meshBytes();
+			start = std::chrono::steady_clock::now();
+			unsigned int handle = arena.allocate(bytes);
+			allocateTime += elapsed(start);
+			if (handle == INVALID_HANDLE) {
+				failed++;
+				continue;
+			}
+			fill(handle, bytes);
+			live.push_back(handle);
+		}
+		Stats churned = arena.getStats();
+		arena.printStats("after churn");
+
+		//----compact
+		start = std::chrono::steady_clock::now();
+		arena.defragment();
+		glFinish();
+		double defragmentTime = elapsed(start);
+		arena.printStats("after defragment");
+
+		//----the whole buffer comes back once; every live allocation must still hold its words
+		std::vector<uint32_t> contents(capacity / 4);
+		glBindBuffer(GL_COPY_READ_BUFFER, arena.getBuffer());
+		glGetBufferSubData(GL_COPY_READ_BUFFER, 0, capacity, contents.data());
+		unsigned int corrupt = 0;
+		for (unsigned int handle : live) {
+			const uint32_t* first = &contents[arena.offsetOf(handle) / 4];
+			for (size_t i = 0; i < written[handle] / 4; i++) {
+				if (first[i] != seeds[handle] + (uint32_t)i) {
+					corrupt++;
+					break;
+				}
+			}
+		}
+
+		std::cout << "BUFFER_ARENA::BENCHMARK " << meshes << " meshes loaded in " << loadTime << " ms, "
+			<< churn << " unload/load pairs" << (failed ? " (" : "") << (failed ? std::to_string(failed) + " did not fit)" : "") << std::endl
+			<< "    allocate " << allocateTime * 1000000.0 / churn << " ns, free " << freeTime * 1000000.0 / churn << " ns" << std::endl
+			<< "    fragmentation " << churned.fragmentation * 100.0f << "% over " << churned.freeRegionCount << " free regions"
+			<< ", largest free block " << churned.largestFreeBytes << " of " << churned.bytesFree << " free bytes" << std::endl
+			<< "    defragment " << defragmentTime << " ms for " << arena.getStats().bytesInUse << " bytes"
+			<< ", " << (corrupt ? std::to_string(corrupt) + " allocations CORRUPT" : std::string("contents intact")) << std::endl;
+
+		arena.destroy();
+	}
+
+private:
+
+	GLenum target;
+	unsigned int granularity;
+	unsigned int buffer;
+	unsigned int generation;
+
+	unsigned int totalAllocations;
+	unsigned int totalFrees;
+	unsigned int defragmentations;
+
+	OffsetAllocator allocator;
+	std::vector<OffsetAllocator::Allocation> allocations;
+	std::vector<unsigned int> freeHandles;
+
+	unsigned int toUnits(size_t bytes) const {
+		return (unsigned int)((bytes + granularity - 1) / granularity);
+	}
+
+	static double elapsed(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+};
+#endif
@@ -0,0 +1,373 @@
+#pragma once
+
+#ifndef CPU_PROFILER_H
+#define CPU_PROFILER_H
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+//compile with CPU_PROFILER_ENABLED=0 and every PROFILE_SCOPE disappears
+#ifndef CPU_PROFILER_ENABLED
+#define CPU_PROFILER_ENABLED 1
+#endif
+
+
+//Scoped CPU profiler writing a Chrome trace (chrome://tracing, ui.perfetto.dev).
+//
+//Each thread gets its own ring buffer on its first scope. A scope looks its ring up once when it
+//opens, reads the time stamp counter when it opens and closes, and pushes one event with both
+//times into the ring. The ring has a single producer and a single consumer, and the producer
+//keeps its own copy of the consumer's position, so a push is three plain stores and a release;
+//the shared position is only read again when the copy says the ring is full. Names are stored
+//as pointers, so nothing on that path touches a string, a map or the heap.
+//A background thread drains every ring a few times a second and appends the events to the trace
+//file. When a ring is full the event is dropped and counted rather than waiting on the flusher.
+//
+//Nothing is recorded until start(), and PROFILE_SCOPE compiles to nothing when
+//CPU_PROFILER_ENABLED is 0.
+class CPUProfiler {
+
+public:
+
+	static const unsigned int RING_SIZE = 1 << 15;       //events per thread, a power of two
+	static const unsigned int FLUSH_INTERVAL_MS = 100;
+
+	struct Event {
+		const char* name;
+		uint64_t begin, end; //counter ticks
+	};
+
+	struct ThreadBuffer {
+		Event events[RING_SIZE];
+		std::atomic<uint32_t> head; //written by the owning thread only
+		uint32_t cachedTail;        //the owning thread's last look at tail
+		std::atomic<uint32_t> dropped;
+		char padding[64];           //keeps the flusher's writes to tail off the producer's line
+		std::atomic<uint32_t> tail; //written by the flusher only
+		unsigned int threadId;
+		std::string threadName;
+
+		ThreadBuffer() : head(0), cachedTail(0), dropped(0), tail(0), threadId(0) {}
+	};
+
+	CPUProfiler() : active(false), stopping(false), firstEvent(true), writtenEvents(0), startTicks(0), ticksPerMicrosecond(1.0) {}
+
+	~CPUProfiler() {
+		stop();
+		for (ThreadBuffer* buffer : buffers)
+			delete buffer;
+	}
+
+	static uint64_t now() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+	bool isActive() const {
+		return active.load(std::memory_order_relaxed);
+	}
+
+	//open the trace file and start recording; false if the file cannot be written
+	bool start(const char* path) {
+
+		if (isActive())
+			return true;
+
+		file.open(path, std::ios::out | std::ios::trunc);
+		if (!file.is_open()) {
+			std::cout << "ERROR::CPU_PROFILER::FILE_NOT_OPENED " << path << std::endl;
+			return false;
+		}
+		file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+		firstEvent = true;
+		writtenEvents = 0;
+
+		calibrate();
+		stopping = false;
+		active.store(true, std::memory_order_relaxed);
+		flusher = std::thread(&CPUProfiler::flushLoop, this);
+		return true;
+	}
+
+	//stop recording, write out everything still buffered and close the file
+	void stop() {
+
+		if (!isActive())
+			return;
+		active.store(false, std::memory_order_relaxed);
+		{
+			std::lock_guard<std::mutex> lock(flushMutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		flusher.join();
+
+		flush();
+
+		std::lock_guard<std::mutex> lock(flushMutex);
+		std::lock_guard<std::mutex> registry(buffersMutex);
+		unsigned int dropped = 0;
+		for (ThreadBuffer* buffer : buffers) {
+			dropped += buffer->dropped.load(std::memory_order_relaxed);
+			writeSeparator();
+			file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << buffer->threadId
+				<< ",\"args\":{\"name\":\"" << buffer->threadName << "\"}}";
+		}
+		file << "\n]}\n";
+		file.close();
+
+		std::cout << "CPU_PROFILER::TRACE " << writtenEvents << " events, " << dropped << " dropped" << std::endl;
+	}
+
+	//drain every ring into the file now; the flusher thread does this on its own
+	void flush() {
+		std::lock_guard<std::mutex> lock(flushMutex);
+		if (!file.is_open())
+			return;
+
+		std::lock_guard<std::mutex> registry(buffersMutex);
+		for (ThreadBuffer* buffer : buffers)
+			drain(*buffer);
+	}
+
+	//name shown for the calling thread in the trace viewer
+	void setThreadName(const char* name) {
+		ThreadBuffer& buffer = localBuffer();
+		std::lock_guard<std::mutex> registry(buffersMutex);
+		buffer.threadName = name;
+	}
+
+	void record(const char* name, uint64_t begin, uint64_t end) {
+		record(localBuffer(), name, begin, end);
+	}
+
+	//the calling thread's ring, for scopes that look it up once and record into it later
+	ThreadBuffer& localBuffer() {
+		static thread_local ThreadBuffer* buffer = NULL;
+		if (buffer == NULL) {
+			buffer = new ThreadBuffer();
+			std::lock_guard<std::mutex> registry(buffersMutex);
+			buffer->threadId = (unsigned int)buffers.size();
+			buffer->threadName = "thread " + std::to_string(buffer->threadId);
+			buffers.push_back(buffer);
+		}
+		return *buffer;
+	}
+
+	//buffer must be the calling thread's own
+	static void record(ThreadBuffer& buffer, const char* name, uint64_t begin, uint64_t end) {
+
+		uint32_t head = buffer.head.load(std::memory_order_relaxed);
+		if (head - buffer.cachedTail >= RING_SIZE) {
+			buffer.cachedTail = buffer.tail.load(std::memory_order_acquire);
+			if (head - buffer.cachedTail >= RING_SIZE) {
+				buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+		}
+
+		Event& event = buffer.events[head & (RING_SIZE - 1)];
+		event.name = name;
+		event.begin = begin;
+		event.end = end;
+		buffer.head.store(head + 1, std::memory_order_release);
+	}
+
+	unsigned int getDroppedEvents() {
+		std::lock_guard<std::mutex> registry(buffersMutex);
+		unsigned int dropped = 0;
+		for (ThreadBuffer* buffer : buffers)
+			dropped += buffer->dropped.load(std::memory_order_relaxed);
+		return dropped;
+	}
+
+	static const unsigned int TARGET_NS_PER_SCOPE = 20; //what a recorded scope may cost
+
+	//cost of one scope with the profiler on, off, and compiled out, checked against TARGET_NS_PER_SCOPE
+	static bool benchmark(unsigned int scopeCount = 1000000);
+
+private:
+
+	std::atomic<bool> active;
+	bool stopping;
+	std::thread flusher;
+	std::mutex flushMutex; //consumer side: the file and every ring's tail
+	std::condition_variable wake;
+	std::ofstream file;
+	bool firstEvent;
+	unsigned int writtenEvents;
+
+	std::mutex buffersMutex;
+	std::vector<ThreadBuffer*> buffers;
+
+	uint64_t startTicks;
+	double ticksPerMicrosecond;
+
+	//the counter rate is not exposed anywhere, so measure it against the steady clock
+	void calibrate() {
+		std::chrono::steady_clock::time_point clockBegin = std::chrono::steady_clock::now();
+		uint64_t ticksBegin = now();
+		while (std::chrono::steady_clock::now() - clockBegin < std::chrono::milliseconds(20)) {}
+		std::chrono::steady_clock::time_point clockEnd = std::chrono::steady_clock::now();
+		uint64_t ticksEnd = now();
+
+		double microseconds = std::chrono::duration<double, std::micro>(clockEnd - clockBegin).count();
+		ticksPerMicrosecond = (ticksEnd - ticksBegin) / microseconds;
+		startTicks = ticksEnd;
+	}
+
+	void flushLoop() {
+		std::unique_lock<std::mutex> lock(flushMutex);
+		while (!stopping) {
+			wake.wait_for(lock, std::chrono::milliseconds(FLUSH_INTERVAL_MS));
+			if (stopping)
+				break;
+			std::lock_guard<std::mutex> registry(buffersMutex);
+			for (ThreadBuffer* buffer : buffers)
+				drain(*buffer);
+		}
+	}
+
+	void writeSeparator() {
+		if (!firstEvent)
+			file << ",\n";
+		firstEvent = false;
+	}
+
+	//flushMutex must be held
+	void drain(ThreadBuffer& buffer) {
+		uint32_t tail = buffer.tail.load(std::memory_order_relaxed);
+		uint32_t head = buffer.head.load(std::memory_order_acquire);
+		for (; tail != head; tail++) {
+			const Event& event = buffer.events[tail & (RING_SIZE - 1)];
+			//events from before start() are older than the calibration point
+			double begin = ((int64_t)(event.begin - startTicks)) / ticksPerMicrosecond;
+			double duration = (event.end - event.begin) / ticksPerMicrosecond;
+			writeSeparator();
+			file << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer.threadId
+				<< ",\"ts\":" << begin << ",\"dur\":" << duration << "}";
+			writtenEvents++;
+		}
+		buffer.tail.store(tail, std::memory_order_release);
+	}
+};
+
+inline CPUProfiler& cpuProfiler() {
+	static CPUProfiler profiler;
+	return profiler;
+}
+
+
+//records the time between construction and destruction under name, which must outlive the trace
+class CPUProfileScope {
+
+public:
+
+	CPUProfileScope(const char* scopeName) : name(scopeName), buffer(NULL), begin(0) {
+		CPUProfiler& profiler = cpuProfiler();
+		if (profiler.isActive()) {
+			buffer = &profiler.localBuffer();
+			begin = CPUProfiler::now();
+		}
+	}
+
+	~CPUProfileScope() {
+		if (buffer)
+			CPUProfiler::record(*buffer, name, begin, CPUProfiler::now());
+	}
+
+private:
+
+	const char* name;
+	CPUProfiler::ThreadBuffer* buffer; //NULL when the profiler was off as the scope opened
+	uint64_t begin;
+};
+
+#define CPU_PROFILER_CONCAT_INNER(a, b) a##b
+#define CPU_PROFILER_CONCAT(a, b) CPU_PROFILER_CONCAT_INNER(a, b)
+
+#if CPU_PROFILER_ENABLED
+#define PROFILE_SCOPE(name) CPUProfileScope CPU_PROFILER_CONCAT(cpuProfileScope, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_FUNCTION() ((void)0)
+#endif
+
+
+inline bool CPUProfiler::benchmark(unsigned int scopeCount) {
+
+	typedef std::chrono::high_resolution_clock Clock;
+	CPUProfiler& profiler = cpuProfiler();
+	volatile unsigned int sink = 0;
+
+	//the loop alone, which is all a compiled out scope leaves
+	Clock::time_point t0 = Clock::now();
+	for (unsigned int i = 0; i < scopeCount; i++)
+		sink = sink + i;
+	double emptyMs = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+
+	//profiler not started: one relaxed load per scope
+	t0 = Clock::now();
+	for (unsigned int i = 0; i < scopeCount; i++) {
+		CPUProfileScope scope("bench");
+		sink = sink + i;
+	}
+	double inactiveMs = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+
+	//recording, in batches that fit the ring so nothing is dropped; the flushes are not timed
+	if (!profiler.start("cpu_profile_bench.json"))
+		return false;
+	double activeMs = 0.0;
+	for (unsigned int done = 0; done < scopeCount; ) {
+		unsigned int batch = std::min(scopeCount - done, RING_SIZE / 2);
+		t0 = Clock::now();
+		for (unsigned int i = 0; i < batch; i++) {
+			CPUProfileScope scope("bench");
+			sink = sink + i;
+		}
+		activeMs += std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+		profiler.flush();
+		done += batch;
+	}
+	profiler.stop();
+
+	//the two counter reads alone; a scope can never cost less, and under some hypervisors they
+	//trap and take most of the budget by themselves
+	t0 = Clock::now();
+	for (unsigned int i = 0; i < scopeCount; i++) {
+		uint64_t begin = now();
+		sink = sink + i;
+		sink = sink + (unsigned int)(now() - begin);
+	}
+	double clockMs = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+
+	double recordingNs = (activeMs - emptyMs) * 1.0e6 / scopeCount;
+	bool passed = recordingNs < TARGET_NS_PER_SCOPE;
+	std::cout << "CPU_PROFILER::BENCHMARK " << scopeCount << " scopes" << std::endl;
+	std::cout << "    empty loop:   " << emptyMs * 1.0e6 / scopeCount << " ns/scope" << std::endl;
+	std::cout << "    not started:  " << (inactiveMs - emptyMs) * 1.0e6 / scopeCount << " ns/scope" << std::endl;
+	std::cout << "    clock reads:  " << (clockMs - emptyMs) * 1.0e6 / scopeCount << " ns/scope" << std::endl;
+	std::cout << "    recording:    " << recordingNs << " ns/scope (" << (activeMs - clockMs) * 1.0e6 / scopeCount
+		<< " beyond the clock reads), target " << TARGET_NS_PER_SCOPE << " ns " << (passed ? "PASS" : "FAIL") << std::endl;
+	return passed;
+}
+#endif
@@ -0,0 +1,233 @@
+#pragma once
+
+#ifndef COMMAND_RECORDER_H
+#define COMMAND_RECORDER_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "RenderQueue.h"
+#include "ThreadPool.h"
+
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+
+
+//Bump allocator owned by one thread. reset() rewinds it but keeps its blocks, so after the
+//first few frames recording allocates nothing from the heap.
+class LinearAllocator {
+
+public:
+
+	LinearAllocator(size_t blockBytes = 256 * 1024) : blockSize(blockBytes), block(0), used(0) {}
+
+	void* allocate(size_t bytes, size_t alignment = 16) {
+
+		for (;;) {
+			if (block < blocks.size()) {
+				char* base = blocks[block].data.get();
+				size_t start = (size_t)((((uintptr_t)base + used + alignment - 1) & ~(uintptr_t)(alignment - 1)) - (uintptr_t)base);
+				if (start + bytes <= blocks[block].size) {
+					used = start + bytes;
+					return base + start;
+				}
+				block++;
+				used = 0;
+				continue;
+			}
+			Block fresh;
+			fresh.size = std::max(blockSize, bytes + alignment);
+			fresh.data.reset(new char[fresh.size + alignment]);
+			blocks.push_back(std::move(fresh));
+		}
+	}
+
+	void reset() {
+		block = 0;
+		used = 0;
+	}
+
+private:
+
+	struct Block {
+		std::unique_ptr<char[]> data;
+		size_t size;
+	};
+
+	size_t blockSize;
+	std::vector<Block> blocks;
+	size_t block;
+	size_t used;
+};
+
+
+//For per-thread state that is written constantly. Elements of a vector of these keep their
+//written fields at least a cache line apart, so threads never false-share; padding instead of
+//alignas(64) because a C++14 std::vector does not honour over-alignment.
+template<typename T>
+struct CacheLinePadded {
+	T value;
+	char padding[64];
+};
+
+
+//Commands and transforms recorded by one job, living in its thread's LinearAllocator.
+//Recording never touches GL.
+class CommandList {
+
+public:
+
+	CommandList() : allocator(NULL), commands(NULL), transforms(NULL), commandCount(0), commandCapacity(0), transformCount(0), transformCapacity(0) {}
+
+	void begin(LinearAllocator* threadAllocator) {
+		allocator = threadAllocator;
+		commands = NULL;
+		transforms = NULL;
+		commandCount = commandCapacity = 0;
+		transformCount = transformCapacity = 0;
+	}
+
+	unsigned int addTransform(const glm::mat4& transform) {
+		if (transformCount == transformCapacity)
+			grow(transforms, transformCount, transformCapacity);
+		transforms[transformCount] = transform;
+		return transformCount++;
+	}
+
+	void push(const RenderCommand& command) {
+		if (commandCount == commandCapacity)
+			grow(commands, commandCount, commandCapacity);
+		commands[commandCount++] = command;
+	}
+
+	unsigned int getCommandCount() const { return commandCount; }
+
+	//append into the queue, shifting transform indices past what the queue already holds
+	void appendTo(RenderQueue& queue) const {
+		unsigned int transformBase = (unsigned int)queue.transforms.size();
+		queue.transforms.insert(queue.transforms.end(), transforms, transforms + transformCount);
+		for (unsigned int i = 0; i < commandCount; i++) {
+			queue.commands.push_back(commands[i]);
+			queue.commands.back().transform += transformBase;
+		}
+	}
+
+private:
+
+	LinearAllocator* allocator;
+	RenderCommand* commands;
+	glm::mat4* transforms;
+	unsigned int commandCount, commandCapacity;
+	unsigned int transformCount, transformCapacity;
+
+	//grow by doubling inside the linear allocator; the old span is simply abandoned until reset
+	template<typename T>
+	void grow(T*& items, unsigned int count, unsigned int& capacity) {
+		unsigned int newCapacity = capacity ? capacity * 2 : 256;
+		T* grown = (T*)allocator->allocate(newCapacity * sizeof(T), 16);
+		if (count)
+			memcpy(grown, items, count * sizeof(T));
+		items = grown;
+		capacity = newCapacity;
+	}
+};
+
+
+//Splits scene traversal into chunks recorded in parallel. The GL thread then merges the
+//chunk lists in chunk order (so the result does not depend on scheduling), sorts and submits.
+class ParallelRecorder {
+
+public:
+
+	//body(begin, end, list) records the draws for items [begin, end)
+	typedef std::function<void(unsigned int, unsigned int, CommandList&)> RecordFunction;
+
+	void record(ThreadPool& pool, unsigned int itemCount, unsigned int chunkSize, const RecordFunction& body) {
+
+		if (allocators.size() < pool.getThreadCount())
+			allocators.resize(pool.getThreadCount());
+		for (CacheLinePadded<LinearAllocator>& allocator : allocators)
+			allocator.value.reset();
+
+		unsigned int chunkCount = (itemCount + chunkSize - 1) / chunkSize;
+		if (lists.size() < chunkCount)
+			lists.resize(chunkCount);
+		usedLists = chunkCount;
+
+		pool.parallelFor(chunkCount, 1, [&](unsigned int begin, unsigned int end, unsigned int thread) {
+			for (unsigned int chunk = begin; chunk < end; chunk++) {
+				CommandList& list = lists[chunk].value;
+				list.begin(&allocators[thread].value);
+				body(chunk * chunkSize, std::min(itemCount, (chunk + 1) * chunkSize), list);
+			}
+		});
+	}
+
+	//GL thread: gather every chunk's commands into the queue
+	void merge(RenderQueue& queue) const {
+		for (unsigned int i = 0; i < usedLists; i++)
+			lists[i].value.appendTo(queue);
+	}
+
+	//Record, merge and sort a synthetic scene of objectCount objects with 1..N threads and print
+	//the CPU frame time for each. Executing the commands is left out so no context is needed.
+	static void benchmark(unsigned int objectCount = 50000, unsigned int frames = 30) {
+
+		std::vector<glm::vec3> positions(objectCount);
+		for (unsigned int i = 0; i < objectCount; i++)
+			positions[i] = glm::vec3((float)(i % 100), (float)((i / 100) % 100), (float)(i / 10000)) * 2.0f;
+
+		glm::mat4 view = glm::lookAt(glm::vec3(100.0f, 100.0f, -50.0f), glm::vec3(100.0f, 100.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+		std::cout << "COMMAND_RECORDER::BENCHMARK " << objectCount << " objects" << std::endl;
+		//powers of two, and always every hardware thread even when that is not a power of two
+		for (unsigned int threads = 1;; threads = std::min(threads * 2, maxThreads)) {
+
+			ThreadPool pool(threads);
+			ParallelRecorder recorder;
+			RenderQueue queue;
+			double total = 0.0;
+
+			for (unsigned int frame = 0; frame < frames; frame++) {
+
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				float time = frame * 0.016f;
+
+				recorder.record(pool, objectCount, 512, [&](unsigned int begin, unsigned int end, CommandList& list) {
+					for (unsigned int i = begin; i < end; i++) {
+						glm::mat4 model = glm::translate(glm::mat4(1.0f), positions[i]);
+						model = glm::rotate(model, time + i * 0.1f, glm::vec3(0.0f, 1.0f, 0.0f));
+						float depth = -(view * model[3]).z / 300.0f;
+						RenderCommand command = {
+							RenderKey::opaque(0, 1 + i % 4, 1 + i % 16, 1 + i % 8, depth),
+							1 + i % 4, 1 + i % 8, 1 + i % 16, 0, list.addTransform(model), 0, 36, 0, false
+						};
+						list.push(command);
+					}
+				});
+
+				queue.clear();
+				recorder.merge(queue);
+				queue.sort();
+
+				if (frame > 0) //the first frame warms up the allocators
+					total += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			}
+
+			std::cout << "    " << threads << " thread(s): " << total / (frames - 1) << " ms/frame" << std::endl;
+			if (threads == maxThreads)
+				break;
+		}
+	}
+
+private:
+
+	std::vector<CacheLinePadded<LinearAllocator> > allocators; //one per pool thread
+	std::vector<CacheLinePadded<CommandList> > lists;          //one per chunk; neighbours run on other threads
+	unsigned int usedLists = 0;
+};
+#endif
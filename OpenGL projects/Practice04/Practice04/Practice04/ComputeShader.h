@@ -0,0 +1,100 @@
+#pragma once
+
+#ifndef COMPUTE_SHADER_H
+#define COMPUTE_SHADER_H
+
+#include <glad/glad.h> //Include glad to get opengl headers
+#include "GLExtensions.h"
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+
+//Same as Shader, for a single compute stage. Needs a GL 4.3 context.
+class ComputeShader {
+
+public:
+
+	//program ID
+	unsigned int ID;
+
+	//constructor reads and builds the shader
+	ComputeShader(const char* computePath) {
+
+		//retrieve the compute source code from the file path
+		//--------------------------------------------------------------------------
+		std::string computeCode;
+		std::ifstream cShaderFile;
+
+		//ensure the ifstream object can throw exceptions
+		cShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+
+		try {
+			cShaderFile.open(computePath);
+			std::stringstream cShaderStream;
+			cShaderStream << cShaderFile.rdbuf();
+			cShaderFile.close();
+			computeCode = cShaderStream.str();
+		}
+		catch (const std::ifstream::failure& e) {
+			std::cout << "ERROR::COMPUTE_SHADER::FILE_NOT_SUCCESSFULLY_READ" << std::endl;
+		}
+
+		const char* cShaderCode = computeCode.c_str();
+
+
+		//Compile Shader
+		//--------------------------------------------------------------------------
+		int success;
+		char infoLog[512];
+
+		unsigned int compute = glCreateShader(GL_COMPUTE_SHADER);
+		glShaderSource(compute, 1, &cShaderCode, NULL);
+		glCompileShader(compute);
+
+		//print compile time errors
+		glGetShaderiv(compute, GL_COMPILE_STATUS, &success);
+		if (!success) {
+
+			glGetShaderInfoLog(compute, 512, NULL, infoLog);
+			std::cout << "ERROR::COMPUTE_SHADER::COMPILATION_FAILED\n" << infoLog << std::endl;
+		};
+
+		ID = glCreateProgram();
+		glAttachShader(ID, compute);
+		glLinkProgram(ID);
+
+		//print linking errors
+		glGetProgramiv(ID, GL_LINK_STATUS, &success);
+		if (!success) {
+
+			glGetProgramInfoLog(ID, 512, NULL, infoLog);
+			std::cout << "ERROR::COMPUTE_SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+		};
+
+		glDeleteShader(compute);
+	}
+
+	//use or activate the shader
+	void use() {
+		glUseProgram(ID);
+	}
+
+	//run enough work groups of groupSize invocations to cover itemCount items
+	void dispatch(unsigned int itemCount, unsigned int groupSize) const {
+		glExtensions().DispatchCompute((itemCount + groupSize - 1) / groupSize, 1, 1);
+	}
+
+	//utility uniform functions
+	void setUInt(const std::string& name, unsigned int value) const
+	{
+		glUniform1ui(glGetUniformLocation(ID, name.c_str()), value);
+	}
+	void setVec4Array(const std::string& name, const float* values, int count) const
+	{
+		glUniform4fv(glGetUniformLocation(ID, name.c_str()), count, values);
+	}
+};
+#endif
@@ -0,0 +1,654 @@
+#pragma once
+
+#ifndef DYNAMIC_BVH_H
+#define DYNAMIC_BVH_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "Frustum.h"
+
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+
+
+//Bounding volume hierarchy over object boxes, for visibility, picking and proximity queries.
+//
+//Nodes live in one flat array. build() creates the tree top down with a binned surface area
+//heuristic and lays internal nodes out depth first. Afterwards objects can be inserted, removed
+//and moved; moving only refits the boxes above the object. Each internal node remembers its area
+//from when it was last built, and optimize() rebuilds the subtrees that have grown much larger
+//than that. Proxies (leaf indices) stay valid through refits and subtree rebuilds.
+class DynamicBVH {
+
+public:
+
+	static const int NONE = -1;
+
+	DynamicBVH() : root(NONE), freeList(NONE), leafCount(0) {}
+
+	//replace the tree with count objects; proxy i is boxes[2 * i], boxes[2 * i + 1] (min, max)
+	void build(const glm::vec3* boxes, const unsigned int* userData, unsigned int count) {
+
+		nodes.clear();
+		root = NONE;
+		freeList = NONE;
+		leafCount = count;
+		if (count == 0)
+			return;
+
+		nodes.reserve(2 * count - 1);
+		std::vector<int> leaves(count);
+		for (unsigned int i = 0; i < count; i++) {
+			Node leaf = makeNode(boxes[2 * i], boxes[2 * i + 1]);
+			leaf.userData = userData ? userData[i] : i;
+			nodes.push_back(leaf);
+			leaves[i] = (int)i;
+		}
+
+		std::vector<int> slots; //empty: internal nodes are appended in depth first order
+		root = buildRange(leaves, 0, count, NONE, slots);
+	}
+
+	//returns the proxy of the new object
+	int insert(const glm::vec3& boxMin, const glm::vec3& boxMax, unsigned int userData) {
+
+		int leaf = allocateNode();
+		nodes[leaf] = makeNode(boxMin, boxMax);
+		nodes[leaf].userData = userData;
+		leafCount++;
+
+		if (root == NONE) {
+			root = leaf;
+			return leaf;
+		}
+
+		//walk down towards the sibling that adds the least area to the tree
+		int sibling = root;
+		while (!nodes[sibling].isLeaf()) {
+			const Node& node = nodes[sibling];
+			float area = surfaceArea(node.boundsMin, node.boundsMax);
+			float combined = surfaceArea(glm::min(node.boundsMin, boxMin), glm::max(node.boundsMax, boxMax));
+			float pairHere = 2.0f * combined;
+			float inherited = 2.0f * (combined - area);
+
+			float childCost[2];
+			for (int c = 0; c < 2; c++) {
+				const Node& child = nodes[c ? node.child1 : node.child0];
+				float grown = surfaceArea(glm::min(child.boundsMin, boxMin), glm::max(child.boundsMax, boxMax));
+				childCost[c] = grown + inherited - (child.isLeaf() ? 0.0f : surfaceArea(child.boundsMin, child.boundsMax));
+			}
+
+			if (pairHere < childCost[0] && pairHere < childCost[1])
+				break;
+			sibling = childCost[0] <= childCost[1] ? node.child0 : node.child1;
+		}
+
+		//new parent takes the sibling's place
+		int oldParent = nodes[sibling].parent;
+		int parent = allocateNode();
+		nodes[parent] = makeNode(glm::min(nodes[sibling].boundsMin, boxMin), glm::max(nodes[sibling].boundsMax, boxMax));
+		nodes[parent].parent = oldParent;
+		nodes[parent].child0 = sibling;
+		nodes[parent].child1 = leaf;
+		nodes[sibling].parent = parent;
+		nodes[leaf].parent = parent;
+		replaceChild(oldParent, sibling, parent);
+
+		refitUpwards(oldParent);
+		return leaf;
+	}
+
+	void remove(int proxy) {
+
+		leafCount--;
+		if (proxy == root) {
+			root = NONE;
+			freeNode(proxy);
+			return;
+		}
+
+		//the sibling replaces the parent
+		int parent = nodes[proxy].parent;
+		int grandParent = nodes[parent].parent;
+		int sibling = nodes[parent].child0 == proxy ? nodes[parent].child1 : nodes[parent].child0;
+		nodes[sibling].parent = grandParent;
+		replaceChild(grandParent, parent, sibling);
+
+		freeNode(parent);
+		freeNode(proxy);
+		refitUpwards(grandParent);
+	}
+
+	//give an object new bounds; its ancestors are refit right away
+	void move(int proxy, const glm::vec3& boxMin, const glm::vec3& boxMax) {
+		nodes[proxy].boundsMin = boxMin;
+		nodes[proxy].boundsMax = boxMax;
+		refitUpwards(nodes[proxy].parent);
+	}
+
+	//Rebuild every topmost subtree whose box area grew past threshold times its area when it was
+	//built. Returns the number of subtrees rebuilt. Cheap to call every few frames.
+	unsigned int optimize(float threshold = 2.0f) {
+
+		unsigned int rebuilt = 0;
+		if (root == NONE)
+			return 0;
+
+		std::vector<int> stack(1, root);
+		std::vector<int> leaves, slots;
+		while (!stack.empty()) {
+			int index = stack.back();
+			stack.pop_back();
+			Node& node = nodes[index];
+			if (node.isLeaf())
+				continue;
+
+			if (surfaceArea(node.boundsMin, node.boundsMax) > threshold * node.buildArea) {
+				leaves.clear();
+				slots.clear();
+				collectSubtree(index, leaves, slots);
+				int parent = node.parent;
+				int rebuiltRoot = buildRange(leaves, 0, (unsigned int)leaves.size(), parent, slots);
+				if (parent == NONE)
+					root = rebuiltRoot;
+				else
+					replaceChild(parent, index, rebuiltRoot);
+				rebuilt++;
+				continue;
+			}
+
+			stack.push_back(node.child0);
+			stack.push_back(node.child1);
+		}
+		return rebuilt;
+	}
+
+	unsigned int getUserData(int proxy) const { return nodes[proxy].userData; }
+	unsigned int getObjectCount() const { return leafCount; }
+
+	//surface area heuristic cost of the whole tree, relative to the root's area
+	float getCost() const {
+		if (root == NONE)
+			return 0.0f;
+		float total = 0.0f;
+		std::vector<int> stack(1, root);
+		while (!stack.empty()) {
+			const Node& node = nodes[stack.back()];
+			stack.pop_back();
+			total += surfaceArea(node.boundsMin, node.boundsMax);
+			if (!node.isLeaf()) {
+				stack.push_back(node.child0);
+				stack.push_back(node.child1);
+			}
+		}
+		return total / std::max(surfaceArea(nodes[root].boundsMin, nodes[root].boundsMax), FLT_MIN);
+	}
+
+	//user data of every object whose box touches the frustum. Subtrees fully inside every plane
+	//are taken whole without further tests.
+	void queryFrustum(const Frustum& frustum, std::vector<unsigned int>& out) const {
+
+		out.clear();
+		if (root == NONE)
+			return;
+
+		Stack stack;
+		stack.push(root, 0x3f);
+		int index;
+		unsigned int planeMask;
+		while (stack.pop(index, planeMask)) {
+			const Node& node = nodes[index];
+
+			bool outside = false;
+			for (int p = 0; p < 6 && !outside; p++) {
+				if (!(planeMask & (1u << p)))
+					continue;
+				const glm::vec4& plane = frustum.planes[p];
+				glm::vec3 positive(plane.x >= 0.0f ? node.boundsMax.x : node.boundsMin.x, plane.y >= 0.0f ? node.boundsMax.y : node.boundsMin.y, plane.z >= 0.0f ? node.boundsMax.z : node.boundsMin.z);
+				glm::vec3 negative(plane.x >= 0.0f ? node.boundsMin.x : node.boundsMax.x, plane.y >= 0.0f ? node.boundsMin.y : node.boundsMax.y, plane.z >= 0.0f ? node.boundsMin.z : node.boundsMax.z);
+				if (frustum.distance(p, positive) < 0.0f)
+					outside = true;
+				else if (frustum.distance(p, negative) >= 0.0f)
+					planeMask &= ~(1u << p); //inside this plane, so is everything below
+			}
+			if (outside)
+				continue;
+
+			if (node.isLeaf())
+				out.push_back(node.userData);
+			else {
+				stack.push(node.child0, planeMask);
+				stack.push(node.child1, planeMask);
+			}
+		}
+	}
+
+	void queryAABB(const glm::vec3& boxMin, const glm::vec3& boxMax, std::vector<unsigned int>& out) const {
+		out.clear();
+		traverse(out, [&](const Node& node) {
+			return glm::all(glm::lessThanEqual(node.boundsMin, boxMax)) && glm::all(glm::greaterThanEqual(node.boundsMax, boxMin));
+		});
+	}
+
+	void querySphere(const glm::vec3& center, float radius, std::vector<unsigned int>& out) const {
+		out.clear();
+		float radiusSquared = radius * radius;
+		traverse(out, [&](const Node& node) {
+			glm::vec3 offset = center - glm::clamp(center, node.boundsMin, node.boundsMax);
+			return glm::dot(offset, offset) <= radiusSquared;
+		});
+	}
+
+	//Nearest object box hit by the ray within maxDistance, NONE for a miss. Children are visited
+	//near first and subtrees beyond the closest hit so far are skipped.
+	int raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float* hitDistance = NULL) const {
+
+		if (root == NONE)
+			return NONE;
+
+		glm::vec3 inverse(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+		float closest = maxDistance;
+		int hit = NONE;
+
+		Stack stack;
+		stack.push(root, 0);
+		int index;
+		unsigned int unused;
+		while (stack.pop(index, unused)) {
+			const Node& node = nodes[index];
+			float entry;
+			if (!rayHitsBox(origin, inverse, node.boundsMin, node.boundsMax, closest, entry))
+				continue;
+			if (node.isLeaf()) {
+				closest = entry;
+				hit = index;
+				continue;
+			}
+
+			float entry0, entry1;
+			bool hit0 = rayHitsBox(origin, inverse, nodes[node.child0].boundsMin, nodes[node.child0].boundsMax, closest, entry0);
+			bool hit1 = rayHitsBox(origin, inverse, nodes[node.child1].boundsMin, nodes[node.child1].boundsMax, closest, entry1);
+			if (hit0 && hit1) {
+				//push the far child first so the near one is popped next
+				bool firstNear = entry0 <= entry1;
+				stack.push(firstNear ? node.child1 : node.child0, 0);
+				stack.push(firstNear ? node.child0 : node.child1, 0);
+			}
+			else if (hit0)
+				stack.push(node.child0, 0);
+			else if (hit1)
+				stack.push(node.child1, 0);
+		}
+
+		if (hitDistance)
+			*hitDistance = closest;
+		return hit;
+	}
+
+	//Build, refit and query timings over random boxes, then optimize() on a tree degraded on
+	//purpose, checked to rebuild something and lower the cost. No GL needed.
+	static void benchmark() {
+
+		unsigned int counts[2] = { 100000, 1000000 };
+		for (unsigned int objectCount : counts) {
+
+			std::mt19937 random(7);
+			std::uniform_real_distribution<float> position(-1000.0f, 1000.0f), size(0.5f, 4.0f), step(-1.0f, 1.0f);
+
+			std::vector<glm::vec3> boxes(2 * objectCount);
+			for (unsigned int i = 0; i < objectCount; i++) {
+				glm::vec3 center(position(random), position(random) * 0.05f, position(random));
+				glm::vec3 extent(size(random));
+				boxes[2 * i] = center - extent;
+				boxes[2 * i + 1] = center + extent;
+			}
+
+			DynamicBVH bvh;
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			bvh.build(boxes.data(), NULL, objectCount);
+			double buildTime = elapsed(start);
+			float builtCost = bvh.getCost();
+
+			//a tenth of the objects move every frame
+			unsigned int moving = objectCount / 10;
+			start = std::chrono::steady_clock::now();
+			for (unsigned int i = 0; i < moving; i++) {
+				glm::vec3 offset(step(random), 0.0f, step(random));
+				bvh.move((int)i, boxes[2 * i] + offset, boxes[2 * i + 1] + offset);
+			}
+			double refitTime = elapsed(start);
+
+			start = std::chrono::steady_clock::now();
+			unsigned int rebuilt = bvh.optimize();
+			double optimizeTime = elapsed(start);
+
+			std::vector<unsigned int> found;
+			unsigned int queries = 1000;
+			size_t frustumHits = 0, sphereHits = 0, rayHits = 0;
+
+			start = std::chrono::steady_clock::now();
+			for (unsigned int q = 0; q < queries / 10; q++) {
+				glm::vec3 eye(position(random), 20.0f, position(random));
+				glm::mat4 viewProjection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 200.0f)
+					* glm::lookAt(eye, eye + glm::vec3(step(random), 0.0f, step(random) + 0.01f), glm::vec3(0.0f, 1.0f, 0.0f));
+				bvh.queryFrustum(Frustum::fromMatrix(viewProjection), found);
+				frustumHits += found.size();
+			}
+			double frustumTime = elapsed(start) / (queries / 10);
+
+			start = std::chrono::steady_clock::now();
+			for (unsigned int q = 0; q < queries; q++) {
+				bvh.querySphere(glm::vec3(position(random), 0.0f, position(random)), 20.0f, found);
+				sphereHits += found.size();
+			}
+			double sphereTime = elapsed(start) / queries;
+
+			start = std::chrono::steady_clock::now();
+			for (unsigned int q = 0; q < queries; q++) {
+				glm::vec3 origin(position(random), 10.0f, position(random));
+				rayHits += bvh.raycast(origin, glm::normalize(glm::vec3(step(random), -0.2f, step(random))), 2000.0f) != NONE;
+			}
+			double rayTime = elapsed(start) / queries;
+
+			std::cout << "DYNAMIC_BVH::BENCHMARK " << objectCount << " objects" << std::endl
+				<< "    build " << buildTime << " ms (cost " << builtCost << ")"
+				<< ", refit " << moving << " moves " << refitTime << " ms"
+				<< ", optimize " << optimizeTime << " ms (" << rebuilt << " subtrees, cost " << bvh.getCost() << ")" << std::endl
+				<< "    frustum " << 1000.0 / frustumTime << " queries/s (" << frustumHits / (queries / 10) << " objects each)"
+				<< ", sphere " << 1000.0 / sphereTime << " queries/s (" << sphereHits / queries << " objects each)"
+				<< ", ray " << 1000.0 / rayTime << " queries/s (" << rayHits << "/" << queries << " hit)" << std::endl;
+
+			//----degrade on purpose: a fifth of the objects jump across the world, so the subtrees
+			//----they leave stretch over it; optimize() has to find and rebuild them
+			unsigned int teleported = objectCount / 5;
+			for (unsigned int i = 0; i < teleported; i++) {
+				unsigned int object = (unsigned int)(random() % objectCount);
+				glm::vec3 center(position(random), position(random) * 0.05f, position(random));
+				glm::vec3 extent = (boxes[2 * object + 1] - boxes[2 * object]) * 0.5f;
+				bvh.move((int)object, center - extent, center + extent);
+			}
+			float degradedCost = bvh.getCost();
+			start = std::chrono::steady_clock::now();
+			unsigned int degradedRebuilt = bvh.optimize();
+			double degradedTime = elapsed(start);
+			float repairedCost = bvh.getCost();
+
+			std::cout << "    degraded by " << teleported << " teleports: cost " << degradedCost
+				<< ", optimize " << degradedTime << " ms (" << degradedRebuilt << " subtrees, cost " << repairedCost << ")" << std::endl;
+			if (degradedRebuilt == 0)
+				std::cout << "ERROR::DYNAMIC_BVH::OPTIMIZE_REBUILT_NOTHING on a degraded tree" << std::endl;
+			else if (!(repairedCost < degradedCost))
+				std::cout << "ERROR::DYNAMIC_BVH::OPTIMIZE_DID_NOT_LOWER_COST " << degradedCost << " -> " << repairedCost << std::endl;
+		}
+	}
+
+private:
+
+	struct Node {
+		glm::vec3 boundsMin;
+		int child0;            //NONE for leaves
+		glm::vec3 boundsMax;
+		int child1;            //next free node while on the free list
+		int parent;
+		unsigned int userData;
+		float buildArea;       //surface area when this subtree was last built
+
+		bool isLeaf() const { return child0 == NONE; }
+	};
+
+	//traversal stack: index and a per-entry mask, spilling to the heap only for very deep trees
+	struct Stack {
+		int indices[64];
+		unsigned int masks[64];
+		std::vector<std::pair<int, unsigned int> > spill;
+		unsigned int size = 0;
+
+		void push(int index, unsigned int mask) {
+			if (size < 64) {
+				indices[size] = index;
+				masks[size] = mask;
+			}
+			else
+				spill.push_back(std::make_pair(index, mask));
+			size++;
+		}
+
+		bool pop(int& index, unsigned int& mask) {
+			if (size == 0)
+				return false;
+			size--;
+			if (size < 64) {
+				index = indices[size];
+				mask = masks[size];
+			}
+			else {
+				index = spill.back().first;
+				mask = spill.back().second;
+				spill.pop_back();
+			}
+			return true;
+		}
+	};
+
+	std::vector<Node> nodes;
+	int root;
+	int freeList;
+	unsigned int leafCount;
+
+	static double elapsed(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	static float surfaceArea(const glm::vec3& boxMin, const glm::vec3& boxMax) {
+		glm::vec3 size = boxMax - boxMin;
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	static Node makeNode(const glm::vec3& boxMin, const glm::vec3& boxMax) {
+		Node node = { boxMin, NONE, boxMax, NONE, NONE, 0, surfaceArea(boxMin, boxMax) };
+		return node;
+	}
+
+	static bool rayHitsBox(const glm::vec3& origin, const glm::vec3& inverse, const glm::vec3& boxMin, const glm::vec3& boxMax, float maxDistance, float& entry) {
+		glm::vec3 t0 = (boxMin - origin) * inverse;
+		glm::vec3 t1 = (boxMax - origin) * inverse;
+		glm::vec3 entries = glm::min(t0, t1), exits = glm::max(t0, t1);
+		entry = std::max(std::max(entries.x, entries.y), std::max(entries.z, 0.0f));
+		float exit = std::min(std::min(exits.x, exits.y), std::min(exits.z, maxDistance));
+		return entry <= exit;
+	}
+
+	int allocateNode() {
+		if (freeList != NONE) {
+			int index = freeList;
+			freeList = nodes[index].child1;
+			return index;
+		}
+		nodes.push_back(Node());
+		return (int)nodes.size() - 1;
+	}
+
+	void freeNode(int index) {
+		nodes[index].child0 = NONE;
+		nodes[index].child1 = freeList;
+		nodes[index].parent = NONE;
+		freeList = index;
+	}
+
+	void replaceChild(int parent, int oldChild, int newChild) {
+		if (parent == NONE) {
+			root = newChild;
+			return;
+		}
+		if (nodes[parent].child0 == oldChild)
+			nodes[parent].child0 = newChild;
+		else
+			nodes[parent].child1 = newChild;
+	}
+
+	//recompute boxes from the children upwards, stopping once a box comes out unchanged
+	void refitUpwards(int index) {
+		while (index != NONE) {
+			Node& node = nodes[index];
+			glm::vec3 boxMin = glm::min(nodes[node.child0].boundsMin, nodes[node.child1].boundsMin);
+			glm::vec3 boxMax = glm::max(nodes[node.child0].boundsMax, nodes[node.child1].boundsMax);
+			if (boxMin == node.boundsMin && boxMax == node.boundsMax)
+				return;
+			node.boundsMin = boxMin;
+			node.boundsMax = boxMax;
+			index = node.parent;
+		}
+	}
+
+	void collectSubtree(int index, std::vector<int>& leaves, std::vector<int>& internal) const {
+		std::vector<int> stack(1, index);
+		while (!stack.empty()) {
+			int current = stack.back();
+			stack.pop_back();
+			if (nodes[current].isLeaf()) {
+				leaves.push_back(current);
+				continue;
+			}
+			internal.push_back(current);
+			stack.push_back(nodes[current].child1);
+			stack.push_back(nodes[current].child0);
+		}
+		std::reverse(internal.begin(), internal.end()); //consumed from the back, in the original order
+	}
+
+	//Binned SAH split of leaves[begin, end). Internal nodes come from slots (back first) when a
+	//subtree is rebuilt in place, and are appended otherwise.
+	int buildRange(std::vector<int>& leaves, unsigned int begin, unsigned int end, int parent, std::vector<int>& slots) {
+
+		if (end - begin == 1) {
+			nodes[leaves[begin]].parent = parent;
+			return leaves[begin];
+		}
+
+		int index;
+		if (!slots.empty()) {
+			index = slots.back();
+			slots.pop_back();
+		}
+		else {
+			nodes.push_back(Node());
+			index = (int)nodes.size() - 1;
+		}
+
+		glm::vec3 boxMin(FLT_MAX), boxMax(-FLT_MAX), centroidMin(FLT_MAX), centroidMax(-FLT_MAX);
+		for (unsigned int i = begin; i < end; i++) {
+			const Node& leaf = nodes[leaves[i]];
+			boxMin = glm::min(boxMin, leaf.boundsMin);
+			boxMax = glm::max(boxMax, leaf.boundsMax);
+			glm::vec3 centroid = (leaf.boundsMin + leaf.boundsMax) * 0.5f;
+			centroidMin = glm::min(centroidMin, centroid);
+			centroidMax = glm::max(centroidMax, centroid);
+		}
+
+		unsigned int middle = splitRange(leaves, begin, end, centroidMin, centroidMax);
+
+		nodes[index] = makeNode(boxMin, boxMax);
+		nodes[index].parent = parent;
+		int child0 = buildRange(leaves, begin, middle, index, slots);
+		int child1 = buildRange(leaves, middle, end, index, slots);
+		nodes[index].child0 = child0;
+		nodes[index].child1 = child1;
+		return index;
+	}
+
+	//partition leaves[begin, end) at the cheapest of the bin boundaries on the widest centroid axis
+	unsigned int splitRange(std::vector<int>& leaves, unsigned int begin, unsigned int end, const glm::vec3& centroidMin, const glm::vec3& centroidMax) {
+
+		const int BINS = 12;
+		glm::vec3 extent = centroidMax - centroidMin;
+		int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+		if (extent[axis] <= 0.0f)
+			return (begin + end) / 2;
+
+		struct Bin {
+			glm::vec3 boxMin, boxMax;
+			unsigned int count;
+		} bins[BINS];
+		for (int b = 0; b < BINS; b++) {
+			bins[b].boxMin = glm::vec3(FLT_MAX);
+			bins[b].boxMax = glm::vec3(-FLT_MAX);
+			bins[b].count = 0;
+		}
+
+		float scale = BINS / extent[axis];
+		auto binOf = [&](int leaf) {
+			float centroid = (nodes[leaf].boundsMin[axis] + nodes[leaf].boundsMax[axis]) * 0.5f;
+			return std::min(BINS - 1, (int)((centroid - centroidMin[axis]) * scale));
+		};
+
+		for (unsigned int i = begin; i < end; i++) {
+			Bin& bin = bins[binOf(leaves[i])];
+			bin.boxMin = glm::min(bin.boxMin, nodes[leaves[i]].boundsMin);
+			bin.boxMax = glm::max(bin.boxMax, nodes[leaves[i]].boundsMax);
+			bin.count++;
+		}
+
+		//sweep from the right to get the cost of every right side, then from the left to pick
+		float rightArea[BINS];
+		unsigned int rightCount[BINS];
+		glm::vec3 sweepMin(FLT_MAX), sweepMax(-FLT_MAX);
+		unsigned int sweepCount = 0;
+		for (int b = BINS - 1; b > 0; b--) {
+			sweepMin = glm::min(sweepMin, bins[b].boxMin);
+			sweepMax = glm::max(sweepMax, bins[b].boxMax);
+			sweepCount += bins[b].count;
+			rightArea[b] = sweepCount ? surfaceArea(sweepMin, sweepMax) : 0.0f;
+			rightCount[b] = sweepCount;
+		}
+
+		float bestCost = FLT_MAX;
+		int bestSplit = 1;
+		sweepMin = glm::vec3(FLT_MAX);
+		sweepMax = glm::vec3(-FLT_MAX);
+		sweepCount = 0;
+		for (int b = 1; b < BINS; b++) {
+			sweepMin = glm::min(sweepMin, bins[b - 1].boxMin);
+			sweepMax = glm::max(sweepMax, bins[b - 1].boxMax);
+			sweepCount += bins[b - 1].count;
+			if (sweepCount == 0 || rightCount[b] == 0)
+				continue;
+			float cost = sweepCount * surfaceArea(sweepMin, sweepMax) + rightCount[b] * rightArea[b];
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestSplit = b;
+			}
+		}
+
+		unsigned int middle = (unsigned int)(std::partition(leaves.begin() + begin, leaves.begin() + end, [&](int leaf) { return binOf(leaf) < bestSplit; }) - leaves.begin());
+		if (middle == begin || middle == end)
+			middle = (begin + end) / 2;
+		return middle;
+	}
+
+	template<typename Overlaps>
+	void traverse(std::vector<unsigned int>& out, Overlaps overlaps) const {
+		if (root == NONE)
+			return;
+		Stack stack;
+		stack.push(root, 0);
+		int index;
+		unsigned int unused;
+		while (stack.pop(index, unused)) {
+			const Node& node = nodes[index];
+			if (!overlaps(node))
+				continue;
+			if (node.isLeaf())
+				out.push_back(node.userData);
+			else {
+				stack.push(node.child0, 0);
+				stack.push(node.child1, 0);
+			}
+		}
+	}
+};
+#endif
@@ -0,0 +1,517 @@
+#pragma once
+
+#ifndef ECS_H
+#define ECS_H
+
+#include "ThreadPool.h"
+
+#include <vector>
+#include <memory>
+#include <bitset>
+#include <unordered_map>
+#include <mutex>
+#include <functional>
+#include <type_traits>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+
+
+//Archetype based entity/component storage.
+//
+//Every distinct set of components is an archetype. An archetype keeps its entities in fixed
+//size chunks, and inside a chunk each component type is its own tightly packed array, so a
+//query walks plain arrays chunk by chunk. Components must be trivially copyable since rows
+//are moved around with memcpy.
+
+const unsigned int MAX_COMPONENTS = 64;
+typedef std::bitset<MAX_COMPONENTS> ComponentMask;
+
+struct Entity {
+	unsigned int index;
+	unsigned int generation;
+
+	bool operator==(const Entity& other) const { return index == other.index && generation == other.generation; }
+	bool operator!=(const Entity& other) const { return !(*this == other); }
+};
+
+
+struct ComponentInfo {
+	size_t size;
+	size_t alignment;
+};
+
+inline std::vector<ComponentInfo>& componentInfos() {
+	static std::vector<ComponentInfo> infos;
+	return infos;
+}
+
+//every id has to fit a ComponentMask; past that there is no sensible way to go on
+inline unsigned int registerComponent(size_t size, size_t alignment) {
+	static std::mutex mutex;
+	std::lock_guard<std::mutex> lock(mutex);
+	if (componentInfos().size() >= MAX_COMPONENTS) {
+		std::cout << "ERROR::ECS::TOO_MANY_COMPONENTS a ComponentMask holds " << MAX_COMPONENTS << " component types" << std::endl;
+		std::abort();
+	}
+	ComponentInfo info = { size, alignment };
+	componentInfos().push_back(info);
+	return (unsigned int)componentInfos().size() - 1;
+}
+
+//small dense id per component type, handed out on first use
+template<typename T>
+unsigned int componentId() {
+	static_assert(std::is_trivially_copyable<T>::value, "components must be trivially copyable");
+	static unsigned int id = registerComponent(sizeof(T), alignof(T));
+	return id;
+}
+
+template<typename... Ts>
+ComponentMask componentMask() {
+	ComponentMask mask;
+	unsigned int ids[] = { 0u, componentId<typename std::remove_const<Ts>::type>()... };
+	for (size_t i = 1; i < sizeof(ids) / sizeof(ids[0]); i++)
+		mask.set(ids[i]);
+	return mask;
+}
+
+
+class World {
+
+public:
+
+	static const size_t CHUNK_BYTES = 16 * 1024;
+
+	World() {}
+	World(const World&) = delete;
+	World& operator=(const World&) = delete;
+
+	template<typename... Ts>
+	Entity create(const Ts&... components) {
+
+		Entity entity = allocateEntity();
+		Archetype* archetype = findArchetype(componentMask<Ts...>());
+		Record& record = records[entity.index];
+		insertRow(archetype, entity, record);
+
+		int expand[] = { 0, (writeComponent(record, components), 0)... };
+		(void)expand;
+		return entity;
+	}
+
+	void destroy(Entity entity) {
+		if (!isAlive(entity))
+			return;
+		Record& record = records[entity.index];
+		removeRow(record);
+		record.archetype = NULL;
+		record.generation++;
+		freeIndices.push_back(entity.index);
+	}
+
+	bool isAlive(Entity entity) const {
+		return entity.index < records.size() && records[entity.index].generation == entity.generation && records[entity.index].archetype;
+	}
+
+	template<typename T>
+	bool has(Entity entity) const {
+		return isAlive(entity) && records[entity.index].archetype->mask.test(componentId<T>());
+	}
+
+	//NULL when the entity does not have the component
+	template<typename T>
+	T* get(Entity entity) {
+		if (!has<T>(entity))
+			return NULL;
+		const Record& record = records[entity.index];
+		return column<T>(*record.archetype, *record.archetype->chunks[record.chunk]) + record.row;
+	}
+
+	//add or overwrite a component, moving the entity to its new archetype if needed
+	template<typename T>
+	void add(Entity entity, const T& component) {
+		if (!isAlive(entity))
+			return;
+		Record& record = records[entity.index];
+		if (!record.archetype->mask.test(componentId<T>())) {
+			ComponentMask mask = record.archetype->mask;
+			mask.set(componentId<T>());
+			moveEntity(entity, findArchetype(mask));
+		}
+		writeComponent(record, component);
+	}
+
+	template<typename T>
+	void remove(Entity entity) {
+		if (!has<T>(entity))
+			return;
+		ComponentMask mask = records[entity.index].archetype->mask;
+		mask.reset(componentId<T>());
+		moveEntity(entity, findArchetype(mask));
+	}
+
+	unsigned int getEntityCount() const {
+		return (unsigned int)(records.size() - freeIndices.size());
+	}
+
+	//fn(count, entities, Ts* arrays...) once per chunk holding all of Ts
+	template<typename... Ts, typename F>
+	void eachChunk(F&& fn) {
+		for (Archetype* archetype : matchingArchetypes(componentMask<Ts...>())) {
+			for (std::unique_ptr<Chunk>& chunk : archetype->chunks)
+				fn(chunk->count, chunk->entities(), column<Ts>(*archetype, *chunk)...);
+		}
+	}
+
+	//fn(Ts&...) once per entity holding all of Ts
+	template<typename... Ts, typename F>
+	void each(F&& fn) {
+		eachChunk<Ts...>([&fn](unsigned int count, const Entity*, Ts*... arrays) {
+			for (unsigned int i = 0; i < count; i++)
+				fn(arrays[i]...);
+		});
+	}
+
+	//eachChunk() with the chunks spread over the pool. fn must only touch the chunk it is given.
+	template<typename... Ts, typename F>
+	void parallelEachChunk(ThreadPool& pool, F&& fn) {
+
+		std::vector<std::pair<Archetype*, Chunk*>> work;
+		for (Archetype* archetype : matchingArchetypes(componentMask<Ts...>())) {
+			for (std::unique_ptr<Chunk>& chunk : archetype->chunks)
+				work.push_back(std::make_pair(archetype, chunk.get()));
+		}
+
+		pool.parallelFor((unsigned int)work.size(), 1, [&](unsigned int begin, unsigned int end, unsigned int) {
+			for (unsigned int i = begin; i < end; i++)
+				fn(work[i].second->count, work[i].second->entities(), column<Ts>(*work[i].first, *work[i].second)...);
+		});
+	}
+
+	//Update a synthetic scene of entityCount moving objects with the scheduler below and print the
+	//cost per frame next to the bytes it streamed. No GL needed.
+	static void benchmark(unsigned int entityCount = 500000, unsigned int frames = 60);
+
+private:
+
+	struct Chunk {
+		std::unique_ptr<unsigned char[]> memory;
+		unsigned char* data; //memory aligned to a cache line
+		unsigned int count;
+
+		Entity* entities() { return (Entity*)data; }
+	};
+
+	struct Archetype {
+		ComponentMask mask;
+		int columnOf[MAX_COMPONENTS];        //component id -> column, -1 when absent
+		std::vector<unsigned int> components; //component id per column
+		std::vector<size_t> offsets;          //byte offset of each column's array in a chunk
+		unsigned int capacity;                //rows per chunk
+		std::vector<std::unique_ptr<Chunk>> chunks;
+	};
+
+	struct Record {
+		Archetype* archetype;
+		unsigned int chunk;
+		unsigned int row;
+		unsigned int generation;
+	};
+
+	std::vector<std::unique_ptr<Archetype>> archetypes;
+	std::vector<Record> records; //indexed by Entity::index
+	std::vector<unsigned int> freeIndices;
+
+	std::mutex queryMutex;
+	std::unordered_map<unsigned long long, std::vector<Archetype*>> queryCache;
+
+	template<typename T>
+	static T* column(Archetype& archetype, Chunk& chunk) {
+		int index = archetype.columnOf[componentId<typename std::remove_const<T>::type>()];
+		return (T*)(chunk.data + archetype.offsets[index]);
+	}
+
+	Entity allocateEntity() {
+		Entity entity;
+		if (!freeIndices.empty()) {
+			entity.index = freeIndices.back();
+			freeIndices.pop_back();
+		}
+		else {
+			entity.index = (unsigned int)records.size();
+			Record record = { NULL, 0, 0, 0 };
+			records.push_back(record);
+		}
+		entity.generation = records[entity.index].generation;
+		return entity;
+	}
+
+	Archetype* findArchetype(const ComponentMask& mask) {
+
+		for (std::unique_ptr<Archetype>& archetype : archetypes) {
+			if (archetype->mask == mask)
+				return archetype.get();
+		}
+
+		std::unique_ptr<Archetype> archetype(new Archetype());
+		archetype->mask = mask;
+		for (unsigned int i = 0; i < MAX_COMPONENTS; i++)
+			archetype->columnOf[i] = -1;
+
+		//entity ids first, then one array per component, each aligned to 16 bytes
+		size_t rowBytes = sizeof(Entity);
+		for (unsigned int id = 0; id < MAX_COMPONENTS; id++) {
+			if (!mask.test(id))
+				continue;
+			archetype->columnOf[id] = (int)archetype->components.size();
+			archetype->components.push_back(id);
+			rowBytes += componentInfos()[id].size;
+		}
+		archetype->capacity = (unsigned int)((CHUNK_BYTES - 16 * (archetype->components.size() + 1)) / rowBytes);
+
+		size_t offset = ((sizeof(Entity) * archetype->capacity) + 15) & ~(size_t)15;
+		for (unsigned int id : archetype->components) {
+			archetype->offsets.push_back(offset);
+			offset = (offset + componentInfos()[id].size * archetype->capacity + 15) & ~(size_t)15;
+		}
+
+		archetypes.push_back(std::move(archetype));
+		std::lock_guard<std::mutex> lock(queryMutex);
+		queryCache.clear();
+		return archetypes.back().get();
+	}
+
+	const std::vector<Archetype*>& matchingArchetypes(const ComponentMask& required) {
+
+		std::lock_guard<std::mutex> lock(queryMutex);
+		std::unordered_map<unsigned long long, std::vector<Archetype*>>::iterator found = queryCache.find(required.to_ullong());
+		if (found != queryCache.end())
+			return found->second;
+
+		std::vector<Archetype*>& matches = queryCache[required.to_ullong()];
+		for (std::unique_ptr<Archetype>& archetype : archetypes) {
+			if ((archetype->mask & required) == required)
+				matches.push_back(archetype.get());
+		}
+		return matches;
+	}
+
+	void insertRow(Archetype* archetype, Entity entity, Record& record) {
+
+		if (archetype->chunks.empty() || archetype->chunks.back()->count == archetype->capacity) {
+			std::unique_ptr<Chunk> chunk(new Chunk());
+			chunk->memory.reset(new unsigned char[CHUNK_BYTES + 64]);
+			chunk->data = (unsigned char*)(((uintptr_t)chunk->memory.get() + 63) & ~(uintptr_t)63);
+			chunk->count = 0;
+			archetype->chunks.push_back(std::move(chunk));
+		}
+
+		Chunk& chunk = *archetype->chunks.back();
+		record.archetype = archetype;
+		record.chunk = (unsigned int)archetype->chunks.size() - 1;
+		record.row = chunk.count++;
+		chunk.entities()[record.row] = entity;
+	}
+
+	//fill the hole with the archetype's last row so chunks stay dense
+	void removeRow(const Record& record) {
+
+		Archetype& archetype = *record.archetype;
+		Chunk& chunk = *archetype.chunks[record.chunk];
+		Chunk& last = *archetype.chunks.back();
+		unsigned int lastRow = last.count - 1;
+
+		if (&chunk != &last || record.row != lastRow) {
+			Entity moved = last.entities()[lastRow];
+			chunk.entities()[record.row] = moved;
+			for (size_t c = 0; c < archetype.components.size(); c++) {
+				size_t size = componentInfos()[archetype.components[c]].size;
+				memcpy(chunk.data + archetype.offsets[c] + size * record.row, last.data + archetype.offsets[c] + size * lastRow, size);
+			}
+			records[moved.index].chunk = record.chunk;
+			records[moved.index].row = record.row;
+		}
+
+		if (--last.count == 0)
+			archetype.chunks.pop_back();
+	}
+
+	void moveEntity(Entity entity, Archetype* target) {
+
+		Record& record = records[entity.index];
+		Record old = record;
+		insertRow(target, entity, record);
+
+		Archetype& source = *old.archetype;
+		Chunk& from = *source.chunks[old.chunk];
+		Chunk& to = *target->chunks[record.chunk];
+		for (size_t c = 0; c < source.components.size(); c++) {
+			int targetColumn = target->columnOf[source.components[c]];
+			if (targetColumn < 0)
+				continue;
+			size_t size = componentInfos()[source.components[c]].size;
+			memcpy(to.data + target->offsets[targetColumn] + size * record.row, from.data + source.offsets[c] + size * old.row, size);
+		}
+
+		//the removal may move another entity into the old row, but never this one's new row
+		removeRow(old);
+	}
+
+	template<typename T>
+	void writeComponent(const Record& record, const T& component) {
+		column<T>(*record.archetype, *record.archetype->chunks[record.chunk])[record.row] = component;
+	}
+};
+
+
+//Runs systems once per frame. Each system declares the components it reads and writes; systems
+//that do not conflict are grouped into the same phase and run side by side on the pool, while
+//conflicting systems keep their registration order. A system added with usesPool spreads its
+//own query over the pool instead, so it gets a phase to itself (pool calls cannot nest).
+class SystemScheduler {
+
+public:
+
+	//pool is only passed when the system has its phase to itself, so it can spread its own query
+	//over it. Systems must not create or destroy entities while the scheduler runs.
+	typedef std::function<void(World&, ThreadPool*)> SystemFunction;
+
+	void add(const char* name, const ComponentMask& reads, const ComponentMask& writes, const SystemFunction& function, bool usesPool = false) {
+		System system = { name, reads, writes, function, usesPool };
+		systems.push_back(system);
+		phasesDirty = true;
+	}
+
+	void run(World& world, ThreadPool& pool) {
+
+		if (phasesDirty)
+			buildPhases();
+
+		for (const std::vector<unsigned int>& phase : phases) {
+			if (phase.size() == 1) {
+				systems[phase[0]].function(world, &pool);
+				continue;
+			}
+			pool.parallelFor((unsigned int)phase.size(), 1, [&](unsigned int begin, unsigned int end, unsigned int) {
+				for (unsigned int i = begin; i < end; i++)
+					systems[phase[i]].function(world, NULL);
+			});
+		}
+	}
+
+	unsigned int getPhaseCount() {
+		if (phasesDirty)
+			buildPhases();
+		return (unsigned int)phases.size();
+	}
+
+private:
+
+	struct System {
+		const char* name;
+		ComponentMask reads;
+		ComponentMask writes;
+		SystemFunction function;
+		bool usesPool;
+	};
+
+	std::vector<System> systems;
+	std::vector<std::vector<unsigned int>> phases;
+	std::vector<char> exclusive; //per phase: holds a usesPool system, nothing joins it
+	bool phasesDirty = false;
+
+	static bool conflicts(const System& a, const System& b) {
+		return (a.writes & (b.reads | b.writes)).any() || (b.writes & a.reads).any();
+	}
+
+	//each system goes in the first shared phase after the last one holding something it conflicts
+	//with; a usesPool system always opens a new one at the end
+	void buildPhases() {
+
+		phases.clear();
+		exclusive.clear();
+		for (unsigned int s = 0; s < systems.size(); s++) {
+			size_t phase = 0;
+			for (size_t p = phases.size(); p-- > 0;) {
+				bool clash = false;
+				for (unsigned int other : phases[p])
+					clash = clash || conflicts(systems[s], systems[other]);
+				if (clash) {
+					phase = p + 1;
+					break;
+				}
+			}
+			while (phase < phases.size() && exclusive[phase])
+				phase++;
+			if (systems[s].usesPool)
+				phase = phases.size();
+			if (phase == phases.size()) {
+				phases.push_back(std::vector<unsigned int>());
+				exclusive.push_back(systems[s].usesPool);
+			}
+			phases[phase].push_back(s);
+		}
+		phasesDirty = false;
+	}
+};
+
+
+inline void World::benchmark(unsigned int entityCount, unsigned int frames) {
+
+	struct Position { float x, y, z; };
+	struct Velocity { float x, y, z; };
+	struct Spin { float angle, speed; };
+
+	World world;
+	for (unsigned int i = 0; i < entityCount; i++) {
+		Position position = { (float)(i % 1000), (float)(i / 1000), 0.0f };
+		Velocity velocity = { 1.0f, 0.5f * (i % 3), -0.25f };
+		if (i % 2) {
+			Spin spin = { 0.0f, 0.1f * (i % 7) };
+			world.create(position, velocity, spin);
+		}
+		else
+			world.create(position, velocity);
+	}
+
+	//movement touches every entity and splits its chunks over the pool, so it runs in a phase of
+	//its own; spin is small enough to run on one thread right after
+	float dt = 1.0f / 60.0f;
+	SystemScheduler scheduler;
+	scheduler.add("movement", componentMask<Velocity>(), componentMask<Position>(), [dt](World& w, ThreadPool* pool) {
+		auto integrate = [dt](unsigned int count, const Entity*, Position* positions, const Velocity* velocities) {
+			for (unsigned int i = 0; i < count; i++) {
+				positions[i].x += velocities[i].x * dt;
+				positions[i].y += velocities[i].y * dt;
+				positions[i].z += velocities[i].z * dt;
+			}
+		};
+		if (pool)
+			w.parallelEachChunk<Position, const Velocity>(*pool, integrate);
+		else
+			w.eachChunk<Position, const Velocity>(integrate);
+	}, true);
+	scheduler.add("spin", ComponentMask(), componentMask<Spin>(), [dt](World& w, ThreadPool*) {
+		w.each<Spin>([dt](Spin& spin) { spin.angle += spin.speed * dt; });
+	});
+
+	ThreadPool pool;
+	double bytes = (double)entityCount * (2 * sizeof(Position) + sizeof(Velocity)) + (entityCount / 2) * 2.0 * sizeof(Spin);
+
+	std::cout << "ECS::BENCHMARK " << entityCount << " entities, " << scheduler.getPhaseCount() << " phase(s), "
+		<< pool.getThreadCount() << " thread(s)" << std::endl;
+
+	double total = 0.0;
+	for (unsigned int frame = 0; frame < frames; frame++) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		scheduler.run(world, pool);
+		total += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	double perFrame = total / frames;
+	std::cout << "    " << perFrame << " ms/frame, " << bytes / (perFrame * 1.0e6) << " GB/s" << std::endl;
+}
+#endif
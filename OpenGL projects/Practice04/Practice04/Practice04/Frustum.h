@@ -0,0 +1,62 @@
+#pragma once
+
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+
+//The six clip planes of a projection, pointing inwards. Planes taken from projection * view
+//are in world space; from projection * view * model they are in that model's object space.
+struct Frustum {
+
+	enum { PLANE_LEFT, PLANE_RIGHT, PLANE_BOTTOM, PLANE_TOP, PLANE_NEAR, PLANE_FAR };
+
+	glm::vec4 planes[6]; //xyz normal, w distance; a point is inside when dot(n, p) + w >= 0
+
+	//Gribb & Hartmann plane extraction. glm matrices are column-major, so row i is m[*][i].
+	static Frustum fromMatrix(const glm::mat4& m) {
+
+		glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+		glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+		glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+		glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+		Frustum frustum;
+		frustum.planes[PLANE_LEFT] = row3 + row0;
+		frustum.planes[PLANE_RIGHT] = row3 - row0;
+		frustum.planes[PLANE_BOTTOM] = row3 + row1;
+		frustum.planes[PLANE_TOP] = row3 - row1;
+		frustum.planes[PLANE_NEAR] = row3 + row2;
+		frustum.planes[PLANE_FAR] = row3 - row2;
+
+		for (int i = 0; i < 6; i++)
+			frustum.planes[i] /= glm::length(glm::vec3(frustum.planes[i]));
+		return frustum;
+	}
+
+	float distance(int plane, const glm::vec3& point) const {
+		return glm::dot(glm::vec3(planes[plane]), point) + planes[plane].w;
+	}
+
+	bool intersectsSphere(const glm::vec3& center, float radius) const {
+		for (int i = 0; i < 6; i++) {
+			if (distance(i, center) < -radius)
+				return false;
+		}
+		return true;
+	}
+
+	//tests the box corner furthest along each plane normal
+	bool intersectsAABB(const glm::vec3& boxMin, const glm::vec3& boxMax) const {
+		for (int i = 0; i < 6; i++) {
+			glm::vec3 positive(planes[i].x >= 0.0f ? boxMax.x : boxMin.x,
+				planes[i].y >= 0.0f ? boxMax.y : boxMin.y,
+				planes[i].z >= 0.0f ? boxMax.z : boxMin.z);
+			if (distance(i, positive) < 0.0f)
+				return false;
+		}
+		return true;
+	}
+};
+#endif
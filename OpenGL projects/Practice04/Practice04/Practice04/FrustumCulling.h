@@ -0,0 +1,268 @@
+#pragma once
+
+#ifndef FRUSTUM_CULLING_H
+#define FRUSTUM_CULLING_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "Frustum.h"
+#include "ThreadPool.h"
+
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define FRUSTUM_CULLING_AVX2 1
+#define FRUSTUM_CULLING_WIDTH 8
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRUSTUM_CULLING_SSE 1
+#define FRUSTUM_CULLING_WIDTH 4
+#else
+#define FRUSTUM_CULLING_WIDTH 1
+#endif
+
+
+//Bounding spheres and boxes of the scene in structure-of-arrays form, tested against the
+//frustum 8 (AVX2) or 4 (SSE) objects per instruction. Arrays are padded to a multiple of 8
+//with entries that can never be visible, so the SIMD loops need no scalar tail.
+class CullingSet {
+
+public:
+
+	std::vector<float> sphereX, sphereY, sphereZ, sphereRadius;
+	std::vector<float> boxCenterX, boxCenterY, boxCenterZ, boxExtentX, boxExtentY, boxExtentZ;
+
+	CullingSet() : sphereCount(0), boxCount(0) {}
+
+	unsigned int addSphere(const glm::vec3& center, float radius) {
+		if (sphereCount == sphereX.size())
+			padSpheres(sphereCount + PADDING);
+		setSphere(sphereCount, center, radius);
+		return sphereCount++;
+	}
+
+	void setSphere(unsigned int index, const glm::vec3& center, float radius) {
+		sphereX[index] = center.x;
+		sphereY[index] = center.y;
+		sphereZ[index] = center.z;
+		sphereRadius[index] = radius;
+	}
+
+	unsigned int addBox(const glm::vec3& boxMin, const glm::vec3& boxMax) {
+		if (boxCount == boxCenterX.size())
+			padBoxes(boxCount + PADDING);
+		setBox(boxCount, boxMin, boxMax);
+		return boxCount++;
+	}
+
+	void setBox(unsigned int index, const glm::vec3& boxMin, const glm::vec3& boxMax) {
+		glm::vec3 center = (boxMin + boxMax) * 0.5f, extent = (boxMax - boxMin) * 0.5f;
+		boxCenterX[index] = center.x; boxCenterY[index] = center.y; boxCenterZ[index] = center.z;
+		boxExtentX[index] = extent.x; boxExtentY[index] = extent.y; boxExtentZ[index] = extent.z;
+	}
+
+	unsigned int getSphereCount() const { return sphereCount; }
+	unsigned int getBoxCount() const { return boxCount; }
+
+	void clear() {
+		sphereCount = boxCount = 0;
+		sphereX.clear(); sphereY.clear(); sphereZ.clear(); sphereRadius.clear();
+		boxCenterX.clear(); boxCenterY.clear(); boxCenterZ.clear();
+		boxExtentX.clear(); boxExtentY.clear(); boxExtentZ.clear();
+	}
+
+	//indices of the spheres touching the frustum, in ascending order
+	void cullSpheres(const Frustum& frustum, std::vector<unsigned int>& visible, ThreadPool* pool = NULL) {
+		run(frustum, visible, pool, sphereCount, false);
+	}
+
+	//indices of the boxes touching the frustum, in ascending order
+	void cullBoxes(const Frustum& frustum, std::vector<unsigned int>& visible, ThreadPool* pool = NULL) {
+		run(frustum, visible, pool, boxCount, true);
+	}
+
+	//Cull a million random spheres and boxes and print nanoseconds per object, single
+	//threaded and across the default pool. Results are checked against the scalar Frustum tests.
+	static void benchmark(unsigned int objectCount = 1000000, unsigned int runs = 20) {
+
+		std::mt19937 random(42);
+		std::uniform_real_distribution<float> position(-500.0f, 500.0f), size(0.5f, 5.0f);
+
+		CullingSet set;
+		for (unsigned int i = 0; i < objectCount; i++) {
+			glm::vec3 center(position(random), position(random) * 0.1f, position(random));
+			float radius = size(random);
+			set.addSphere(center, radius);
+			set.addBox(center - glm::vec3(radius), center + glm::vec3(radius));
+		}
+
+		glm::mat4 viewProjection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 400.0f)
+			* glm::lookAt(glm::vec3(0.0f, 10.0f, 0.0f), glm::vec3(0.0f, 10.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		Frustum frustum = Frustum::fromMatrix(viewProjection);
+
+		std::vector<unsigned int> visible;
+		std::cout << "FRUSTUM_CULLING::BENCHMARK " << objectCount << " objects, " << FRUSTUM_CULLING_WIDTH << " per instruction" << std::endl;
+
+		ThreadPool* pools[2] = { NULL, &defaultThreadPool() };
+		for (int p = 0; p < 2; p++) {
+
+			double sphereTime = 0.0, boxTime = 0.0;
+			size_t sphereVisible = 0, boxVisible = 0;
+			for (unsigned int run = 0; run < runs; run++) {
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				set.cullSpheres(frustum, visible, pools[p]);
+				sphereTime += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+				sphereVisible = visible.size();
+
+				start = std::chrono::steady_clock::now();
+				set.cullBoxes(frustum, visible, pools[p]);
+				boxTime += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+				boxVisible = visible.size();
+			}
+
+			std::cout << "    " << (pools[p] ? pools[p]->getThreadCount() : 1) << " thread(s): spheres "
+				<< sphereTime / runs / objectCount << " ns/object (" << sphereVisible << " visible), boxes "
+				<< boxTime / runs / objectCount << " ns/object (" << boxVisible << " visible)" << std::endl;
+		}
+
+		//reference check
+		size_t expected = 0;
+		for (unsigned int i = 0; i < objectCount; i++)
+			expected += frustum.intersectsSphere(glm::vec3(set.sphereX[i], set.sphereY[i], set.sphereZ[i]), set.sphereRadius[i]);
+		set.cullSpheres(frustum, visible);
+		if (visible.size() != expected)
+			std::cout << "ERROR::FRUSTUM_CULLING::MISMATCH " << visible.size() << " visible, scalar test says " << expected << std::endl;
+	}
+
+private:
+
+	static const unsigned int PADDING = 8;
+	static const unsigned int CHUNK = 16384; //objects per job, a multiple of 8
+
+	unsigned int sphereCount;
+	unsigned int boxCount;
+	std::vector<std::vector<unsigned int> > chunkVisible;
+
+	void padSpheres(size_t size) {
+		sphereX.resize(size, 0.0f); sphereY.resize(size, 0.0f); sphereZ.resize(size, 0.0f);
+		sphereRadius.resize(size, -1e30f);
+	}
+
+	void padBoxes(size_t size) {
+		boxCenterX.resize(size, 1e30f); boxCenterY.resize(size, 1e30f); boxCenterZ.resize(size, 1e30f);
+		boxExtentX.resize(size, 0.0f); boxExtentY.resize(size, 0.0f); boxExtentZ.resize(size, 0.0f);
+	}
+
+	void run(const Frustum& frustum, std::vector<unsigned int>& visible, ThreadPool* pool, unsigned int count, bool boxes) {
+
+		visible.clear();
+		if (count == 0)
+			return;
+
+		if (!pool) {
+			cullRange(frustum, 0, count, boxes, visible);
+			return;
+		}
+
+		unsigned int chunkCount = (count + CHUNK - 1) / CHUNK;
+		if (chunkVisible.size() < chunkCount)
+			chunkVisible.resize(chunkCount);
+
+		pool->parallelFor(chunkCount, 1, [&](unsigned int begin, unsigned int end, unsigned int) {
+			for (unsigned int chunk = begin; chunk < end; chunk++) {
+				chunkVisible[chunk].clear();
+				cullRange(frustum, chunk * CHUNK, std::min(count, (chunk + 1) * CHUNK), boxes, chunkVisible[chunk]);
+			}
+		});
+
+		size_t total = 0;
+		for (unsigned int chunk = 0; chunk < chunkCount; chunk++)
+			total += chunkVisible[chunk].size();
+		visible.reserve(total);
+		for (unsigned int chunk = 0; chunk < chunkCount; chunk++)
+			visible.insert(visible.end(), chunkVisible[chunk].begin(), chunkVisible[chunk].end());
+	}
+
+	//append the visible indices in [begin, end) to out; begin is a multiple of the SIMD width
+	void cullRange(const Frustum& frustum, unsigned int begin, unsigned int end, bool boxes, std::vector<unsigned int>& out) const {
+
+		//a box is outside a plane when its center is further out than its projected extent
+		glm::vec4 absPlanes[6];
+		for (int p = 0; p < 6; p++)
+			absPlanes[p] = glm::abs(frustum.planes[p]);
+
+#if defined(FRUSTUM_CULLING_AVX2)
+		for (unsigned int i = begin; i < end; i += 8) {
+			__m256 x = _mm256_loadu_ps(boxes ? &boxCenterX[i] : &sphereX[i]);
+			__m256 y = _mm256_loadu_ps(boxes ? &boxCenterY[i] : &sphereY[i]);
+			__m256 z = _mm256_loadu_ps(boxes ? &boxCenterZ[i] : &sphereZ[i]);
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+			for (int p = 0; p < 6; p++) {
+				const glm::vec4& plane = frustum.planes[p];
+				__m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(plane.x)), _mm256_mul_ps(y, _mm256_set1_ps(plane.y))),
+					_mm256_add_ps(_mm256_mul_ps(z, _mm256_set1_ps(plane.z)), _mm256_set1_ps(plane.w)));
+				__m256 r;
+				if (boxes)
+					r = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(&boxExtentX[i]), _mm256_set1_ps(absPlanes[p].x)),
+						_mm256_mul_ps(_mm256_loadu_ps(&boxExtentY[i]), _mm256_set1_ps(absPlanes[p].y))),
+						_mm256_mul_ps(_mm256_loadu_ps(&boxExtentZ[i]), _mm256_set1_ps(absPlanes[p].z)));
+				else
+					r = _mm256_loadu_ps(&sphereRadius[i]);
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(d, r), _mm256_setzero_ps(), _CMP_GE_OQ));
+			}
+			appendMask((unsigned int)_mm256_movemask_ps(inside), i, end, out);
+		}
+#elif defined(FRUSTUM_CULLING_SSE)
+		for (unsigned int i = begin; i < end; i += 4) {
+			__m128 x = _mm_loadu_ps(boxes ? &boxCenterX[i] : &sphereX[i]);
+			__m128 y = _mm_loadu_ps(boxes ? &boxCenterY[i] : &sphereY[i]);
+			__m128 z = _mm_loadu_ps(boxes ? &boxCenterZ[i] : &sphereZ[i]);
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+			for (int p = 0; p < 6; p++) {
+				const glm::vec4& plane = frustum.planes[p];
+				__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_mul_ps(y, _mm_set1_ps(plane.y))),
+					_mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+				__m128 r;
+				if (boxes)
+					r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&boxExtentX[i]), _mm_set1_ps(absPlanes[p].x)),
+						_mm_mul_ps(_mm_loadu_ps(&boxExtentY[i]), _mm_set1_ps(absPlanes[p].y))),
+						_mm_mul_ps(_mm_loadu_ps(&boxExtentZ[i]), _mm_set1_ps(absPlanes[p].z)));
+				else
+					r = _mm_loadu_ps(&sphereRadius[i]);
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(d, r), _mm_setzero_ps()));
+			}
+			appendMask((unsigned int)_mm_movemask_ps(inside), i, end, out);
+		}
+#else
+		for (unsigned int i = begin; i < end; i++) {
+			glm::vec3 center = boxes ? glm::vec3(boxCenterX[i], boxCenterY[i], boxCenterZ[i]) : glm::vec3(sphereX[i], sphereY[i], sphereZ[i]);
+			bool inside = true;
+			for (int p = 0; p < 6 && inside; p++) {
+				float r = boxes ? glm::dot(glm::vec3(absPlanes[p]), glm::vec3(boxExtentX[i], boxExtentY[i], boxExtentZ[i])) : sphereRadius[i];
+				inside = frustum.distance(p, center) + r >= 0.0f;
+			}
+			if (inside)
+				out.push_back(i);
+		}
+#endif
+	}
+
+	static void appendMask(unsigned int mask, unsigned int base, unsigned int end, std::vector<unsigned int>& out) {
+		while (mask) {
+			unsigned int lane = 0;
+			while (!(mask & (1u << lane)))
+				lane++;
+			mask &= mask - 1;
+			if (base + lane < end)
+				out.push_back(base + lane);
+		}
+	}
+};
+#endif
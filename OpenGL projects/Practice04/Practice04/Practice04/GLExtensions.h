@@ -0,0 +1,91 @@
+#pragma once
+
+#ifndef GL_EXTENSIONS_H
+#define GL_EXTENSIONS_H
+
+#include <glad/glad.h> //glad is generated for 3.3 core, newer entry points are loaded here
+
+#include <cstring>
+
+
+//----GL 4.4 / ARB_buffer_storage
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#define GL_CLIENT_STORAGE_BIT 0x0200
+#endif
+
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+//----GL 4.3 compute shaders, shader storage buffers and indirect draws
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#define GL_SHADER_STORAGE_BARRIER_BIT 0x00002000
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#define GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT 0x90DF
+#endif
+
+typedef void (APIENTRYP PFNGLDISPATCHCOMPUTEPROC)(GLuint groupsX, GLuint groupsY, GLuint groupsZ);
+typedef void (APIENTRYP PFNGLMEMORYBARRIERPROC)(GLbitfield barriers);
+typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void* indirect, GLsizei drawCount, GLsizei stride);
+
+
+//Entry points and capabilities beyond what glad was generated for. Everything is NULL/false
+//until loadGLExtensions() runs, and stays that way when the driver does not offer it.
+struct GLExtensions {
+	int major = 0;
+	int minor = 0;
+
+	bool bufferStorage = false;
+	PFNGLBUFFERSTORAGEPROC BufferStorage = NULL;
+
+	bool gpuDriven = false; //compute, storage buffers and multi-draw indirect together
+	PFNGLDISPATCHCOMPUTEPROC DispatchCompute = NULL;
+	PFNGLMEMORYBARRIERPROC Barrier = NULL; //glMemoryBarrier, renamed around winnt.h's MemoryBarrier macro
+	PFNGLMULTIDRAWELEMENTSINDIRECTPROC MultiDrawElementsIndirect = NULL;
+};
+
+inline GLExtensions& glExtensions() {
+	static GLExtensions extensions;
+	return extensions;
+}
+
+inline bool hasGLExtension(const char* name) {
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; i++) {
+		const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+		if (extension && strcmp(extension, name) == 0)
+			return true;
+	}
+	return false;
+}
+
+inline bool hasGLVersion(int major, int minor) {
+	const GLExtensions& ext = glExtensions();
+	return ext.major > major || (ext.major == major && ext.minor >= minor);
+}
+
+//call once after gladLoadGLLoader with the same loader
+inline void loadGLExtensions(GLADloadproc load) {
+
+	GLExtensions& ext = glExtensions();
+	glGetIntegerv(GL_MAJOR_VERSION, &ext.major);
+	glGetIntegerv(GL_MINOR_VERSION, &ext.minor);
+
+	if (hasGLVersion(4, 4) || hasGLExtension("GL_ARB_buffer_storage")) {
+		ext.BufferStorage = (PFNGLBUFFERSTORAGEPROC)load("glBufferStorage");
+		ext.bufferStorage = ext.BufferStorage != NULL;
+	}
+
+	if (hasGLVersion(4, 3)) {
+		ext.DispatchCompute = (PFNGLDISPATCHCOMPUTEPROC)load("glDispatchCompute");
+		ext.Barrier = (PFNGLMEMORYBARRIERPROC)load("glMemoryBarrier");
+		ext.MultiDrawElementsIndirect = (PFNGLMULTIDRAWELEMENTSINDIRECTPROC)load("glMultiDrawElementsIndirect");
+		ext.gpuDriven = ext.DispatchCompute && ext.Barrier && ext.MultiDrawElementsIndirect;
+	}
+}
+#endif
@@ -0,0 +1,299 @@
+#pragma once
+
+#ifndef GL_MEMORY_HOOKS_H
+#define GL_MEMORY_HOOKS_H
+
+#include <glad/glad.h>
+#include "GLCalls.h"
+#include "GLExtensions.h"
+#include "MemoryTracker.h"
+
+#include <unordered_map>
+#include <cstdint>
+
+
+//The calls that create, size or delete GL storage, and the binds needed to tell which object
+//they act on.
+#define GL_MEMORY_CALLS(X) \
+	X(BindBuffer) X(BindVertexArray) X(ActiveTexture) X(BindTexture) X(BindRenderbuffer) \
+	X(BufferData) X(TexImage2D) X(TexImage3D) X(GenerateMipmap) X(RenderbufferStorage) \
+	X(DeleteBuffers) X(DeleteVertexArrays) X(DeleteTextures) X(DeleteRenderbuffers)
+
+
+//Feeds gpuMemory() the size of every buffer, texture and renderbuffer the app creates.
+//
+//It is meant to stay on for the whole run: install() right after loadGLExtensions shims only
+//GL_MEMORY_CALLS and glBufferStorage, which GLExtensions.h loads outside glad's table, and each
+//shim is a bind lookup or a map update on top of the real call. It keeps just enough binding
+//state to name the object a call acts on. The element array binding belongs to the vertex array
+//object, as in GL, so it is kept per VAO; every other buffer target, texture unit and the
+//renderbuffer binding are context state.
+class GLMemoryHooks {
+
+public:
+
+	GLMemoryHooks() : installed(false), vertexArray(0), activeTexture(GL_TEXTURE0), renderbuffer(0) {}
+
+	//call after gladLoadGLLoader and loadGLExtensions, before the app creates anything
+	void install();
+	void uninstall();
+
+	bool isInstalled() const { return installed; }
+
+	//----used by the shims
+	void bindBuffer(GLenum target, GLuint buffer) {
+		if (target == GL_ELEMENT_ARRAY_BUFFER)
+			elementBuffers[vertexArray] = buffer;
+		else
+			buffers[target] = buffer;
+	}
+
+	GLuint boundBuffer(GLenum target) const {
+		const std::unordered_map<GLuint, GLuint>& names = target == GL_ELEMENT_ARRAY_BUFFER ? elementBuffers : buffers;
+		std::unordered_map<GLuint, GLuint>::const_iterator found = names.find(target == GL_ELEMENT_ARRAY_BUFFER ? vertexArray : target);
+		return found != names.end() ? found->second : 0;
+	}
+
+	void bindVertexArray(GLuint array) { vertexArray = array; }
+	void setActiveTexture(GLenum unit) { activeTexture = unit; }
+
+	void bindTexture(GLenum target, GLuint texture) { textures[textureSlot(target)] = texture; }
+
+	GLuint boundTexture(GLenum target) const {
+		std::unordered_map<uint64_t, GLuint>::const_iterator found = textures.find(textureSlot(target));
+		return found != textures.end() ? found->second : 0;
+	}
+
+	void bindRenderbuffer(GLuint name) { renderbuffer = name; }
+	GLuint boundRenderbuffer() const { return renderbuffer; }
+
+	//deleting a bound buffer unbinds it from the context and from the bound VAO, but not from others
+	void deleteBuffer(GLuint buffer) {
+		for (std::unordered_map<GLuint, GLuint>::iterator it = buffers.begin(); it != buffers.end(); ++it) {
+			if (it->second == buffer)
+				it->second = 0;
+		}
+		std::unordered_map<GLuint, GLuint>::iterator element = elementBuffers.find(vertexArray);
+		if (element != elementBuffers.end() && element->second == buffer)
+			element->second = 0;
+		gpuMemory().release(GPU_MEMORY_BUFFER, buffer);
+	}
+
+	void deleteVertexArray(GLuint array) {
+		elementBuffers.erase(array);
+		if (array == vertexArray)
+			vertexArray = 0;
+	}
+
+	void deleteTexture(GLuint texture) {
+		for (std::unordered_map<uint64_t, GLuint>::iterator it = textures.begin(); it != textures.end(); ++it) {
+			if (it->second == texture)
+				it->second = 0;
+		}
+		gpuMemory().release(GPU_MEMORY_TEXTURE, texture);
+	}
+
+	void deleteRenderbuffer(GLuint name) {
+		if (renderbuffer == name)
+			renderbuffer = 0;
+		gpuMemory().release(GPU_MEMORY_RENDERBUFFER, name);
+	}
+
+private:
+
+	bool installed;
+	GLuint vertexArray;
+	GLenum activeTexture;
+	GLuint renderbuffer;
+	std::unordered_map<GLuint, GLuint> buffers;        //target -> buffer, all but the element array
+	std::unordered_map<GLuint, GLuint> elementBuffers; //vertex array -> its element array buffer
+	std::unordered_map<uint64_t, GLuint> textures;     //unit and target -> texture
+
+	uint64_t textureSlot(GLenum target) const {
+		return ((uint64_t)activeTexture << 32) | target;
+	}
+};
+
+inline GLMemoryHooks& glMemoryHooks() {
+	static GLMemoryHooks hooks;
+	return hooks;
+}
+
+
+//bytes of a width x height client image, close enough for the common formats
+inline uint64_t glImageBytes(GLsizei width, GLsizei height, GLenum format, GLenum type) {
+	uint64_t components = 4;
+	switch (format) {
+	case GL_RED: case GL_DEPTH_COMPONENT: components = 1; break;
+	case GL_RG: components = 2; break;
+	case GL_RGB: case GL_BGR: components = 3; break;
+	}
+	uint64_t componentBytes = 1;
+	switch (type) {
+	case GL_HALF_FLOAT: case GL_UNSIGNED_SHORT: case GL_SHORT: componentBytes = 2; break;
+	case GL_FLOAT: case GL_UNSIGNED_INT: case GL_INT: componentBytes = 4; break;
+	}
+	return (uint64_t)width * height * components * componentBytes;
+}
+
+//bytes per pixel of the renderbuffer formats in use, 4 for anything else
+inline uint64_t glInternalFormatBytes(GLenum internalFormat) {
+	switch (internalFormat) {
+	case GL_R8: case GL_STENCIL_INDEX8: return 1;
+	case GL_RG8: case GL_R16F: case GL_DEPTH_COMPONENT16: return 2;
+	case GL_RGB8: return 3;
+	case GL_RGBA16F: case GL_RG32F: case GL_DEPTH32F_STENCIL8: return 8;
+	case GL_RGBA32F: return 16;
+	default: return 4;
+	}
+}
+
+
+//What each hooked call does to the binding state or to gpuMemory(), after the real call ran.
+template <int Call>
+struct GLMemoryObserver;
+
+template <> struct GLMemoryObserver<GL_CALL_BindBuffer> {
+	static void observe(GLMemoryHooks& hooks, GLenum target, GLuint buffer) { hooks.bindBuffer(target, buffer); }
+};
+template <> struct GLMemoryObserver<GL_CALL_BindVertexArray> {
+	static void observe(GLMemoryHooks& hooks, GLuint array) { hooks.bindVertexArray(array); }
+};
+template <> struct GLMemoryObserver<GL_CALL_ActiveTexture> {
+	static void observe(GLMemoryHooks& hooks, GLenum unit) { hooks.setActiveTexture(unit); }
+};
+template <> struct GLMemoryObserver<GL_CALL_BindTexture> {
+	static void observe(GLMemoryHooks& hooks, GLenum target, GLuint texture) { hooks.bindTexture(target, texture); }
+};
+template <> struct GLMemoryObserver<GL_CALL_BindRenderbuffer> {
+	static void observe(GLMemoryHooks& hooks, GLenum, GLuint renderbuffer) { hooks.bindRenderbuffer(renderbuffer); }
+};
+template <> struct GLMemoryObserver<GL_CALL_BufferData> {
+	static void observe(GLMemoryHooks& hooks, GLenum target, GLsizeiptr size, const void*, GLenum) {
+		gpuMemory().setSize(GPU_MEMORY_BUFFER, hooks.boundBuffer(target), (uint64_t)size);
+	}
+};
+template <> struct GLMemoryObserver<GL_CALL_TexImage2D> {
+	static void observe(GLMemoryHooks& hooks, GLenum target, GLint level, GLint, GLsizei width, GLsizei height, GLint, GLenum format, GLenum type, const void*) {
+		//the six cube faces share the cube map binding
+		GLenum binding = target >= GL_TEXTURE_CUBE_MAP_POSITIVE_X && target <= GL_TEXTURE_CUBE_MAP_NEGATIVE_Z ? GL_TEXTURE_CUBE_MAP : target;
+		gpuMemory().setTextureLevel(hooks.boundTexture(binding), level, glImageBytes(width, height, format, type));
+	}
+};
+template <> struct GLMemoryObserver<GL_CALL_TexImage3D> {
+	static void observe(GLMemoryHooks& hooks, GLenum target, GLint level, GLint, GLsizei width, GLsizei height, GLsizei depth, GLint, GLenum format, GLenum type, const void*) {
+		gpuMemory().setTextureLevel(hooks.boundTexture(target), level, glImageBytes(width, height, format, type) * depth);
+	}
+};
+template <> struct GLMemoryObserver<GL_CALL_GenerateMipmap> {
+	static void observe(GLMemoryHooks& hooks, GLenum target) { gpuMemory().generateMipmaps(hooks.boundTexture(target)); }
+};
+template <> struct GLMemoryObserver<GL_CALL_RenderbufferStorage> {
+	static void observe(GLMemoryHooks& hooks, GLenum, GLenum internalFormat, GLsizei width, GLsizei height) {
+		gpuMemory().setSize(GPU_MEMORY_RENDERBUFFER, hooks.boundRenderbuffer(), (uint64_t)width * height * glInternalFormatBytes(internalFormat));
+	}
+};
+template <> struct GLMemoryObserver<GL_CALL_DeleteBuffers> {
+	static void observe(GLMemoryHooks& hooks, GLsizei count, const GLuint* names) {
+		for (GLsizei i = 0; i < count; i++)
+			hooks.deleteBuffer(names[i]);
+	}
+};
+template <> struct GLMemoryObserver<GL_CALL_DeleteVertexArrays> {
+	static void observe(GLMemoryHooks& hooks, GLsizei count, const GLuint* names) {
+		for (GLsizei i = 0; i < count; i++)
+			hooks.deleteVertexArray(names[i]);
+	}
+};
+template <> struct GLMemoryObserver<GL_CALL_DeleteTextures> {
+	static void observe(GLMemoryHooks& hooks, GLsizei count, const GLuint* names) {
+		for (GLsizei i = 0; i < count; i++)
+			hooks.deleteTexture(names[i]);
+	}
+};
+template <> struct GLMemoryObserver<GL_CALL_DeleteRenderbuffers> {
+	static void observe(GLMemoryHooks& hooks, GLsizei count, const GLuint* names) {
+		for (GLsizei i = 0; i < count; i++)
+			hooks.deleteRenderbuffer(names[i]);
+	}
+};
+
+
+//glBufferStorage: immutable storage, sized like glBufferData
+inline PFNGLBUFFERSTORAGEPROC& glMemoryBufferStorageOriginal() {
+	static PFNGLBUFFERSTORAGEPROC original = NULL;
+	return original;
+}
+
+inline void APIENTRY glMemoryBufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags) {
+	glMemoryBufferStorageOriginal()(target, size, data, flags);
+	MemoryTagScope tag(MEMORY_TAG_TOOLS);
+	gpuMemory().setSize(GPU_MEMORY_BUFFER, glMemoryHooks().boundBuffer(target), (uint64_t)size);
+}
+
+
+template <int Call, typename Function>
+struct GLMemoryShim;
+
+template <int Call, typename... Arguments>
+struct GLMemoryShim<Call, void (APIENTRYP)(Arguments...)> {
+	typedef void (APIENTRYP Function)(Arguments...);
+	static Function original;
+
+	static void APIENTRY call(Arguments... arguments) {
+		original(arguments...);
+		MemoryTagScope tag(MEMORY_TAG_TOOLS);
+		GLMemoryObserver<Call>::observe(glMemoryHooks(), arguments...);
+	}
+};
+
+template <int Call, typename... Arguments>
+typename GLMemoryShim<Call, void (APIENTRYP)(Arguments...)>::Function GLMemoryShim<Call, void (APIENTRYP)(Arguments...)>::original = NULL;
+
+
+inline void GLMemoryHooks::install() {
+
+	if (installed)
+		return;
+
+#define GL_MEMORY_INSTALL(name) \
+	if (glad_gl##name) { \
+		GLMemoryShim<GL_CALL_##name, decltype(glad_gl##name)>::original = glad_gl##name; \
+		glad_gl##name = &GLMemoryShim<GL_CALL_##name, decltype(glad_gl##name)>::call; \
+	}
+	GL_MEMORY_CALLS(GL_MEMORY_INSTALL)
+#undef GL_MEMORY_INSTALL
+	GLExtensions& ext = glExtensions();
+	if (ext.BufferStorage) {
+		glMemoryBufferStorageOriginal() = ext.BufferStorage;
+		ext.BufferStorage = &glMemoryBufferStorage;
+	}
+
+	//what was bound before install() is unknown; a fresh context has nothing bound
+	buffers.clear();
+	elementBuffers.clear();
+	textures.clear();
+	vertexArray = 0;
+	activeTexture = GL_TEXTURE0;
+	renderbuffer = 0;
+	installed = true;
+}
+
+inline void GLMemoryHooks::uninstall() {
+
+	if (!installed)
+		return;
+
+#define GL_MEMORY_UNINSTALL(name) \
+	if (GLMemoryShim<GL_CALL_##name, decltype(glad_gl##name)>::original) \
+		glad_gl##name = GLMemoryShim<GL_CALL_##name, decltype(glad_gl##name)>::original;
+	GL_MEMORY_CALLS(GL_MEMORY_UNINSTALL)
+#undef GL_MEMORY_UNINSTALL
+	if (glMemoryBufferStorageOriginal()) {
+		glExtensions().BufferStorage = glMemoryBufferStorageOriginal();
+		glMemoryBufferStorageOriginal() = NULL;
+	}
+
+	installed = false;
+}
+#endif
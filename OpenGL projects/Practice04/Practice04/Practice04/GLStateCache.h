@@ -0,0 +1,526 @@
+#pragma once
+
+#ifndef GL_STATE_CACHE_H
+#define GL_STATE_CACHE_H
+
+#include <glad/glad.h>
+
+#include <iostream>
+
+
+//Shadow copy of the GL state the render loop touches. Every setter compares against the
+//shadow and only reaches the driver when the value actually changes. Anything that calls GL
+//directly behind the cache's back must be followed by invalidate().
+//
+//Counters are kept per category and per frame. With debug mode on every setter re-reads the
+//real state through glGet* afterwards, whether it reached the driver or was skipped, and
+//reports any mismatch; a skipped call that disagrees means GL was changed behind the cache.
+//beginFrame() then also runs validate() over everything the cache knows.
+class GLStateCache {
+
+public:
+
+	enum Category {
+		STATE_PROGRAM,
+		STATE_VERTEX_ARRAY,
+		STATE_BUFFER,
+		STATE_TEXTURE,
+		STATE_SAMPLER,
+		STATE_BLEND,
+		STATE_DEPTH,
+		STATE_VIEWPORT,
+		STATE_CLEAR_COLOR,
+		STATE_RASTER, //face culling and the scissor test
+		STATE_CATEGORY_COUNT
+	};
+
+	struct Counters {
+		unsigned int issued[STATE_CATEGORY_COUNT];
+		unsigned int skipped[STATE_CATEGORY_COUNT];
+
+		unsigned int totalIssued() const {
+			unsigned int total = 0;
+			for (int i = 0; i < STATE_CATEGORY_COUNT; i++)
+				total += issued[i];
+			return total;
+		}
+		unsigned int totalSkipped() const {
+			unsigned int total = 0;
+			for (int i = 0; i < STATE_CATEGORY_COUNT; i++)
+				total += skipped[i];
+			return total;
+		}
+	};
+
+	static const unsigned int TEXTURE_UNITS = 16;
+	static const unsigned int UNIFORM_BINDINGS = 8; //indexed uniform buffer bindings the cache tracks
+
+	bool debug;
+
+	GLStateCache() : debug(false), mismatches(0) {
+		invalidate();
+		clearCounters(current);
+		clearCounters(lastFrame);
+	}
+
+	//forget the shadow state; the next call of every setter goes through
+	void invalidate() {
+		program = UNKNOWN;
+		vertexArray = UNKNOWN;
+		for (int i = 0; i < BUFFER_TARGETS; i++)
+			buffers[i] = UNKNOWN;
+		for (unsigned int i = 0; i < UNIFORM_BINDINGS; i++)
+			uniformRanges[i].buffer = UNKNOWN;
+		activeUnit = UNKNOWN;
+		for (unsigned int unit = 0; unit < TEXTURE_UNITS; unit++) {
+			for (int i = 0; i < TEXTURE_TARGETS; i++)
+				textures[unit][i] = UNKNOWN;
+			samplers[unit] = UNKNOWN;
+		}
+		blend = UNKNOWN;
+		blendSource = blendDestination = blendSourceAlpha = blendDestinationAlpha = UNKNOWN;
+		cullFace = scissorTest = UNKNOWN;
+		depthTest = UNKNOWN;
+		depthFunction = UNKNOWN;
+		depthWrite = UNKNOWN;
+		viewportValid = false;
+		clearColorValid = false;
+	}
+
+	//start counting a new frame; the finished frame stays readable through getLastFrame()
+	void beginFrame() {
+		lastFrame = current;
+		clearCounters(current);
+		if (debug)
+			validate();
+	}
+
+	const Counters& getLastFrame() const { return lastFrame; }
+	const Counters& getCurrentFrame() const { return current; }
+
+	static const char* categoryName(int category) {
+		static const char* names[STATE_CATEGORY_COUNT] = {
+			"program", "vertex array", "buffer", "texture", "sampler", "blend", "depth", "viewport", "clear color", "raster"
+		};
+		return names[category];
+	}
+
+	void printLastFrame() const {
+		std::cout << "GL_STATE_CACHE::FRAME issued " << lastFrame.totalIssued() << " skipped " << lastFrame.totalSkipped() << std::endl;
+		for (int i = 0; i < STATE_CATEGORY_COUNT; i++) {
+			if (lastFrame.issued[i] || lastFrame.skipped[i])
+				std::cout << "    " << categoryName(i) << ": issued " << lastFrame.issued[i] << ", skipped " << lastFrame.skipped[i] << std::endl;
+		}
+	}
+
+	void useProgram(GLuint id) {
+		if (changed(STATE_PROGRAM, program, id))
+			glUseProgram(id);
+		check(GL_CURRENT_PROGRAM, id, "program");
+	}
+
+	void bindVertexArray(GLuint id) {
+		if (changed(STATE_VERTEX_ARRAY, vertexArray, id)) {
+			glBindVertexArray(id);
+			//the element buffer binding belongs to the VAO
+			buffers[bufferSlot(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+		}
+		check(GL_VERTEX_ARRAY_BINDING, id, "vertex array");
+	}
+
+	void bindBuffer(GLenum target, GLuint id) {
+		int slot = bufferSlot(target);
+		if (slot < 0) {
+			count(STATE_BUFFER, true);
+			glBindBuffer(target, id);
+			return;
+		}
+		if (changed(STATE_BUFFER, buffers[slot], id))
+			glBindBuffer(target, id);
+		check(bufferBindingQuery(target), id, "buffer");
+	}
+
+	//A range of a buffer on an indexed binding point, e.g. one object's slot for a uniform block.
+	//GL binds the generic target as well, so the cache does too.
+	void bindBufferRange(GLenum target, GLuint index, GLuint id, GLintptr offset, GLsizeiptr size) {
+		int slot = bufferSlot(target);
+		if (target != GL_UNIFORM_BUFFER || index >= UNIFORM_BINDINGS) {
+			count(STATE_BUFFER, true);
+			glBindBufferRange(target, index, id, offset, size);
+			if (slot >= 0)
+				buffers[slot] = id;
+			return;
+		}
+		UniformRange& range = uniformRanges[index];
+		bool different = range.buffer != id || range.offset != offset || range.size != size;
+		count(STATE_BUFFER, different);
+		if (different) {
+			glBindBufferRange(target, index, id, offset, size);
+			range.buffer = id;
+			range.offset = offset;
+			range.size = size;
+			buffers[slot] = id;
+		}
+		checkIndexed(GL_UNIFORM_BUFFER_BINDING, index, id, "uniform buffer range");
+	}
+
+	void bindTexture(unsigned int unit, GLenum target, GLuint id) {
+		int slot = textureSlot(target);
+		if (unit >= TEXTURE_UNITS || slot < 0) {
+			count(STATE_TEXTURE, true);
+			setActiveUnit(unit);
+			glBindTexture(target, id);
+			return;
+		}
+		if (changed(STATE_TEXTURE, textures[unit][slot], id)) {
+			setActiveUnit(unit);
+			glBindTexture(target, id);
+		}
+		checkUnit(unit, textureBindingQuery(target), id, "texture");
+	}
+
+	void bindSampler(unsigned int unit, GLuint id) {
+		if (unit >= TEXTURE_UNITS) {
+			count(STATE_SAMPLER, true);
+			glBindSampler(unit, id);
+			return;
+		}
+		if (changed(STATE_SAMPLER, samplers[unit], id))
+			glBindSampler(unit, id);
+		checkUnit(unit, GL_SAMPLER_BINDING, id, "sampler");
+	}
+
+	void setBlend(bool enabled) {
+		if (changed(STATE_BLEND, blend, enabled)) {
+			if (enabled)
+				glEnable(GL_BLEND);
+			else
+				glDisable(GL_BLEND);
+		}
+		check(GL_BLEND, enabled, "blend");
+	}
+
+	void blendFunc(GLenum source, GLenum destination) {
+		if (source == blendSource && destination == blendDestination && source == blendSourceAlpha && destination == blendDestinationAlpha)
+			count(STATE_BLEND, false);
+		else {
+			count(STATE_BLEND, true);
+			blendSource = blendSourceAlpha = source;
+			blendDestination = blendDestinationAlpha = destination;
+			glBlendFunc(source, destination);
+		}
+		checkBlendFunc();
+	}
+
+	void blendFuncSeparate(GLenum source, GLenum destination, GLenum sourceAlpha, GLenum destinationAlpha) {
+		if (source == blendSource && destination == blendDestination && sourceAlpha == blendSourceAlpha && destinationAlpha == blendDestinationAlpha)
+			count(STATE_BLEND, false);
+		else {
+			count(STATE_BLEND, true);
+			blendSource = source;
+			blendDestination = destination;
+			blendSourceAlpha = sourceAlpha;
+			blendDestinationAlpha = destinationAlpha;
+			glBlendFuncSeparate(source, destination, sourceAlpha, destinationAlpha);
+		}
+		checkBlendFunc();
+	}
+
+	void setDepthTest(bool enabled) {
+		if (changed(STATE_DEPTH, depthTest, enabled)) {
+			if (enabled)
+				glEnable(GL_DEPTH_TEST);
+			else
+				glDisable(GL_DEPTH_TEST);
+		}
+		check(GL_DEPTH_TEST, enabled, "depth test");
+	}
+
+	void depthFunc(GLenum function) {
+		if (changed(STATE_DEPTH, depthFunction, function))
+			glDepthFunc(function);
+		check(GL_DEPTH_FUNC, function, "depth func");
+	}
+
+	void depthMask(bool write) {
+		if (changed(STATE_DEPTH, depthWrite, write))
+			glDepthMask(write ? GL_TRUE : GL_FALSE);
+		check(GL_DEPTH_WRITEMASK, write, "depth mask");
+	}
+
+	void setCullFace(bool enabled) {
+		if (changed(STATE_RASTER, cullFace, enabled)) {
+			if (enabled)
+				glEnable(GL_CULL_FACE);
+			else
+				glDisable(GL_CULL_FACE);
+		}
+		check(GL_CULL_FACE, enabled, "cull face");
+	}
+
+	void setScissorTest(bool enabled) {
+		if (changed(STATE_RASTER, scissorTest, enabled)) {
+			if (enabled)
+				glEnable(GL_SCISSOR_TEST);
+			else
+				glDisable(GL_SCISSOR_TEST);
+		}
+		check(GL_SCISSOR_TEST, enabled, "scissor test");
+	}
+
+	void viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+		if (viewportValid && x == viewportRect[0] && y == viewportRect[1] && width == viewportRect[2] && height == viewportRect[3])
+			count(STATE_VIEWPORT, false);
+		else {
+			count(STATE_VIEWPORT, true);
+			viewportRect[0] = x; viewportRect[1] = y; viewportRect[2] = width; viewportRect[3] = height;
+			viewportValid = true;
+			glViewport(x, y, width, height);
+		}
+		checkViewport();
+	}
+
+	void clearColor(float r, float g, float b, float a) {
+		if (clearColorValid && r == clearRGBA[0] && g == clearRGBA[1] && b == clearRGBA[2] && a == clearRGBA[3])
+			count(STATE_CLEAR_COLOR, false);
+		else {
+			count(STATE_CLEAR_COLOR, true);
+			clearRGBA[0] = r; clearRGBA[1] = g; clearRGBA[2] = b; clearRGBA[3] = a;
+			clearColorValid = true;
+			glClearColor(r, g, b, a);
+		}
+		checkClearColor();
+	}
+
+	//compare the whole shadow state with the driver; beginFrame() does this in debug mode.
+	//Leaves the active texture unit as it found it.
+	bool validate() {
+		static const GLenum bufferTargets[BUFFER_TARGETS] = {
+			GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_UNIFORM_BUFFER, GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER
+		};
+		static const GLenum textureTargets[TEXTURE_TARGETS] = {
+			GL_TEXTURE_2D, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_3D
+		};
+
+		bool saved = debug;
+		debug = true;
+		mismatches = 0;
+		if (program != UNKNOWN) check(GL_CURRENT_PROGRAM, program, "program");
+		if (vertexArray != UNKNOWN) check(GL_VERTEX_ARRAY_BINDING, vertexArray, "vertex array");
+		for (int i = 0; i < BUFFER_TARGETS; i++) {
+			if (buffers[i] != UNKNOWN)
+				check(bufferBindingQuery(bufferTargets[i]), buffers[i], "buffer");
+		}
+		for (unsigned int i = 0; i < UNIFORM_BINDINGS; i++) {
+			if (uniformRanges[i].buffer != UNKNOWN)
+				checkIndexed(GL_UNIFORM_BUFFER_BINDING, i, uniformRanges[i].buffer, "uniform buffer range");
+		}
+		if (blend != UNKNOWN) check(GL_BLEND, blend, "blend");
+		if (blendSource != UNKNOWN) check(GL_BLEND_SRC_RGB, blendSource, "blend source");
+		if (blendDestination != UNKNOWN) check(GL_BLEND_DST_RGB, blendDestination, "blend destination");
+		if (blendSourceAlpha != UNKNOWN) check(GL_BLEND_SRC_ALPHA, blendSourceAlpha, "blend source alpha");
+		if (blendDestinationAlpha != UNKNOWN) check(GL_BLEND_DST_ALPHA, blendDestinationAlpha, "blend destination alpha");
+		if (cullFace != UNKNOWN) check(GL_CULL_FACE, cullFace, "cull face");
+		if (scissorTest != UNKNOWN) check(GL_SCISSOR_TEST, scissorTest, "scissor test");
+		if (depthTest != UNKNOWN) check(GL_DEPTH_TEST, depthTest, "depth test");
+		if (depthFunction != UNKNOWN) check(GL_DEPTH_FUNC, depthFunction, "depth func");
+		if (depthWrite != UNKNOWN) check(GL_DEPTH_WRITEMASK, depthWrite, "depth mask");
+		checkViewport();
+		checkClearColor();
+
+		GLint restoreUnit = 0;
+		glGetIntegerv(GL_ACTIVE_TEXTURE, &restoreUnit);
+		if (activeUnit != UNKNOWN && (GLuint)restoreUnit != GL_TEXTURE0 + activeUnit) {
+			mismatches++;
+			std::cout << "ERROR::GL_STATE_CACHE::MISMATCH active texture cached " << activeUnit << " actual " << restoreUnit - GL_TEXTURE0 << std::endl;
+		}
+		for (unsigned int unit = 0; unit < TEXTURE_UNITS; unit++) {
+			bool known = samplers[unit] != UNKNOWN;
+			for (int i = 0; i < TEXTURE_TARGETS; i++)
+				known = known || textures[unit][i] != UNKNOWN;
+			if (!known)
+				continue;
+			glActiveTexture(GL_TEXTURE0 + unit);
+			for (int i = 0; i < TEXTURE_TARGETS; i++) {
+				if (textures[unit][i] != UNKNOWN)
+					check(textureBindingQuery(textureTargets[i]), textures[unit][i], "texture");
+			}
+			if (samplers[unit] != UNKNOWN)
+				check(GL_SAMPLER_BINDING, samplers[unit], "sampler");
+		}
+		glActiveTexture(restoreUnit);
+		activeUnit = (GLuint)restoreUnit - GL_TEXTURE0;
+
+		debug = saved;
+		return mismatches == 0;
+	}
+
+private:
+
+	static const GLuint UNKNOWN = 0xffffffff;
+	static const int BUFFER_TARGETS = 5;
+	static const int TEXTURE_TARGETS = 4;
+
+	GLuint program;
+	GLuint vertexArray;
+	GLuint buffers[BUFFER_TARGETS];
+	struct UniformRange {
+		GLuint buffer;
+		GLintptr offset;
+		GLsizeiptr size;
+	} uniformRanges[UNIFORM_BINDINGS];
+	GLuint activeUnit;
+	GLuint textures[TEXTURE_UNITS][TEXTURE_TARGETS];
+	GLuint samplers[TEXTURE_UNITS];
+	GLuint blend, blendSource, blendDestination, blendSourceAlpha, blendDestinationAlpha;
+	GLuint cullFace, scissorTest;
+	GLuint depthTest, depthFunction, depthWrite;
+	GLint viewportRect[4];
+	bool viewportValid;
+	float clearRGBA[4];
+	bool clearColorValid;
+
+	Counters current;
+	Counters lastFrame;
+	unsigned int mismatches;
+
+	static void clearCounters(Counters& counters) {
+		for (int i = 0; i < STATE_CATEGORY_COUNT; i++)
+			counters.issued[i] = counters.skipped[i] = 0;
+	}
+
+	void count(Category category, bool issued) {
+		if (issued)
+			current.issued[category]++;
+		else
+			current.skipped[category]++;
+	}
+
+	//true (and the shadow updated) when value differs from the cached one
+	bool changed(Category category, GLuint& cached, GLuint value) {
+		bool different = cached != value;
+		count(category, different);
+		cached = value;
+		return different;
+	}
+
+	void setActiveUnit(unsigned int unit) {
+		if (activeUnit != unit) {
+			glActiveTexture(GL_TEXTURE0 + unit);
+			activeUnit = unit;
+		}
+	}
+
+	static int bufferSlot(GLenum target) {
+		switch (target) {
+		case GL_ARRAY_BUFFER: return 0;
+		case GL_ELEMENT_ARRAY_BUFFER: return 1;
+		case GL_UNIFORM_BUFFER: return 2;
+		case GL_COPY_READ_BUFFER: return 3;
+		case GL_COPY_WRITE_BUFFER: return 4;
+		default: return -1;
+		}
+	}
+
+	static GLenum bufferBindingQuery(GLenum target) {
+		switch (target) {
+		case GL_ARRAY_BUFFER: return GL_ARRAY_BUFFER_BINDING;
+		case GL_ELEMENT_ARRAY_BUFFER: return GL_ELEMENT_ARRAY_BUFFER_BINDING;
+		case GL_UNIFORM_BUFFER: return GL_UNIFORM_BUFFER_BINDING;
+		case GL_COPY_READ_BUFFER: return GL_COPY_READ_BUFFER; //the target doubles as its binding query
+		case GL_COPY_WRITE_BUFFER: return GL_COPY_WRITE_BUFFER;
+		default: return 0;
+		}
+	}
+
+	static int textureSlot(GLenum target) {
+		switch (target) {
+		case GL_TEXTURE_2D: return 0;
+		case GL_TEXTURE_CUBE_MAP: return 1;
+		case GL_TEXTURE_2D_ARRAY: return 2;
+		case GL_TEXTURE_3D: return 3;
+		default: return -1;
+		}
+	}
+
+	static GLenum textureBindingQuery(GLenum target) {
+		switch (target) {
+		case GL_TEXTURE_2D: return GL_TEXTURE_BINDING_2D;
+		case GL_TEXTURE_CUBE_MAP: return GL_TEXTURE_BINDING_CUBE_MAP;
+		case GL_TEXTURE_2D_ARRAY: return GL_TEXTURE_BINDING_2D_ARRAY;
+		case GL_TEXTURE_3D: return GL_TEXTURE_BINDING_3D;
+		default: return 0;
+		}
+	}
+
+	//debug mode: read the state back from the driver and compare
+	void check(GLenum query, GLuint expected, const char* what) {
+		if (!debug || query == 0)
+			return;
+		GLint actual = 0;
+		glGetIntegerv(query, &actual);
+		if ((GLuint)actual != expected) {
+			mismatches++;
+			std::cout << "ERROR::GL_STATE_CACHE::MISMATCH " << what << " cached " << expected << " actual " << actual << std::endl;
+		}
+	}
+
+	//bindings of an indexed binding point
+	void checkIndexed(GLenum query, GLuint index, GLuint expected, const char* what) {
+		if (!debug)
+			return;
+		GLint actual = 0;
+		glGetIntegeri_v(query, index, &actual);
+		if ((GLuint)actual != expected) {
+			mismatches++;
+			std::cout << "ERROR::GL_STATE_CACHE::MISMATCH " << what << " " << index << " cached " << expected << " actual " << actual << std::endl;
+		}
+	}
+
+	//bindings that live per texture unit; the skipped path may find another unit active
+	void checkUnit(unsigned int unit, GLenum query, GLuint expected, const char* what) {
+		if (!debug || query == 0)
+			return;
+		GLint active = 0;
+		glGetIntegerv(GL_ACTIVE_TEXTURE, &active);
+		glActiveTexture(GL_TEXTURE0 + unit);
+		check(query, expected, what);
+		glActiveTexture(active);
+	}
+
+	void checkBlendFunc() {
+		check(GL_BLEND_SRC_RGB, blendSource, "blend source");
+		check(GL_BLEND_DST_RGB, blendDestination, "blend destination");
+		check(GL_BLEND_SRC_ALPHA, blendSourceAlpha, "blend source alpha");
+		check(GL_BLEND_DST_ALPHA, blendDestinationAlpha, "blend destination alpha");
+	}
+
+	void checkViewport() {
+		if (!debug || !viewportValid)
+			return;
+		GLint actual[4];
+		glGetIntegerv(GL_VIEWPORT, actual);
+		if (actual[0] != viewportRect[0] || actual[1] != viewportRect[1] || actual[2] != viewportRect[2] || actual[3] != viewportRect[3]) {
+			mismatches++;
+			std::cout << "ERROR::GL_STATE_CACHE::MISMATCH viewport cached " << viewportRect[2] << "x" << viewportRect[3]
+				<< " at " << viewportRect[0] << "," << viewportRect[1] << " actual " << actual[2] << "x" << actual[3]
+				<< " at " << actual[0] << "," << actual[1] << std::endl;
+		}
+	}
+
+	void checkClearColor() {
+		if (!debug || !clearColorValid)
+			return;
+		GLfloat actual[4];
+		glGetFloatv(GL_COLOR_CLEAR_VALUE, actual);
+		for (int i = 0; i < 4; i++) {
+			if (actual[i] != clearRGBA[i]) {
+				mismatches++;
+				std::cout << "ERROR::GL_STATE_CACHE::MISMATCH clear color cached " << clearRGBA[0] << "," << clearRGBA[1] << "," << clearRGBA[2] << "," << clearRGBA[3]
+					<< " actual " << actual[0] << "," << actual[1] << "," << actual[2] << "," << actual[3] << std::endl;
+				return;
+			}
+		}
+	}
+};
+#endif
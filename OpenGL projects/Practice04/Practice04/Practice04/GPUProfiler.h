@@ -0,0 +1,263 @@
+#pragma once
+
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <string>
+#include <map>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+
+
+//GPU time per named scope, from GL_TIMESTAMP queries.
+//
+//Every scope drops a timestamp query at its start and end, so scopes nest freely (GL_TIME_ELAPSED
+//queries cannot). The queries of a frame are only read back LATENCY frames later, when they have
+//long finished, so the profiler never waits on the GPU; if a frame's results are still not in by
+//then they are dropped and counted. Query objects are pooled and reused.
+//
+//Each scope also records CPU time. GPU timestamps are moved onto the CPU clock with an offset
+//measured through glGetInteger64v(GL_TIMESTAMP), so one timeline shows both.
+class GPUProfiler {
+
+public:
+
+	static const unsigned int LATENCY = 4;   //frames between issuing queries and reading them
+	static const unsigned int HISTORY = 256; //samples per scope kept for the rolling statistics
+
+	//one scope of a resolved frame, in milliseconds from the CPU start of that frame
+	struct TimelineEntry {
+		const char* name;
+		unsigned int depth;
+		double cpuBegin, cpuEnd;
+		double gpuBegin, gpuEnd;
+	};
+
+	struct ScopeStats {
+		double min, average, max, p99; //GPU milliseconds
+		unsigned int samples;
+	};
+
+	GPUProfiler() : frame(0), offsetNanoseconds(0), droppedFrames(0) {}
+
+	//resolve the frame issued LATENCY frames ago and start recording a new one
+	void beginFrame() {
+
+		if (frame % 256 == 0)
+			calibrate();
+
+		FrameSlot& slot = slots[frame % LATENCY];
+		if (!slot.scopes.empty()) {
+			resolve(slot);
+			for (const PendingScope& scope : slot.scopes) {
+				freeQueries.push_back(scope.beginQuery);
+				freeQueries.push_back(scope.endQuery);
+			}
+			slot.scopes.clear();
+		}
+
+		slot.cpuStart = cpuNanoseconds();
+		openScopes.clear();
+		frame++;
+	}
+
+	//name must outlive the profiler; string literals are the intended use
+	void beginScope(const char* name) {
+		FrameSlot& slot = currentSlot();
+		PendingScope scope;
+		scope.name = name;
+		scope.depth = (unsigned int)openScopes.size();
+		scope.beginQuery = acquireQuery();
+		scope.endQuery = acquireQuery();
+		scope.cpuBegin = cpuNanoseconds();
+		scope.cpuEnd = scope.cpuBegin;
+		glQueryCounter(scope.beginQuery, GL_TIMESTAMP);
+		slot.lastQuery = scope.beginQuery;
+		openScopes.push_back((unsigned int)slot.scopes.size());
+		slot.scopes.push_back(scope);
+	}
+
+	void endScope() {
+		if (openScopes.empty())
+			return;
+		PendingScope& scope = currentSlot().scopes[openScopes.back()];
+		openScopes.pop_back();
+		glQueryCounter(scope.endQuery, GL_TIMESTAMP);
+		currentSlot().lastQuery = scope.endQuery;
+		scope.cpuEnd = cpuNanoseconds();
+	}
+
+	//scopes of the most recently resolved frame, in the order they were opened
+	const std::vector<TimelineEntry>& getTimeline() const { return timeline; }
+
+	bool getStats(const std::string& name, ScopeStats& stats) const {
+		std::map<std::string, History>::const_iterator found = histories.find(name);
+		if (found == histories.end() || found->second.count == 0)
+			return false;
+
+		const History& history = found->second;
+		std::vector<float> sorted(history.samples.begin(), history.samples.begin() + history.count);
+		std::sort(sorted.begin(), sorted.end());
+
+		double total = 0.0;
+		for (float sample : sorted)
+			total += sample;
+		stats.min = sorted.front();
+		stats.max = sorted.back();
+		stats.average = total / sorted.size();
+		stats.p99 = sorted[std::min(sorted.size() - 1, (size_t)(sorted.size() * 0.99))];
+		stats.samples = history.count;
+		return true;
+	}
+
+	unsigned int getDroppedFrames() const { return droppedFrames; }
+
+	void printReport() const {
+		std::cout << "GPU_PROFILER::REPORT (ms, last " << HISTORY << " frames, " << droppedFrames << " dropped)" << std::endl;
+		for (std::map<std::string, History>::const_iterator it = histories.begin(); it != histories.end(); ++it) {
+			ScopeStats stats;
+			if (getStats(it->first, stats))
+				std::cout << "    " << it->first << ": min " << stats.min << " avg " << stats.average << " max " << stats.max << " p99 " << stats.p99 << std::endl;
+		}
+	}
+
+	//the latest resolved frame as CPU and GPU bars side by side
+	void printTimeline() const {
+		std::cout << "GPU_PROFILER::TIMELINE (ms from frame start)" << std::endl;
+		for (const TimelineEntry& entry : timeline) {
+			std::cout << "    " << std::string(entry.depth * 2, ' ') << entry.name
+				<< " cpu " << entry.cpuBegin << " - " << entry.cpuEnd
+				<< " gpu " << entry.gpuBegin << " - " << entry.gpuEnd << std::endl;
+		}
+	}
+
+	void destroy() {
+		for (FrameSlot& slot : slots) {
+			for (const PendingScope& scope : slot.scopes) {
+				freeQueries.push_back(scope.beginQuery);
+				freeQueries.push_back(scope.endQuery);
+			}
+			slot.scopes.clear();
+		}
+		if (!freeQueries.empty())
+			glDeleteQueries((GLsizei)freeQueries.size(), freeQueries.data());
+		freeQueries.clear();
+	}
+
+private:
+
+	struct PendingScope {
+		const char* name;
+		unsigned int depth;
+		GLuint beginQuery, endQuery;
+		int64_t cpuBegin, cpuEnd; //nanoseconds
+	};
+
+	struct FrameSlot {
+		std::vector<PendingScope> scopes;
+		int64_t cpuStart = 0;
+		GLuint lastQuery = 0; //issued last, so it finishes last
+	};
+
+	struct History {
+		std::vector<float> samples;
+		unsigned int count = 0;
+		unsigned int next = 0;
+	};
+
+	uint64_t frame;
+	FrameSlot slots[LATENCY];
+	std::vector<unsigned int> openScopes; //indices into the current slot's scopes
+	std::vector<GLuint> freeQueries;
+	int64_t offsetNanoseconds;            //cpu time = gpu time + offset
+	unsigned int droppedFrames;
+
+	std::vector<TimelineEntry> timeline;
+	std::map<std::string, History> histories;
+
+	static int64_t cpuNanoseconds() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	FrameSlot& currentSlot() {
+		return slots[(frame + LATENCY - 1) % LATENCY];
+	}
+
+	GLuint acquireQuery() {
+		if (freeQueries.empty()) {
+			GLuint queries[16];
+			glGenQueries(16, queries);
+			freeQueries.insert(freeQueries.end(), queries, queries + 16);
+		}
+		GLuint query = freeQueries.back();
+		freeQueries.pop_back();
+		return query;
+	}
+
+	//the GPU clock has its own epoch; re-measured now and then as the two clocks drift apart
+	void calibrate() {
+		GLint64 gpu = 0;
+		glGetInteger64v(GL_TIMESTAMP, &gpu);
+		offsetNanoseconds = cpuNanoseconds() - (int64_t)gpu;
+	}
+
+	void resolve(const FrameSlot& slot) {
+
+		//queries complete in order, so the last one being ready means all of them are
+		GLint available = 0;
+		glGetQueryObjectiv(slot.lastQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) {
+			droppedFrames++;
+			return;
+		}
+
+		timeline.clear();
+		for (const PendingScope& scope : slot.scopes) {
+			GLuint64 gpuBegin = 0, gpuEnd = 0;
+			glGetQueryObjectui64v(scope.beginQuery, GL_QUERY_RESULT, &gpuBegin);
+			glGetQueryObjectui64v(scope.endQuery, GL_QUERY_RESULT, &gpuEnd);
+
+			TimelineEntry entry;
+			entry.name = scope.name;
+			entry.depth = scope.depth;
+			entry.cpuBegin = (scope.cpuBegin - slot.cpuStart) / 1.0e6;
+			entry.cpuEnd = (scope.cpuEnd - slot.cpuStart) / 1.0e6;
+			entry.gpuBegin = ((int64_t)gpuBegin + offsetNanoseconds - slot.cpuStart) / 1.0e6;
+			entry.gpuEnd = ((int64_t)gpuEnd + offsetNanoseconds - slot.cpuStart) / 1.0e6;
+			timeline.push_back(entry);
+
+			History& history = histories[scope.name];
+			if (history.samples.empty())
+				history.samples.resize(HISTORY);
+			history.samples[history.next] = (float)((gpuEnd - gpuBegin) / 1.0e6);
+			history.next = (history.next + 1) % HISTORY;
+			if (history.count < HISTORY)
+				history.count++;
+		}
+	}
+};
+
+
+//opens a scope for the lifetime of the object
+class GPUProfileScope {
+
+public:
+
+	GPUProfileScope(GPUProfiler& gpuProfiler, const char* name) : profiler(gpuProfiler) {
+		profiler.beginScope(name);
+	}
+
+	~GPUProfileScope() {
+		profiler.endScope();
+	}
+
+private:
+
+	GPUProfiler& profiler;
+};
+#endif
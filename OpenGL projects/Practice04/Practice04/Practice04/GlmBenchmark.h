@@ -0,0 +1,181 @@
+#pragma once
+
+#ifndef GLM_BENCHMARK_H
+#define GLM_BENCHMARK_H
+
+#include "GlmKernels.h"
+
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+//Times the per-frame glm calls under every glm SIMD configuration, and checks they agree.
+//
+//glm 0.9.8 only takes its SIMD paths for the aligned_* types, and the default glm::mat4 is one of
+//them only with GLM_FORCE_ALIGNED; GLM_FORCE_SSE2 or GLM_FORCE_AVX2 on their own still compile
+//the plain code for the types the render loops use. The matrix makes that visible: each of
+//pure, sse2 and avx2 is measured with and without GLM_FORCE_ALIGNED, as ns per call, both as a
+//chain of dependent calls (one camera, one transform) and over an array of independent ones
+//(thousands of objects). Every configuration's results are checked against the pure one first,
+//so a faster column is only trusted when it computes the same matrices.
+//
+//The AVX2 columns come from GlmKernelsAVX2.dll (see GlmKernels.h) and are skipped on CPUs without
+//AVX2 or when the DLL wasn't built.
+class GlmBenchmark {
+
+public:
+
+	static void run() {
+
+		//the DLL is only touched on a CPU that can run it
+		GlmKernelSet avx2Sets[2] = { missingSet("avx2"), missingSet("avx2+aligned") };
+		bool avx2 = cpuHasAVX2();
+		bool avx2Loaded = avx2 && loadGlmKernelsAVX2(avx2Sets[0], avx2Sets[1]);
+
+		GlmKernelSet sets[] = {
+			glmKernelsPure(), glmKernelsPureAligned(),
+			glmKernelsSSE2(), glmKernelsSSE2Aligned(),
+			avx2Sets[0], avx2Sets[1]
+		};
+		const int setCount = sizeof(sets) / sizeof(sets[0]);
+		const char* opNames[GLM_OP_COUNT] = { "rotate", "lookAt", "perspective", "normalize(cross)", "mat4 * mat4" };
+
+		bool usable[setCount];
+		for (int s = 0; s < setCount; s++)
+			usable[s] = avx2Loaded || !sets[s].needsAVX2;
+
+		//----same results first; sets[0] is the pure reference
+		std::vector<float> reference(GLM_KERNEL_BATCH * 16), values(GLM_KERNEL_BATCH * 16);
+		bool agree = true;
+		for (int op = 0; op < GLM_OP_COUNT; op++) {
+			for (int batched = 0; batched < 2; batched++) {
+				run(sets[0], op, batched != 0, reference.data());
+				for (int s = 1; s < setCount; s++) {
+					if (!usable[s])
+						continue;
+					run(sets[s], op, batched != 0, values.data());
+					float error = maxRelativeError(reference, values, batched ? GLM_KERNEL_BATCH * 16 : 16);
+					if (error > 1e-4f) {
+						std::cout << "ERROR::GLM_BENCHMARK::MISMATCH " << sets[s].name << " " << opNames[op]
+							<< (batched ? " batched" : " single") << " differs from pure by " << error << std::endl;
+						agree = false;
+					}
+				}
+			}
+		}
+
+		//----then ns per call, best of a few runs
+		std::cout << "GLM_BENCHMARK::BENCHMARK ns per call, best of " << RUNS << " runs"
+			<< (avx2Loaded ? "" : avx2 ? " (GlmKernelsAVX2.dll not loaded, avx2 columns skipped)" : " (no AVX2 on this CPU, avx2 columns skipped)") << std::endl;
+		char line[256];
+		int length = snprintf(line, sizeof(line), "    %-26s", "");
+		for (int s = 0; s < setCount; s++)
+			length += snprintf(line + length, sizeof(line) - length, "%14s", sets[s].name);
+		std::cout << line << std::endl;
+
+		for (int op = 0; op < GLM_OP_COUNT; op++) {
+			for (int batched = 0; batched < 2; batched++) {
+				length = snprintf(line, sizeof(line), "    %-17s %-8s", opNames[op], batched ? "batched" : "single");
+				for (int s = 0; s < setCount; s++) {
+					if (usable[s])
+						length += snprintf(line + length, sizeof(line) - length, "%14.2f", measure(sets[s], op, batched != 0));
+					else
+						length += snprintf(line + length, sizeof(line) - length, "%14s", "-");
+				}
+				std::cout << line << std::endl;
+			}
+		}
+		std::cout << "GLM_BENCHMARK::" << (agree ? "all configurations agree with pure" : "configurations DISAGREE, see above") << std::endl;
+	}
+
+private:
+
+	static const int RUNS = 5;
+	static const unsigned int CHECK_CHAIN = 64;   //dependent calls before comparing; longer chains drift apart by rounding
+	static const int MIN_RUN_MS = 20;
+
+	//a column that is never run
+	static GlmKernelSet missingSet(const char* name) {
+		GlmKernelSet set = { name, true, NULL, NULL, NULL, NULL, NULL };
+		return set;
+	}
+
+	static void run(const GlmKernelSet& set, int op, bool batched, float* values) {
+		set.prepare();
+		if (batched) {
+			set.runBatched(op, 1);
+			set.copyBatched(op, values);
+		}
+		else {
+			set.runSingle(op, CHECK_CHAIN);
+			set.copySingle(op, values);
+		}
+	}
+
+	//grows the call count until a run is long enough for the clock, then keeps the fastest run
+	static double measure(const GlmKernelSet& set, int op, bool batched) {
+		set.prepare();
+		unsigned int repeats = 1;
+		double best = 0.0;
+		for (;;) {
+			double ms = timeOnce(set, op, batched, repeats);
+			if (ms >= (double)MIN_RUN_MS || repeats >= (1u << 24)) {
+				best = ms;
+				break;
+			}
+			repeats *= 2;
+		}
+		for (int r = 1; r < RUNS; r++) {
+			double ms = timeOnce(set, op, batched, repeats);
+			if (ms < best)
+				best = ms;
+		}
+		return best * 1000000.0 / ((double)repeats * GLM_KERNEL_BATCH); //both forms make that many calls
+	}
+
+	static double timeOnce(const GlmKernelSet& set, int op, bool batched, unsigned int repeats) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		if (batched)
+			set.runBatched(op, repeats);
+		else
+			set.runSingle(op, repeats * (unsigned int)GLM_KERNEL_BATCH);
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	static float maxRelativeError(const std::vector<float>& expected, const std::vector<float>& actual, int count) {
+		float worst = 0.0f;
+		for (int i = 0; i < count; i++) {
+			float scale = std::fabs(expected[i]) > 1.0f ? std::fabs(expected[i]) : 1.0f;
+			float error = std::fabs(expected[i] - actual[i]) / scale;
+			if (!(error <= worst)) //NaN counts as the worst
+				worst = error;
+		}
+		return worst;
+	}
+
+	//AVX2 needs the CPU to have it and the OS to save the ymm registers
+	static bool cpuHasAVX2() {
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return false;
+		__cpuid(info, 1);
+		bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+		__cpuidex(info, 7, 0);
+		return osSavesYmm && (info[1] & (1 << 5)) != 0;
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+		return __builtin_cpu_supports("avx2") != 0;
+#else
+		return false;
+#endif
+	}
+};
+
+#endif
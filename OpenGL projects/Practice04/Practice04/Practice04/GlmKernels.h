@@ -0,0 +1,220 @@
+#pragma once
+
+#ifndef GLM_KERNELS_H
+#define GLM_KERNELS_H
+
+//The glm calls the render loops make every frame, built once per glm configuration.
+//
+//glm chooses its SIMD code with macros (GLM_FORCE_SSE2, GLM_FORCE_AVX2, GLM_FORCE_ALIGNED), so
+//comparing configurations means compiling the same code several times into one program. Each
+//GlmKernels_*.cpp sets the macros and includes this file with GLM_KERNELS_NAMESPACE defined, which
+//pulls glm itself into that namespace: every configuration gets its own glm types and functions.
+//
+//That is enough for the configurations the whole program is compiled for, not for AVX2. glm calls
+//std::sqrt, std::cos and friends, which are inline and outside any namespace of ours, and the linker
+//keeps one copy of each; an /arch:AVX2 copy could be the one the rest of the program calls. So the
+//AVX2 kernels (GlmKernels_AVX2*.cpp) are their own project, GlmKernelsAVX2.dll, built entirely with
+///arch:AVX2 and loaded at run time only on CPUs that have it.
+//
+//Included without GLM_KERNELS_NAMESPACE it only declares what GlmBenchmark needs.
+
+enum GlmOp {
+	GLM_OP_ROTATE,          //glm::rotate(model, angle, axis)
+	GLM_OP_LOOK_AT,         //glm::lookAt(eye, eye + front, up)
+	GLM_OP_PERSPECTIVE,     //glm::perspective(fov, aspect, near, far)
+	GLM_OP_NORMALIZE_CROSS, //glm::normalize(glm::cross(a, b))
+	GLM_OP_MULTIPLY,        //mat4 * mat4
+	GLM_OP_COUNT
+};
+
+const int GLM_KERNEL_BATCH = 1024; //independent inputs per batched run, a power of two
+
+struct GlmKernelSet {
+	const char* name;
+	bool needsAVX2;
+	void (*prepare)();                                //inputs, the same in every configuration
+	void (*runBatched)(int op, unsigned int repeats); //op over GLM_KERNEL_BATCH independent inputs, repeats times
+	void (*runSingle)(int op, unsigned int count);    //op count times, each call fed the result of the last
+	void (*copyBatched)(int op, float* values);       //16 floats per result, GLM_KERNEL_BATCH results
+	void (*copySingle)(int op, float* values);        //16 floats of the last single result
+};
+
+GlmKernelSet glmKernelsPure();
+GlmKernelSet glmKernelsPureAligned();
+GlmKernelSet glmKernelsSSE2();
+GlmKernelSet glmKernelsSSE2Aligned();
+
+//Loads GlmKernelsAVX2.dll from next to the executable and fills in its two sets; false, with the
+//sets untouched, when it isn't there. The DLL stays loaded until exit, the sets point into it.
+//Call it only after checking the CPU has AVX2: the DLL's own startup code may already use it.
+bool loadGlmKernelsAVX2(GlmKernelSet& plain, GlmKernelSet& aligned);
+
+typedef void (*GlmKernelsAVX2Entry)(GlmKernelSet* plain, GlmKernelSet* aligned);
+#define GLM_KERNELS_AVX2_ENTRY "glmKernelsAVX2Sets" //the DLL's only export
+
+#endif
+
+
+#ifdef GLM_KERNELS_NAMESPACE
+
+//everything glm includes from outside itself, so none of it lands in the namespace below
+#include <cmath>
+#include <climits>
+#include <cfloat>
+#include <limits>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <immintrin.h>
+#endif
+
+namespace GLM_KERNELS_NAMESPACE {
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+const int MASK = GLM_KERNEL_BATCH - 1;
+
+glm::mat4 models[GLM_KERNEL_BATCH];
+glm::mat4 rotations[GLM_KERNEL_BATCH];
+glm::vec3 eyes[GLM_KERNEL_BATCH];
+glm::vec3 fronts[GLM_KERNEL_BATCH];
+glm::vec3 others[GLM_KERNEL_BATCH];
+float angles[GLM_KERNEL_BATCH];
+float fovs[GLM_KERNEL_BATCH];
+
+glm::mat4 matrixResults[GLM_KERNEL_BATCH];
+glm::vec3 vectorResults[GLM_KERNEL_BATCH];
+glm::mat4 singleMatrix;
+glm::vec3 singleVector;
+
+const glm::vec3 up(0.0f, 1.0f, 0.0f);
+const glm::vec3 axis(0.3f, 1.0f, 0.2f);
+
+//same sequence in every configuration, no standard library involved
+unsigned int randomState;
+float random(float low, float high) {
+	randomState = randomState * 1664525u + 1013904223u;
+	return low + (high - low) * ((randomState >> 8) * (1.0f / 16777216.0f));
+}
+
+void prepare() {
+	randomState = 12345u;
+	for (int i = 0; i < GLM_KERNEL_BATCH; i++) {
+		glm::vec3 position(random(-50.0f, 50.0f), random(-10.0f, 10.0f), random(-50.0f, 50.0f));
+		models[i] = glm::rotate(glm::translate(glm::mat4(1.0f), position), random(0.0f, 6.28f), glm::vec3(0.0f, 1.0f, 0.0f));
+		rotations[i] = glm::rotate(glm::mat4(1.0f), random(0.0f, 6.28f), glm::vec3(random(0.1f, 1.0f), random(0.1f, 1.0f), random(0.1f, 1.0f)));
+		eyes[i] = glm::vec3(random(-20.0f, 20.0f), random(-5.0f, 5.0f), random(-20.0f, 20.0f));
+		fronts[i] = glm::normalize(glm::vec3(random(-1.0f, 1.0f), random(-0.5f, 0.5f), random(-1.0f, -0.1f)));
+		others[i] = glm::vec3(random(-1.0f, 1.0f), random(0.5f, 1.0f), random(-1.0f, 1.0f));
+		angles[i] = random(0.0f, 0.1f);
+		fovs[i] = random(0.6f, 1.2f);
+	}
+}
+
+//each repeat pairs inputs differently, so no repeat is a copy of the last one the compiler could drop
+void runBatched(int op, unsigned int repeats) {
+	for (unsigned int r = 0; r < repeats; r++) {
+		switch (op) {
+		case GLM_OP_ROTATE:
+			for (int i = 0; i < GLM_KERNEL_BATCH; i++)
+				matrixResults[i] = glm::rotate(models[i], angles[(i + r) & MASK], axis);
+			break;
+		case GLM_OP_LOOK_AT:
+			for (int i = 0; i < GLM_KERNEL_BATCH; i++)
+				matrixResults[i] = glm::lookAt(eyes[i], eyes[i] + fronts[(i + r) & MASK], up);
+			break;
+		case GLM_OP_PERSPECTIVE:
+			for (int i = 0; i < GLM_KERNEL_BATCH; i++)
+				matrixResults[i] = glm::perspective(fovs[(i + r) & MASK], 4.0f / 3.0f, 0.1f, 100.0f);
+			break;
+		case GLM_OP_NORMALIZE_CROSS:
+			for (int i = 0; i < GLM_KERNEL_BATCH; i++)
+				vectorResults[i] = glm::normalize(glm::cross(fronts[i], others[(i + r) & MASK]));
+			break;
+		case GLM_OP_MULTIPLY:
+			for (int i = 0; i < GLM_KERNEL_BATCH; i++)
+				matrixResults[i] = models[i] * rotations[(i + r) & MASK];
+			break;
+		}
+	}
+}
+
+//a chain of dependent calls: the latency of one call, as when the loop needs each result next
+void runSingle(int op, unsigned int count) {
+	switch (op) {
+	case GLM_OP_ROTATE:
+		singleMatrix = models[0];
+		for (unsigned int i = 0; i < count; i++)
+			singleMatrix = glm::rotate(singleMatrix, angles[0], axis);
+		break;
+	case GLM_OP_LOOK_AT:
+		singleMatrix = glm::mat4(1.0f);
+		for (unsigned int i = 0; i < count; i++) {
+			glm::vec3 eye = eyes[0] + glm::vec3(singleMatrix[3]) * 0.001f;
+			singleMatrix = glm::lookAt(eye, eye + fronts[0], up);
+		}
+		break;
+	case GLM_OP_PERSPECTIVE:
+		singleMatrix = glm::mat4(1.0f);
+		for (unsigned int i = 0; i < count; i++)
+			singleMatrix = glm::perspective(fovs[0] + singleMatrix[1][1] * 0.001f, 4.0f / 3.0f, 0.1f, 100.0f);
+		break;
+	case GLM_OP_NORMALIZE_CROSS:
+		singleVector = fronts[0];
+		for (unsigned int i = 0; i < count; i++)
+			singleVector = glm::normalize(glm::cross(singleVector, others[0]));
+		break;
+	case GLM_OP_MULTIPLY:
+		singleMatrix = models[0];
+		for (unsigned int i = 0; i < count; i++)
+			singleMatrix = singleMatrix * rotations[0];
+		break;
+	}
+}
+
+void copyMatrix(const glm::mat4& matrix, float* values) {
+	for (int column = 0; column < 4; column++) {
+		for (int row = 0; row < 4; row++)
+			values[column * 4 + row] = matrix[column][row];
+	}
+}
+
+void copyVector(const glm::vec3& vector, float* values) {
+	for (int i = 0; i < 16; i++)
+		values[i] = i < 3 ? vector[i] : 0.0f;
+}
+
+void copyBatched(int op, float* values) {
+	for (int i = 0; i < GLM_KERNEL_BATCH; i++) {
+		if (op == GLM_OP_NORMALIZE_CROSS)
+			copyVector(vectorResults[i], values + i * 16);
+		else
+			copyMatrix(matrixResults[i], values + i * 16);
+	}
+}
+
+void copySingle(int op, float* values) {
+	if (op == GLM_OP_NORMALIZE_CROSS)
+		copyVector(singleVector, values);
+	else
+		copyMatrix(singleMatrix, values);
+}
+
+}
+
+GlmKernelSet GLM_KERNELS_FACTORY() {
+	GlmKernelSet set = {
+		GLM_KERNELS_NAME, GLM_KERNELS_NEEDS_AVX2,
+		&GLM_KERNELS_NAMESPACE::prepare, &GLM_KERNELS_NAMESPACE::runBatched, &GLM_KERNELS_NAMESPACE::runSingle,
+		&GLM_KERNELS_NAMESPACE::copyBatched, &GLM_KERNELS_NAMESPACE::copySingle
+	};
+	return set;
+}
+
+#endif
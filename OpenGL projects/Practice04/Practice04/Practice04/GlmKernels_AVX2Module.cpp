@@ -0,0 +1,35 @@
+#include "GlmKernels.h"
+
+#include <iostream>
+
+//windows.h stays in this file; its macros (near, far, min, max) break glm and the app's headers
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+
+bool loadGlmKernelsAVX2(GlmKernelSet& plain, GlmKernelSet& aligned) {
+
+	static GlmKernelsAVX2Entry entry = NULL;
+	if (!entry) {
+#if defined(_WIN32)
+		HMODULE module = LoadLibraryA("GlmKernelsAVX2.dll");
+		if (module)
+			entry = (GlmKernelsAVX2Entry)GetProcAddress(module, GLM_KERNELS_AVX2_ENTRY);
+#else
+		void* module = dlopen("./libGlmKernelsAVX2.so", RTLD_NOW | RTLD_LOCAL);
+		if (module)
+			entry = (GlmKernelsAVX2Entry)dlsym(module, GLM_KERNELS_AVX2_ENTRY);
+#endif
+		if (!entry) {
+			std::cout << "ERROR::GLM_KERNELS::AVX2_MODULE_NOT_LOADED build the GlmKernelsAVX2 project next to the executable" << std::endl;
+			return false;
+		}
+	}
+	entry(&plain, &aligned);
+	return true;
+}
@@ -0,0 +1,6 @@
+#define GLM_FORCE_PURE
+#define GLM_KERNELS_NAMESPACE glmPure
+#define GLM_KERNELS_NAME "pure"
+#define GLM_KERNELS_FACTORY glmKernelsPure
+#define GLM_KERNELS_NEEDS_AVX2 false
+#include "GlmKernels.h"
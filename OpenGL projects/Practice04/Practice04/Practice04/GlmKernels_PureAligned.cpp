@@ -0,0 +1,7 @@
+#define GLM_FORCE_PURE
+#define GLM_FORCE_ALIGNED
+#define GLM_KERNELS_NAMESPACE glmPureAligned
+#define GLM_KERNELS_NAME "pure+aligned"
+#define GLM_KERNELS_FACTORY glmKernelsPureAligned
+#define GLM_KERNELS_NEEDS_AVX2 false
+#include "GlmKernels.h"
@@ -0,0 +1,6 @@
+#define GLM_FORCE_SSE2
+#define GLM_KERNELS_NAMESPACE glmSSE2
+#define GLM_KERNELS_NAME "sse2"
+#define GLM_KERNELS_FACTORY glmKernelsSSE2
+#define GLM_KERNELS_NEEDS_AVX2 false
+#include "GlmKernels.h"
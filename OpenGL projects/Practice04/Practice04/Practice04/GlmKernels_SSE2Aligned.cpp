@@ -0,0 +1,7 @@
+#define GLM_FORCE_SSE2
+#define GLM_FORCE_ALIGNED
+#define GLM_KERNELS_NAMESPACE glmSSE2Aligned
+#define GLM_KERNELS_NAME "sse2+aligned"
+#define GLM_KERNELS_FACTORY glmKernelsSSE2Aligned
+#define GLM_KERNELS_NEEDS_AVX2 false
+#include "GlmKernels.h"
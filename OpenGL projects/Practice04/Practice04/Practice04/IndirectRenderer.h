@@ -0,0 +1,230 @@
+#pragma once
+
+#ifndef INDIRECT_RENDERER_H
+#define INDIRECT_RENDERER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "GLExtensions.h"
+#include "GLStateCache.h"
+#include "ComputeShader.h"
+#include "StaticBatch.h"
+#include "BufferArena.h"
+#include "Frustum.h"
+
+#include <vector>
+#include <algorithm>
+
+
+//GPU driven path for GL 4.3+. Every object's transform, bounds and index range live in a shader
+//storage buffer. Each frame a compute shader culls all objects against the frustum and writes
+//one DrawElementsIndirectCommand per object (zero instances when culled), and the whole batch is
+//drawn with a single glMultiDrawElementsIndirect. Each command's baseInstance is its object index,
+//read back in the vertex shader through an instanced attribute, so the CPU cost of a frame does
+//not depend on the number of objects.
+//
+//The vertex shader must declare the same ObjectData block at binding 0 and the object index at
+//OBJECT_LOCATION; see _indirectVertexShader.vs.
+//
+//Objects, commands and object indices are sub-allocated from a caller's BufferArena whose
+//granularity is instanceGranularity(), so storage ranges can be bound at any allocation.
+class IndirectRenderer {
+
+public:
+
+	static const unsigned int OBJECT_LOCATION = 7;
+	static const unsigned int GROUP_SIZE = 64; //local_size_x in _cullObjects.cs
+
+	static bool isSupported() {
+		return glExtensions().gpuDriven;
+	}
+
+	//granularity for the instance arena: storage ranges must start on the driver's alignment
+	static unsigned int instanceGranularity() {
+		GLint alignment = 0;
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		return (unsigned int)std::max(alignment, 16);
+	}
+
+	//the batch must be built; its arena buffers are shared, not copied, and so are its ranges
+	//(pass batch.getRange(mesh) to addObject). Like StaticBatch::build() this binds GL objects
+	//directly, so create it before the state cache starts tracking.
+	IndirectRenderer(const StaticBatch& batch, BufferArena& instanceArena, const char* cullShaderPath = "_cullObjects.cs")
+		: cull(cullShaderPath), instances(instanceArena),
+		  objectHandle(BufferArena::INVALID_HANDLE), commandHandle(BufferArena::INVALID_HANDLE), objectIdHandle(BufferArena::INVALID_HANDLE),
+		  VAO(0), capacity(0), dirtyBegin(0), dirtyEnd(0) {
+
+		//same vertex layout as the batch plus the per instance object index
+		glGenVertexArrays(1, &VAO);
+		glBindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, batch.getVBO());
+		GLsizei stride = batch.format.floatsPerVertex * sizeof(float);
+		for (const VertexAttribute& attribute : batch.format.attributes) {
+			glVertexAttribPointer(attribute.location, attribute.components, GL_FLOAT, GL_FALSE, stride, (void*)(batch.getVertexByteOffset() + attribute.offset * sizeof(float)));
+			glEnableVertexAttribArray(attribute.location);
+		}
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, batch.getEBO());
+		glBindVertexArray(0);
+	}
+
+	unsigned int addObject(const StaticBatch::Range& range, const glm::mat4& model, const glm::vec3& sphereCenter, float sphereRadius) {
+		ObjectData object;
+		object.model = model;
+		object.sphere = glm::vec4(sphereCenter, sphereRadius);
+		object.draw = glm::uvec4(range.firstIndex, range.count, (unsigned int)range.baseVertex, 0u);
+		objects.push_back(object);
+		markDirty((unsigned int)objects.size() - 1);
+		return (unsigned int)objects.size() - 1;
+	}
+
+	void setTransform(unsigned int object, const glm::mat4& model) {
+		objects[object].model = model;
+		markDirty(object);
+	}
+
+	unsigned int getObjectCount() const { return (unsigned int)objects.size(); }
+
+	//Cull and draw everything. program is the caller's draw program with its uniforms already set;
+	//it is made current through the state cache.
+	void draw(GLStateCache& state, const glm::mat4& viewProjection, unsigned int program) {
+
+		unsigned int count = (unsigned int)objects.size();
+		if (count == 0 || !upload(state))
+			return;
+
+		unsigned int buffer = instances.getBuffer();
+		Frustum frustum = Frustum::fromMatrix(viewProjection);
+		state.useProgram(cull.ID);
+		cull.setVec4Array("planes", &frustum.planes[0].x, 6);
+		cull.setUInt("objectCount", count);
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, buffer, instances.offsetOf(objectHandle), count * sizeof(ObjectData));
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 1, buffer, instances.offsetOf(commandHandle), count * sizeof(DrawElementsIndirectCommand));
+		cull.dispatch(count, GROUP_SIZE);
+
+		//the commands were written as storage, they are read as draw arguments
+		glExtensions().Barrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+		state.useProgram(program);
+		state.bindVertexArray(VAO);
+		state.bindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer);
+		glExtensions().MultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)instances.offsetOf(commandHandle), (GLsizei)count, 0);
+	}
+
+	//Objects that survived the last draw()'s culling, summed from the commands the compute shader
+	//wrote. Waits for the GPU to finish that draw, so call it once the frame is done (after a
+	//glFinish or a fence), not in the middle of one.
+	unsigned int readDrawnCount() {
+
+		unsigned int count = (unsigned int)objects.size();
+		if (count == 0 || commandHandle == BufferArena::INVALID_HANDLE)
+			return 0;
+		readback.resize(count);
+		glBindBuffer(GL_COPY_READ_BUFFER, instances.getBuffer());
+		glGetBufferSubData(GL_COPY_READ_BUFFER, instances.offsetOf(commandHandle), count * sizeof(DrawElementsIndirectCommand), readback.data());
+
+		unsigned int drawn = 0;
+		for (const DrawElementsIndirectCommand& command : readback)
+			drawn += command.instanceCount;
+		return drawn;
+	}
+
+	//gives the instance space back to the arena, which belongs to the caller
+	void destroy() {
+		freeInstances();
+		glDeleteVertexArrays(1, &VAO);
+		glDeleteProgram(cull.ID);
+		VAO = 0;
+		capacity = 0;
+	}
+
+private:
+
+	//std430 layout shared with the shaders, 96 bytes
+	struct ObjectData {
+		glm::mat4 model;
+		glm::vec4 sphere;
+		glm::uvec4 draw;
+	};
+
+	//what glMultiDrawElementsIndirect reads, written by the compute shader
+	struct DrawElementsIndirectCommand {
+		unsigned int count;
+		unsigned int instanceCount;
+		unsigned int firstIndex;
+		int baseVertex;
+		unsigned int baseInstance;
+	};
+
+	ComputeShader cull;
+	BufferArena& instances;
+	unsigned int objectHandle;
+	unsigned int commandHandle;
+	unsigned int objectIdHandle;
+	unsigned int VAO;
+	unsigned int capacity; //objects the GPU buffers can hold
+	std::vector<ObjectData> objects;
+	std::vector<DrawElementsIndirectCommand> readback; //kept for readDrawnCount()
+	unsigned int dirtyBegin, dirtyEnd;
+
+	void markDirty(unsigned int object) {
+		if (dirtyBegin == dirtyEnd) {
+			dirtyBegin = object;
+			dirtyEnd = object + 1;
+			return;
+		}
+		dirtyBegin = std::min(dirtyBegin, object);
+		dirtyEnd = std::max(dirtyEnd, object + 1);
+	}
+
+	void freeInstances() {
+		instances.free(objectHandle);
+		instances.free(commandHandle);
+		instances.free(objectIdHandle);
+		objectHandle = commandHandle = objectIdHandle = BufferArena::INVALID_HANDLE;
+	}
+
+	//push the changed span of objects, reallocating everything when the allocations are too small.
+	//false when the arena has no room for them.
+	bool upload(GLStateCache& state) {
+
+		unsigned int count = (unsigned int)objects.size();
+		if (count > capacity) {
+			unsigned int grown = std::max(count, capacity * 2);
+
+			//the old contents are rewritten in full, so the old space can go first
+			freeInstances();
+			objectHandle = instances.allocate(grown * sizeof(ObjectData));
+			commandHandle = instances.allocate(grown * sizeof(DrawElementsIndirectCommand));
+			objectIdHandle = instances.allocate(grown * sizeof(unsigned int));
+			if (objectHandle == BufferArena::INVALID_HANDLE || commandHandle == BufferArena::INVALID_HANDLE || objectIdHandle == BufferArena::INVALID_HANDLE) {
+				freeInstances();
+				capacity = 0;
+				return false;
+			}
+			capacity = grown;
+
+			instances.upload(objectHandle, objects.data(), count * sizeof(ObjectData));
+
+			//ids[n] == n, so the single instance of command n fetches its baseInstance, the object index
+			std::vector<unsigned int> ids(capacity);
+			for (unsigned int i = 0; i < capacity; i++)
+				ids[i] = i;
+			instances.upload(objectIdHandle, ids.data(), capacity * sizeof(unsigned int));
+			state.bindVertexArray(VAO);
+			state.bindBuffer(GL_ARRAY_BUFFER, instances.getBuffer());
+			glVertexAttribIPointer(OBJECT_LOCATION, 1, GL_UNSIGNED_INT, sizeof(unsigned int), (void*)instances.offsetOf(objectIdHandle));
+			glVertexAttribDivisor(OBJECT_LOCATION, 1);
+			glEnableVertexAttribArray(OBJECT_LOCATION);
+
+			dirtyBegin = dirtyEnd = 0;
+			return true;
+		}
+
+		if (dirtyBegin != dirtyEnd) {
+			instances.upload(objectHandle, &objects[dirtyBegin], (dirtyEnd - dirtyBegin) * sizeof(ObjectData), dirtyBegin * sizeof(ObjectData));
+			dirtyBegin = dirtyEnd = 0;
+		}
+		return true;
+	}
+};
+#endif
@@ -0,0 +1,391 @@
+#pragma once
+
+#ifndef MEMORY_TRACKER_H
+#define MEMORY_TRACKER_H
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <mutex>
+#include <map>
+#include <new>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdint>
+#include <iostream>
+
+
+//what an allocation was made for; set per thread with MemoryTagScope
+enum MemoryTag {
+	MEMORY_TAG_GENERAL,
+	MEMORY_TAG_IMAGE,   //stb_image pixel data
+	MEMORY_TAG_SHADER,  //shader sources and build
+	MEMORY_TAG_TOOLS,   //the profiling and tracking code itself, never reported as a leak
+	MEMORY_TAG_COUNT
+};
+
+enum GPUMemoryCategory {
+	GPU_MEMORY_BUFFER,
+	GPU_MEMORY_TEXTURE,
+	GPU_MEMORY_RENDERBUFFER,
+	GPU_MEMORY_CATEGORY_COUNT
+};
+
+struct MemoryStats {
+	uint64_t liveBytes;
+	uint64_t liveCount;
+	uint64_t peakBytes;  //high-water mark of liveBytes
+	uint64_t totalCount; //allocations ever made
+};
+
+inline const char* memoryTagName(int tag) {
+	static const char* names[MEMORY_TAG_COUNT] = { "general", "image", "shader", "tools" };
+	return names[tag];
+}
+
+inline const char* gpuMemoryCategoryName(int category) {
+	static const char* names[GPU_MEMORY_CATEGORY_COUNT] = { "buffer", "texture", "renderbuffer" };
+	return names[category];
+}
+
+inline MemoryTag& currentMemoryTag() {
+	static thread_local MemoryTag tag = MEMORY_TAG_GENERAL;
+	return tag;
+}
+
+//tags everything allocated on this thread until it goes out of scope
+class MemoryTagScope {
+
+public:
+
+	MemoryTagScope(MemoryTag tag) : previous(currentMemoryTag()) {
+		currentMemoryTag() = tag;
+	}
+
+	~MemoryTagScope() {
+		currentMemoryTag() = previous;
+	}
+
+private:
+
+	MemoryTag previous;
+};
+
+
+//Heap accounting behind operator new/delete and STBI_MALLOC.
+//
+//Every block gets a 16 byte header holding its size and tag in front of what the caller sees, so
+//a free knows what to take off which tag without a lookup. Counters are atomics and nothing here
+//allocates, so operator new can use it from the first static constructor on. The class is plain
+//data on purpose: its static instance is zero-initialized before any code runs.
+class CPUMemoryTracker {
+
+public:
+
+	void* allocate(size_t size, MemoryTag tag) {
+		Header* header = (Header*)malloc(sizeof(Header) + size);
+		if (header == NULL)
+			return NULL;
+		header->size = size;
+		header->tag = tag;
+		header->magic = MAGIC;
+		add(tag, size);
+		return header + 1;
+	}
+
+	void* reallocate(void* block, size_t size, MemoryTag tag) {
+		if (block == NULL)
+			return allocate(size, tag);
+
+		Header* header = (Header*)block - 1;
+		size_t oldSize = (size_t)header->size;
+		MemoryTag oldTag = (MemoryTag)header->tag;
+		Header* moved = (Header*)realloc(header, sizeof(Header) + size);
+		if (moved == NULL)
+			return NULL;
+		remove(oldTag, oldSize);
+		moved->size = size;
+		add(oldTag, size);
+		return moved + 1;
+	}
+
+	void release(void* block) {
+		if (block == NULL)
+			return;
+		Header* header = (Header*)block - 1;
+		if (header->magic != MAGIC) {
+			std::cout << "ERROR::MEMORY_TRACKER::FOREIGN_BLOCK_RELEASED" << std::endl;
+			return;
+		}
+		header->magic = 0;
+		remove((MemoryTag)header->tag, (size_t)header->size);
+		free(header);
+	}
+
+	MemoryStats getStats(int tag) const {
+		MemoryStats stats;
+		stats.liveBytes = liveBytes[tag].load(std::memory_order_relaxed);
+		stats.liveCount = liveCount[tag].load(std::memory_order_relaxed);
+		stats.peakBytes = peakBytes[tag].load(std::memory_order_relaxed);
+		stats.totalCount = totalCount[tag].load(std::memory_order_relaxed);
+		return stats;
+	}
+
+	//what is live now stops counting as a leak
+	void markBaseline() {
+		for (int tag = 0; tag < MEMORY_TAG_COUNT; tag++) {
+			baselineBytes[tag] = liveBytes[tag].load(std::memory_order_relaxed);
+			baselineCount[tag] = liveCount[tag].load(std::memory_order_relaxed);
+		}
+	}
+
+	uint64_t getBaselineBytes(int tag) const { return baselineBytes[tag]; }
+	uint64_t getBaselineCount(int tag) const { return baselineCount[tag]; }
+
+private:
+
+	static const uint32_t MAGIC = 0x4d454d54; //"MEMT"
+
+	struct Header {
+		uint64_t size;
+		uint32_t tag;
+		uint32_t magic;
+	};
+
+	std::atomic<uint64_t> liveBytes[MEMORY_TAG_COUNT];
+	std::atomic<uint64_t> liveCount[MEMORY_TAG_COUNT];
+	std::atomic<uint64_t> peakBytes[MEMORY_TAG_COUNT];
+	std::atomic<uint64_t> totalCount[MEMORY_TAG_COUNT];
+	uint64_t baselineBytes[MEMORY_TAG_COUNT];
+	uint64_t baselineCount[MEMORY_TAG_COUNT];
+
+	void add(MemoryTag tag, size_t size) {
+		uint64_t live = liveBytes[tag].fetch_add(size, std::memory_order_relaxed) + size;
+		liveCount[tag].fetch_add(1, std::memory_order_relaxed);
+		totalCount[tag].fetch_add(1, std::memory_order_relaxed);
+		uint64_t peak = peakBytes[tag].load(std::memory_order_relaxed);
+		while (live > peak && !peakBytes[tag].compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+	}
+
+	void remove(MemoryTag tag, size_t size) {
+		liveBytes[tag].fetch_sub(size, std::memory_order_relaxed);
+		liveCount[tag].fetch_sub(1, std::memory_order_relaxed);
+	}
+};
+
+inline CPUMemoryTracker& cpuMemory() {
+	static CPUMemoryTracker tracker; //zero-initialized, no constructor runs
+	return tracker;
+}
+
+//for STBI_MALLOC and friends
+inline void* trackedMalloc(size_t size, MemoryTag tag) { return cpuMemory().allocate(size, tag); }
+inline void* trackedRealloc(void* block, size_t size, MemoryTag tag) { return cpuMemory().reallocate(block, size, tag); }
+inline void trackedFree(void* block) { cpuMemory().release(block); }
+
+
+//GL object sizes by name, fed by GLMemoryHooks. Sizes are what was asked for at creation;
+//drivers may pad or compress, so treat them as a floor rather than the truth.
+class GPUMemoryTracker {
+
+public:
+
+	GPUMemoryTracker() {
+		for (int category = 0; category < GPU_MEMORY_CATEGORY_COUNT; category++)
+			stats[category] = MemoryStats();
+	}
+
+	//(re)specify the storage of an object
+	void setSize(GPUMemoryCategory category, GLuint name, uint64_t bytes) {
+		if (name == 0)
+			return;
+		std::lock_guard<std::mutex> lock(mutex);
+		std::map<GLuint, uint64_t>::iterator found = objects[category].find(name);
+		if (found != objects[category].end()) {
+			stats[category].liveBytes -= found->second;
+			found->second = bytes;
+		}
+		else {
+			objects[category][name] = bytes;
+			stats[category].liveCount++;
+			stats[category].totalCount++;
+		}
+		stats[category].liveBytes += bytes;
+		stats[category].peakBytes = std::max(stats[category].peakBytes, stats[category].liveBytes);
+	}
+
+	//one mip level of a texture; the texture's size is the sum of its levels
+	void setTextureLevel(GLuint texture, GLint level, uint64_t bytes) {
+		if (texture == 0 || level < 0 || level >= MAX_LEVELS)
+			return;
+		uint64_t total;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			TextureLevels& levels = textureLevels[texture];
+			levels.bytes[level] = bytes;
+			total = levels.total();
+		}
+		setSize(GPU_MEMORY_TEXTURE, texture, total);
+	}
+
+	//glGenerateMipmap: every level below the base a quarter of the one above
+	void generateMipmaps(GLuint texture) {
+		if (texture == 0)
+			return;
+		uint64_t total;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			TextureLevels& levels = textureLevels[texture];
+			for (int level = 1; level < MAX_LEVELS; level++)
+				levels.bytes[level] = levels.bytes[level - 1] / 4;
+			total = levels.total();
+		}
+		setSize(GPU_MEMORY_TEXTURE, texture, total);
+	}
+
+	void release(GPUMemoryCategory category, GLuint name) {
+		std::lock_guard<std::mutex> lock(mutex);
+		std::map<GLuint, uint64_t>::iterator found = objects[category].find(name);
+		if (found == objects[category].end())
+			return;
+		stats[category].liveBytes -= found->second;
+		stats[category].liveCount--;
+		objects[category].erase(found);
+		if (category == GPU_MEMORY_TEXTURE)
+			textureLevels.erase(name);
+	}
+
+	MemoryStats getStats(int category) {
+		std::lock_guard<std::mutex> lock(mutex);
+		return stats[category];
+	}
+
+	//objects alive now stop counting as leaks
+	void markBaseline() {
+		std::lock_guard<std::mutex> lock(mutex);
+		for (int category = 0; category < GPU_MEMORY_CATEGORY_COUNT; category++)
+			baseline[category] = objects[category];
+	}
+
+	//objects created after the baseline and never deleted, printed one by one
+	unsigned int printLeaks() {
+		std::lock_guard<std::mutex> lock(mutex);
+		unsigned int leaks = 0;
+		for (int category = 0; category < GPU_MEMORY_CATEGORY_COUNT; category++) {
+			for (std::map<GLuint, uint64_t>::const_iterator it = objects[category].begin(); it != objects[category].end(); ++it) {
+				if (baseline[category].count(it->first))
+					continue;
+				std::cout << "    gpu " << gpuMemoryCategoryName(category) << " " << it->first << ": " << it->second << " bytes" << std::endl;
+				leaks++;
+			}
+		}
+		return leaks;
+	}
+
+private:
+
+	static const int MAX_LEVELS = 16;
+
+	struct TextureLevels {
+		uint64_t bytes[MAX_LEVELS] = {};
+
+		uint64_t total() const {
+			uint64_t sum = 0;
+			for (int level = 0; level < MAX_LEVELS; level++)
+				sum += bytes[level];
+			return sum;
+		}
+	};
+
+	std::mutex mutex;
+	std::map<GLuint, uint64_t> objects[GPU_MEMORY_CATEGORY_COUNT];
+	std::map<GLuint, uint64_t> baseline[GPU_MEMORY_CATEGORY_COUNT];
+	std::map<GLuint, TextureLevels> textureLevels;
+	MemoryStats stats[GPU_MEMORY_CATEGORY_COUNT];
+};
+
+inline GPUMemoryTracker& gpuMemory() {
+	static GPUMemoryTracker tracker;
+	return tracker;
+}
+
+
+//start measuring leaks from here; whatever the C++ runtime set up before main() is not ours
+inline void markMemoryBaseline() {
+	cpuMemory().markBaseline();
+	gpuMemory().markBaseline();
+}
+
+//live totals and high-water marks per heap tag and GL object kind
+inline void printMemoryReport() {
+	std::cout << "MEMORY_TRACKER::REPORT (bytes)" << std::endl;
+	for (int tag = 0; tag < MEMORY_TAG_COUNT; tag++) {
+		MemoryStats stats = cpuMemory().getStats(tag);
+		std::cout << "    heap " << memoryTagName(tag) << ": live " << stats.liveBytes << " in " << stats.liveCount
+			<< ", peak " << stats.peakBytes << ", " << stats.totalCount << " allocations" << std::endl;
+	}
+	for (int category = 0; category < GPU_MEMORY_CATEGORY_COUNT; category++) {
+		MemoryStats stats = gpuMemory().getStats(category);
+		std::cout << "    gpu " << gpuMemoryCategoryName(category) << ": live " << stats.liveBytes << " in " << stats.liveCount
+			<< ", peak " << stats.peakBytes << std::endl;
+	}
+}
+
+//what was allocated since markMemoryBaseline() and is still alive; false when nothing leaked
+inline bool printMemoryLeaks() {
+	std::cout << "MEMORY_TRACKER::LEAKS" << std::endl;
+	bool leaked = false;
+	for (int tag = 0; tag < MEMORY_TAG_COUNT; tag++) {
+		if (tag == MEMORY_TAG_TOOLS)
+			continue;
+		MemoryStats stats = cpuMemory().getStats(tag);
+		int64_t bytes = (int64_t)stats.liveBytes - (int64_t)cpuMemory().getBaselineBytes(tag);
+		int64_t count = (int64_t)stats.liveCount - (int64_t)cpuMemory().getBaselineCount(tag);
+		if (count > 0 || bytes > 0) {
+			std::cout << "    heap " << memoryTagName(tag) << ": " << bytes << " bytes in " << count << " blocks" << std::endl;
+			leaked = true;
+		}
+	}
+	if (gpuMemory().printLeaks() > 0)
+		leaked = true;
+	if (!leaked)
+		std::cout << "    none" << std::endl;
+	return leaked;
+}
+
+
+//Compiled into exactly one translation unit (MemoryTracker_Implementation.cpp), like stb_image.
+//Replaces the global allocation functions so every new and delete goes through the tracker.
+#ifdef MEMORY_TRACKER_IMPLEMENTATION
+
+void* operator new(std::size_t size) {
+	void* block = cpuMemory().allocate(size, currentMemoryTag());
+	if (block == NULL)
+		throw std::bad_alloc();
+	return block;
+}
+
+void* operator new[](std::size_t size) {
+	void* block = cpuMemory().allocate(size, currentMemoryTag());
+	if (block == NULL)
+		throw std::bad_alloc();
+	return block;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+	return cpuMemory().allocate(size, currentMemoryTag());
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+	return cpuMemory().allocate(size, currentMemoryTag());
+}
+
+void operator delete(void* block) noexcept { cpuMemory().release(block); }
+void operator delete[](void* block) noexcept { cpuMemory().release(block); }
+void operator delete(void* block, std::size_t) noexcept { cpuMemory().release(block); }
+void operator delete[](void* block, std::size_t) noexcept { cpuMemory().release(block); }
+void operator delete(void* block, const std::nothrow_t&) noexcept { cpuMemory().release(block); }
+void operator delete[](void* block, const std::nothrow_t&) noexcept { cpuMemory().release(block); }
+
+#endif
+#endif
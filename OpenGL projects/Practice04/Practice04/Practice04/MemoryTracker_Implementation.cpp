@@ -0,0 +1,2 @@
+#define MEMORY_TRACKER_IMPLEMENTATION
+#include "MemoryTracker.h"
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+
+#ifndef MESH_GENERATOR_H
+#define MESH_GENERATOR_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cmath>
+
+
+//Latitude/longitude sphere in the cube's vertex layout (position, then texture coordinate;
+//5 floats a vertex) for code that needs a mesh with more than a handful of triangles.
+//The first and last column are the same positions with different u, and every vertex of a pole
+//row sits on the pole, so both carry the seams a loaded model would have. Pole rows get one
+//triangle per segment instead of a degenerate quad.
+inline void generateSphere(unsigned int rings, unsigned int segments, float radius, std::vector<float>& vertices, std::vector<unsigned int>& indices) {
+
+	const float pi = 3.14159265358979f;
+	vertices.clear();
+	indices.clear();
+	vertices.reserve((size_t)(rings + 1) * (segments + 1) * 5);
+	indices.reserve((size_t)rings * segments * 6);
+
+	for (unsigned int ring = 0; ring <= rings; ring++) {
+		float v = (float)ring / rings;
+		float polar = v * pi;
+		for (unsigned int segment = 0; segment <= segments; segment++) {
+			float u = (float)segment / segments;
+			float azimuth = u * 2.0f * pi;
+			//the seam column reuses the first column's position exactly, so it welds
+			if (segment == segments)
+				azimuth = 0.0f;
+			vertices.push_back(radius * std::sin(polar) * std::cos(azimuth));
+			vertices.push_back(radius * std::cos(polar));
+			vertices.push_back(radius * std::sin(polar) * std::sin(azimuth));
+			vertices.push_back(u);
+			vertices.push_back(1.0f - v);
+		}
+	}
+
+	//the poles' positions are exact too
+	for (unsigned int segment = 0; segment <= segments; segment++) {
+		float* top = &vertices[(size_t)segment * 5];
+		float* bottom = &vertices[((size_t)rings * (segments + 1) + segment) * 5];
+		top[0] = top[2] = bottom[0] = bottom[2] = 0.0f;
+		top[1] = radius;
+		bottom[1] = -radius;
+	}
+
+	//counter-clockwise seen from outside
+	for (unsigned int ring = 0; ring < rings; ring++) {
+		for (unsigned int segment = 0; segment < segments; segment++) {
+			unsigned int a = ring * (segments + 1) + segment;
+			unsigned int b = a + segments + 1;
+			if (ring != 0) {
+				indices.push_back(a);
+				indices.push_back(a + 1);
+				indices.push_back(b);
+			}
+			if (ring != rings - 1) {
+				indices.push_back(a + 1);
+				indices.push_back(b + 1);
+				indices.push_back(b);
+			}
+		}
+	}
+}
+#endif
@@ -0,0 +1,382 @@
+#pragma once
+
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <glm/glm.hpp>
+#include "StaticBatch.h" //VertexFormat
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cfloat>
+
+
+//one level of detail. Every level indexes the same vertices as the source mesh, so a whole
+//chain shares a single vertex range in a StaticBatch (see StaticBatch::addIndexRange).
+struct MeshLod {
+	std::vector<unsigned int> indices;
+	float error; //largest deviation from the source surface, in object space units
+};
+
+struct LodChain {
+	std::vector<MeshLod> levels; //level 0 is the source mesh
+};
+
+//which level to draw, and how far the fade towards the next coarser level has progressed
+struct LodSelection {
+	unsigned int level;
+	unsigned int fadeLevel;
+	float fade; //0 draws only level, 1 draws only fadeLevel
+};
+
+
+//Quadric error metric edge-collapse simplifier (Garland & Heckbert). Vertices are collapsed
+//onto one of their neighbours, so no new vertices are created and attributes stay exact.
+//Vertices on UV/normal seams (same position, different attributes) and on open borders are
+//locked, keeping texture charts and silhouettes of open meshes intact.
+class MeshSimplifier {
+
+public:
+
+	MeshSimplifier(const float* vertexData, unsigned int count, const VertexFormat& vertexFormat)
+		: vertices(vertexData), vertexCount(count), format(vertexFormat) {
+
+		positions.resize(vertexCount);
+		for (unsigned int i = 0; i < vertexCount; i++) {
+			const float* p = vertex(i) + format.positionOffset;
+			positions[i] = glm::vec3(p[0], p[1], p[2]);
+		}
+		weldPositions();
+	}
+
+	//Collapse edges until the index count drops to targetIndexCount or the next collapse
+	//would exceed targetError. The achieved error is written to resultError.
+	std::vector<unsigned int> simplify(const std::vector<unsigned int>& sourceIndices, unsigned int targetIndexCount, float targetError, float* resultError = NULL) {
+
+		std::vector<unsigned int> indices = sourceIndices;
+		std::vector<Quadric> quadrics(vertexCount);
+		std::vector<char> locked(vertexCount, 0);
+
+		//plane quadrics accumulated on the welded vertices
+		for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+			unsigned int a = canonical[indices[t]], b = canonical[indices[t + 1]], c = canonical[indices[t + 2]];
+			Quadric q = Quadric::fromTriangle(positions[a], positions[b], positions[c]);
+			quadrics[a] += q;
+			quadrics[b] += q;
+			quadrics[c] += q;
+		}
+
+		lockSeamsAndBorders(indices, locked);
+
+		double maxCost = 0.0;
+		double costLimit = (double)targetError * targetError;
+
+		std::vector<unsigned int> remap(vertexCount);
+		std::vector<char> touched(vertexCount);
+		std::vector<Collapse> collapses;
+		std::vector<unsigned int> triangleOffsets, triangleList;
+
+		for (int pass = 0; pass < 100 && indices.size() > targetIndexCount; pass++) {
+
+			buildAdjacency(indices, triangleOffsets, triangleList);
+
+			//every directed edge is a candidate: move the source onto the target's position
+			collapses.clear();
+			for (size_t t = 0; t < indices.size(); t += 3) {
+				for (int e = 0; e < 3; e++) {
+					unsigned int from = canonical[indices[t + e]];
+					unsigned int toVertex = indices[t + (e + 1) % 3];
+					unsigned int to = canonical[toVertex];
+					if (from == to || locked[from])
+						continue;
+					Quadric q = quadrics[from];
+					q += quadrics[to];
+					Collapse collapse = { from, to, toVertex, q.evaluate(positions[to]) };
+					collapses.push_back(collapse);
+				}
+			}
+			if (collapses.empty())
+				break;
+
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+			for (unsigned int i = 0; i < vertexCount; i++)
+				remap[i] = i;
+			std::fill(touched.begin(), touched.end(), 0);
+
+			//each collapse removes about two triangles
+			size_t trianglesToRemove = (indices.size() - targetIndexCount) / 3;
+			size_t removed = 0;
+			unsigned int applied = 0;
+
+			for (const Collapse& collapse : collapses) {
+
+				if (collapse.cost > costLimit || removed >= trianglesToRemove)
+					break;
+				if (touched[collapse.from] || touched[collapse.to])
+					continue;
+				if (flipsTriangles(indices, triangleOffsets, triangleList, collapse.from, collapse.to))
+					continue;
+
+				//freeze the one-ring so the flip test above stays valid for the rest of the pass
+				for (unsigned int k = triangleOffsets[collapse.from]; k < triangleOffsets[collapse.from + 1]; k++) {
+					unsigned int t = triangleList[k];
+					touched[canonical[indices[t]]] = 1;
+					touched[canonical[indices[t + 1]]] = 1;
+					touched[canonical[indices[t + 2]]] = 1;
+				}
+
+				//the source is not a seam, so every vertex welded to it takes the target's attributes
+				for (unsigned int k = weldOffsets[collapse.from]; k < weldOffsets[collapse.from + 1]; k++)
+					remap[weldList[k]] = collapse.toVertex;
+
+				quadrics[collapse.to] += quadrics[collapse.from];
+				maxCost = std::max(maxCost, collapse.cost);
+				removed += 2;
+				applied++;
+			}
+
+			if (applied == 0)
+				break;
+
+			//rewrite the triangles and drop the ones that collapsed to a line
+			size_t write = 0;
+			for (size_t t = 0; t < indices.size(); t += 3) {
+				unsigned int a = remap[indices[t]], b = remap[indices[t + 1]], c = remap[indices[t + 2]];
+				if (canonical[a] == canonical[b] || canonical[b] == canonical[c] || canonical[a] == canonical[c])
+					continue;
+				indices[write++] = a;
+				indices[write++] = b;
+				indices[write++] = c;
+			}
+			indices.resize(write);
+		}
+
+		if (resultError)
+			*resultError = (float)std::sqrt(maxCost);
+		return indices;
+	}
+
+	//Build up to maxLevels levels, each aiming for ratio times the triangles of the previous
+	//one. Stops early once the accumulated error reaches maxError or a level barely shrinks.
+	LodChain buildLodChain(const std::vector<unsigned int>& indices, unsigned int maxLevels = 6, float ratio = 0.5f, float maxError = FLT_MAX) {
+
+		LodChain chain;
+		MeshLod source = { indices, 0.0f };
+		chain.levels.push_back(source);
+
+		while (chain.levels.size() < maxLevels) {
+
+			const MeshLod& previous = chain.levels.back();
+			unsigned int target = (unsigned int)(previous.indices.size() / 3 * ratio) * 3;
+
+			//simplify() measures against the planes of the level it starts from, which has already
+			//moved off the source by previous.error; the two add up to a bound on the distance to
+			//the source. The budget left for this level shrinks by the same amount.
+			MeshLod level;
+			float stepError = 0.0f;
+			level.indices = simplify(previous.indices, target, maxError - previous.error, &stepError);
+			level.error = previous.error + stepError;
+
+			if (level.indices.empty() || level.indices.size() > previous.indices.size() * 0.9f)
+				break;
+			chain.levels.push_back(level);
+		}
+		return chain;
+	}
+
+private:
+
+	struct Quadric {
+		//symmetric 4x4 matrix, upper triangle
+		double a00, a01, a02, a03, a11, a12, a13, a22, a23, a33;
+
+		Quadric() : a00(0), a01(0), a02(0), a03(0), a11(0), a12(0), a13(0), a22(0), a23(0), a33(0) {}
+
+		static Quadric fromTriangle(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2) {
+			Quadric q;
+			glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+			float length = glm::length(n);
+			if (length <= 0.0f)
+				return q;
+			n /= length;
+			double a = n.x, b = n.y, c = n.z, d = -glm::dot(n, p0);
+			q.a00 = a * a; q.a01 = a * b; q.a02 = a * c; q.a03 = a * d;
+			q.a11 = b * b; q.a12 = b * c; q.a13 = b * d;
+			q.a22 = c * c; q.a23 = c * d;
+			q.a33 = d * d;
+			return q;
+		}
+
+		Quadric& operator+=(const Quadric& q) {
+			a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+			a11 += q.a11; a12 += q.a12; a13 += q.a13;
+			a22 += q.a22; a23 += q.a23;
+			a33 += q.a33;
+			return *this;
+		}
+
+		//sum of squared distances from p to every plane in the quadric
+		double evaluate(const glm::vec3& p) const {
+			double x = p.x, y = p.y, z = p.z;
+			double result = a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x
+				+ a11 * y * y + 2 * a12 * y * z + 2 * a13 * y
+				+ a22 * z * z + 2 * a23 * z
+				+ a33;
+			return result > 0.0 ? result : 0.0;
+		}
+	};
+
+	struct Collapse {
+		unsigned int from;     //welded source
+		unsigned int to;       //welded target
+		unsigned int toVertex; //target vertex carrying the attributes of the source's chart
+		double cost;
+	};
+
+	const float* vertices;
+	unsigned int vertexCount;
+	VertexFormat format;
+
+	std::vector<glm::vec3> positions;
+	std::vector<unsigned int> canonical;   //vertex -> first vertex sharing its position
+	std::vector<char> seam;                //per canonical vertex
+	std::vector<unsigned int> weldOffsets; //canonical vertex -> range in weldList
+	std::vector<unsigned int> weldList;
+
+	const float* vertex(unsigned int i) const {
+		return vertices + (size_t)i * format.floatsPerVertex;
+	}
+
+	struct PositionHash {
+		size_t operator()(const glm::vec3& p) const {
+			unsigned int h[3];
+			memcpy(h, &p, sizeof(h));
+			return (size_t)(h[0] * 73856093u ^ h[1] * 19349663u ^ h[2] * 83492791u);
+		}
+	};
+
+	void weldPositions() {
+
+		canonical.resize(vertexCount);
+		seam.assign(vertexCount, 0);
+
+		std::unordered_map<glm::vec3, unsigned int, PositionHash> first;
+		for (unsigned int i = 0; i < vertexCount; i++) {
+			std::unordered_map<glm::vec3, unsigned int, PositionHash>::iterator it = first.find(positions[i]);
+			if (it == first.end()) {
+				first[positions[i]] = i;
+				canonical[i] = i;
+			}
+			else {
+				canonical[i] = it->second;
+				//same position with different attributes is a seam
+				if (memcmp(vertex(i), vertex(it->second), format.floatsPerVertex * sizeof(float)) != 0)
+					seam[it->second] = 1;
+			}
+		}
+
+		weldOffsets.assign(vertexCount + 1, 0);
+		for (unsigned int i = 0; i < vertexCount; i++)
+			weldOffsets[canonical[i] + 1]++;
+		for (unsigned int i = 0; i < vertexCount; i++)
+			weldOffsets[i + 1] += weldOffsets[i];
+		weldList.resize(vertexCount);
+		std::vector<unsigned int> cursor(weldOffsets.begin(), weldOffsets.end() - 1);
+		for (unsigned int i = 0; i < vertexCount; i++)
+			weldList[cursor[canonical[i]]++] = i;
+	}
+
+	void lockSeamsAndBorders(const std::vector<unsigned int>& indices, std::vector<char>& locked) const {
+
+		for (unsigned int i = 0; i < vertexCount; i++)
+			locked[i] = seam[i];
+
+		//an edge used by a single triangle is on the border
+		std::unordered_map<unsigned long long, unsigned int> edgeUse;
+		for (size_t t = 0; t < indices.size(); t += 3) {
+			for (int e = 0; e < 3; e++) {
+				unsigned int a = canonical[indices[t + e]], b = canonical[indices[t + (e + 1) % 3]];
+				unsigned long long key = a < b ? ((unsigned long long)a << 32) | b : ((unsigned long long)b << 32) | a;
+				edgeUse[key]++;
+			}
+		}
+		for (const std::pair<const unsigned long long, unsigned int>& edge : edgeUse) {
+			if (edge.second == 1) {
+				locked[(unsigned int)(edge.first >> 32)] = 1;
+				locked[(unsigned int)(edge.first & 0xffffffff)] = 1;
+			}
+		}
+	}
+
+	//welded vertex -> triangles using it, as offsets into a flat list (counting sort)
+	void buildAdjacency(const std::vector<unsigned int>& indices, std::vector<unsigned int>& offsets, std::vector<unsigned int>& list) const {
+
+		offsets.assign(vertexCount + 1, 0);
+		for (size_t i = 0; i < indices.size(); i++)
+			offsets[canonical[indices[i]] + 1]++;
+		for (unsigned int i = 0; i < vertexCount; i++)
+			offsets[i + 1] += offsets[i];
+
+		list.resize(indices.size());
+		std::vector<unsigned int> cursor(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); i++)
+			list[cursor[canonical[indices[i]]]++] = (unsigned int)(i - i % 3);
+	}
+
+	//would moving from onto to turn any surviving triangle around from upside down?
+	bool flipsTriangles(const std::vector<unsigned int>& indices, const std::vector<unsigned int>& offsets, const std::vector<unsigned int>& list, unsigned int from, unsigned int to) const {
+
+		for (unsigned int k = offsets[from]; k < offsets[from + 1]; k++) {
+
+			unsigned int t = list[k];
+			unsigned int corner[3] = { canonical[indices[t]], canonical[indices[t + 1]], canonical[indices[t + 2]] };
+			if (corner[0] == to || corner[1] == to || corner[2] == to)
+				continue; //this one degenerates and is removed
+
+			glm::vec3 before[3], after[3];
+			for (int c = 0; c < 3; c++) {
+				before[c] = positions[corner[c]];
+				after[c] = corner[c] == from ? positions[to] : before[c];
+			}
+
+			glm::vec3 n0 = glm::cross(before[1] - before[0], before[2] - before[0]);
+			glm::vec3 n1 = glm::cross(after[1] - after[0], after[2] - after[0]);
+			if (glm::dot(n0, n1) <= 0.0f)
+				return true;
+		}
+		return false;
+	}
+};
+
+
+//Pick the coarsest level whose error, projected to the screen, stays under pixelThreshold.
+//fadeBand widens the switch into a cross-fade: while the next coarser level is within
+//fadeBand * pixelThreshold of being acceptable, fade reports how far to blend towards it.
+inline LodSelection selectLod(const LodChain& chain, float distance, float fovY, float screenHeight, float pixelThreshold, float fadeBand = 0.25f) {
+
+	//pixels per object space unit at this distance
+	float pixelsPerUnit = screenHeight / (2.0f * std::max(distance, 1e-4f) * std::tan(fovY * 0.5f));
+
+	LodSelection selection = { 0, 0, 0.0f };
+	for (unsigned int i = 0; i < chain.levels.size(); i++) {
+		if (chain.levels[i].error * pixelsPerUnit > pixelThreshold)
+			break;
+		selection.level = i;
+	}
+	selection.fadeLevel = selection.level;
+
+	if (selection.level + 1 < chain.levels.size() && fadeBand > 0.0f) {
+		float nextPixels = chain.levels[selection.level + 1].error * pixelsPerUnit;
+		float fade = 1.0f - (nextPixels - pixelThreshold) / (fadeBand * pixelThreshold);
+		if (fade > 0.0f) {
+			selection.fadeLevel = selection.level + 1;
+			selection.fade = std::min(fade, 1.0f);
+		}
+	}
+	return selection;
+}
+#endif
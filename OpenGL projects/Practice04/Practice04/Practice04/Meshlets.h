@@ -0,0 +1,413 @@
+#pragma once
+
+#ifndef MESHLETS_H
+#define MESHLETS_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "Frustum.h"
+#include "ThreadPool.h"
+#include "MeshGenerator.h"
+
+#include <vector>
+#include <unordered_set>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MESHLETS_SSE 1
+#endif
+
+
+//A small cluster of triangles with the bounds needed to cull it on its own
+struct Meshlet {
+	unsigned int firstIndex;    //into MeshletMesh::indices
+	unsigned int triangleCount;
+	unsigned int vertexCount;   //distinct vertices referenced, at most maxVertices
+};
+
+//what one culling pass did
+struct MeshletCullStats {
+	unsigned int clustersTested;
+	unsigned int frustumCulled;
+	unsigned int backfaceCulled;
+	unsigned int trianglesSubmitted;
+	unsigned int trianglesSaved;
+	double milliseconds;
+};
+
+
+//An indexed mesh split into meshlets, stored so that each meshlet's triangles are contiguous.
+//Bounds live in structure-of-arrays form so the culling pass tests four clusters per SSE op.
+class MeshletMesh {
+
+public:
+
+	std::vector<Meshlet> meshlets;
+	std::vector<unsigned int> indices; //mesh vertex indices, reordered by meshlet
+
+	//bounding sphere and backface cone per meshlet, padded to a multiple of 4
+	std::vector<float> centerX, centerY, centerZ, radius;
+	std::vector<float> coneX, coneY, coneZ, coneCutoff;
+
+	//Greedily grow meshlets over shared vertices so each one stays spatially compact.
+	//positions is strided in floats, as in an interleaved VBO.
+	void build(const float* positions, unsigned int stride, const std::vector<unsigned int>& sourceIndices,
+		unsigned int maxVertices = 64, unsigned int maxTriangles = 124) {
+
+		meshlets.clear();
+		indices.clear();
+		indices.reserve(sourceIndices.size());
+
+		unsigned int triangleCount = (unsigned int)sourceIndices.size() / 3;
+		unsigned int vertexCount = 0;
+		for (unsigned int index : sourceIndices)
+			vertexCount = std::max(vertexCount, index + 1);
+
+		//vertex -> triangles
+		std::vector<unsigned int> offsets(vertexCount + 1, 0), triangles(sourceIndices.size());
+		for (unsigned int index : sourceIndices)
+			offsets[index + 1]++;
+		for (unsigned int i = 0; i < vertexCount; i++)
+			offsets[i + 1] += offsets[i];
+		std::vector<unsigned int> cursor(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < sourceIndices.size(); i++)
+			triangles[cursor[sourceIndices[i]]++] = (unsigned int)(i / 3);
+
+		std::vector<char> emitted(triangleCount, 0);
+		std::vector<unsigned int> inMeshlet(vertexCount, 0xffffffff); //meshlet that last used the vertex
+		std::vector<unsigned int> meshletVertices;
+
+		Meshlet current = { 0, 0, 0 };
+		unsigned int scan = 0;
+
+		for (;;) {
+
+			//prefer the neighbouring triangle that brings in the fewest new vertices
+			unsigned int best = 0xffffffff;
+			unsigned int bestNew = 4;
+			for (unsigned int vertex : meshletVertices) {
+				for (unsigned int k = offsets[vertex]; k < offsets[vertex + 1]; k++) {
+					unsigned int t = triangles[k];
+					if (emitted[t])
+						continue;
+					unsigned int fresh = 0;
+					for (int c = 0; c < 3; c++)
+						fresh += inMeshlet[sourceIndices[t * 3 + c]] != meshlets.size();
+					if (fresh < bestNew) {
+						best = t;
+						bestNew = fresh;
+					}
+				}
+				if (bestNew == 0)
+					break;
+			}
+
+			//nothing adjacent, continue with the next unused triangle in order
+			if (best == 0xffffffff) {
+				while (scan < triangleCount && emitted[scan])
+					scan++;
+				if (scan == triangleCount)
+					break;
+				best = scan;
+				bestNew = 0;
+				for (int c = 0; c < 3; c++)
+					bestNew += inMeshlet[sourceIndices[best * 3 + c]] != meshlets.size();
+			}
+
+			//start a new meshlet when this triangle does not fit
+			if (current.vertexCount + bestNew > maxVertices || current.triangleCount + 1 > maxTriangles) {
+				finishMeshlet(current, meshletVertices);
+				current.firstIndex = (unsigned int)indices.size();
+				current.triangleCount = 0;
+				current.vertexCount = 0;
+				continue;
+			}
+
+			for (int c = 0; c < 3; c++) {
+				unsigned int vertex = sourceIndices[best * 3 + c];
+				if (inMeshlet[vertex] != meshlets.size()) {
+					inMeshlet[vertex] = (unsigned int)meshlets.size();
+					meshletVertices.push_back(vertex);
+					current.vertexCount++;
+				}
+				indices.push_back(vertex);
+			}
+			current.triangleCount++;
+			emitted[best] = 1;
+		}
+		if (current.triangleCount > 0)
+			finishMeshlet(current, meshletVertices);
+
+		computeBounds(positions, stride);
+	}
+
+	//Frustum and backface cone test every meshlet and write the surviving triangles to
+	//visibleIndices. mvp and cameraPosition are in the mesh's object space.
+	MeshletCullStats cull(const glm::mat4& mvp, const glm::vec3& cameraPosition, std::vector<unsigned int>& visibleIndices, ThreadPool& pool) {
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		Frustum frustum = Frustum::fromMatrix(mvp);
+		unsigned int count = (unsigned int)meshlets.size();
+		unsigned int chunkCount = (count + CHUNK - 1) / CHUNK;
+		if (chunks.size() < chunkCount)
+			chunks.resize(chunkCount);
+
+		pool.parallelFor(chunkCount, 1, [&](unsigned int begin, unsigned int end, unsigned int) {
+			for (unsigned int c = begin; c < end; c++)
+				cullChunk(c, std::min(count, (c + 1) * CHUNK), frustum, cameraPosition);
+		});
+
+		//stitch the per chunk outputs together in meshlet order
+		MeshletCullStats stats = { count, 0, 0, 0, 0, 0.0 };
+		size_t total = 0;
+		for (unsigned int c = 0; c < chunkCount; c++)
+			total += chunks[c].indices.size();
+		visibleIndices.resize(total);
+
+		size_t write = 0;
+		for (unsigned int c = 0; c < chunkCount; c++) {
+			std::copy(chunks[c].indices.begin(), chunks[c].indices.end(), visibleIndices.begin() + write);
+			write += chunks[c].indices.size();
+			stats.frustumCulled += chunks[c].frustumCulled;
+			stats.backfaceCulled += chunks[c].backfaceCulled;
+		}
+		stats.trianglesSubmitted = (unsigned int)(total / 3);
+		stats.trianglesSaved = (unsigned int)(indices.size() / 3) - stats.trianglesSubmitted;
+		stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return stats;
+	}
+
+	//Splits a million-triangle sphere into meshlets and culls it from a few viewpoints: the whole
+	//sphere in view, close enough that the frustum clips most of it, and grazing the surface.
+	//Also checks that no triangle facing the camera with a corner inside the frustum was culled.
+	static void benchmark(unsigned int runs = 20) {
+
+		std::vector<float> vertices;
+		std::vector<unsigned int> sourceIndices;
+		generateSphere(512, 1024, 10.0f, vertices, sourceIndices);
+		const unsigned int stride = 5;
+
+		MeshletMesh mesh;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		mesh.build(vertices.data(), stride, sourceIndices);
+		double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		std::cout << "MESHLETS::BENCHMARK " << sourceIndices.size() / 3 << " triangles in " << mesh.meshlets.size()
+			<< " meshlets, built in " << buildMs << " ms" << std::endl;
+
+		struct View { const char* name; glm::vec3 eye; glm::vec3 target; };
+		View views[] = {
+			{ "whole sphere", glm::vec3(0.0f, 0.0f, 40.0f), glm::vec3(0.0f) },
+			{ "close up", glm::vec3(0.0f, 0.0f, 12.0f), glm::vec3(0.0f) },
+			{ "grazing", glm::vec3(0.0f, 0.0f, 10.5f), glm::vec3(0.0f, 10.0f, 10.0f) },
+		};
+		glm::mat4 projection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 1000.0f);
+
+		std::vector<unsigned int> visibleIndices;
+		for (const View& view : views) {
+
+			glm::mat4 mvp = projection * glm::lookAt(view.eye, view.target, glm::vec3(0.0f, 1.0f, 0.0f));
+			MeshletCullStats stats = mesh.cull(mvp, view.eye, visibleIndices, defaultThreadPool());
+			double totalMs = 0.0;
+			for (unsigned int run = 0; run < runs; run++)
+				totalMs += mesh.cull(mvp, view.eye, visibleIndices, defaultThreadPool()).milliseconds;
+
+			unsigned int triangles = stats.trianglesSubmitted + stats.trianglesSaved;
+			std::cout << "    " << view.name << ": " << stats.clustersTested << " clusters tested, "
+				<< stats.frustumCulled + stats.backfaceCulled << " culled (" << stats.frustumCulled << " frustum, "
+				<< stats.backfaceCulled << " backface), " << stats.trianglesSaved << " of " << triangles << " triangles saved ("
+				<< 100.0 * stats.trianglesSaved / triangles << "%), " << totalMs / runs << " ms" << std::endl;
+
+			unsigned int missing = missingVisibleTriangles(vertices, stride, sourceIndices, visibleIndices, mvp, view.eye);
+			if (missing)
+				std::cout << "ERROR::MESHLETS::VISIBLE_TRIANGLES_CULLED " << missing << " in view " << view.name << std::endl;
+		}
+	}
+
+private:
+
+	static const unsigned int CHUNK = 256; //meshlets per culling job, a multiple of 4
+
+	//triangles facing the camera with a corner inside the frustum that did not make it into visibleIndices
+	static unsigned int missingVisibleTriangles(const std::vector<float>& vertices, unsigned int stride, const std::vector<unsigned int>& sourceIndices,
+		const std::vector<unsigned int>& visibleIndices, const glm::mat4& mvp, const glm::vec3& camera) {
+
+		//the winding is kept, but a meshlet may start a triangle at any corner
+		std::unordered_set<uint64_t> submitted;
+		for (size_t t = 0; t < visibleIndices.size(); t += 3)
+			submitted.insert(triangleKey(&visibleIndices[t]));
+
+		Frustum frustum = Frustum::fromMatrix(mvp);
+		unsigned int missing = 0;
+		for (size_t t = 0; t < sourceIndices.size(); t += 3) {
+			glm::vec3 p[3];
+			bool inside = false;
+			for (int c = 0; c < 3; c++) {
+				const float* v = &vertices[(size_t)sourceIndices[t + c] * stride];
+				p[c] = glm::vec3(v[0], v[1], v[2]);
+				inside = inside || frustum.intersectsSphere(p[c], 0.0f);
+			}
+			bool facing = glm::dot(glm::cross(p[1] - p[0], p[2] - p[0]), camera - p[0]) > 0.0f;
+			if (inside && facing && !submitted.count(triangleKey(&sourceIndices[t])))
+				missing++;
+		}
+		return missing;
+	}
+
+	//the same for every rotation of the corners, 21 bits an index
+	static uint64_t triangleKey(const unsigned int* corners) {
+		int first = 0;
+		for (int c = 1; c < 3; c++) {
+			if (corners[c] < corners[first])
+				first = c;
+		}
+		return (uint64_t)corners[first] << 42 | (uint64_t)corners[(first + 1) % 3] << 21 | corners[(first + 2) % 3];
+	}
+
+	struct ChunkOutput {
+		std::vector<unsigned int> indices;
+		unsigned int frustumCulled;
+		unsigned int backfaceCulled;
+	};
+	std::vector<ChunkOutput> chunks;
+
+	void finishMeshlet(const Meshlet& meshlet, std::vector<unsigned int>& meshletVertices) {
+		meshlets.push_back(meshlet);
+		meshletVertices.clear();
+	}
+
+	void computeBounds(const float* positions, unsigned int stride) {
+
+		size_t padded = (meshlets.size() + 3) & ~(size_t)3;
+		centerX.assign(padded, 0.0f); centerY.assign(padded, 0.0f); centerZ.assign(padded, 0.0f);
+		//padding can never pass the frustum test
+		radius.assign(padded, -1e30f);
+		coneX.assign(padded, 0.0f); coneY.assign(padded, 0.0f); coneZ.assign(padded, 0.0f);
+		coneCutoff.assign(padded, 2.0f);
+
+		for (size_t m = 0; m < meshlets.size(); m++) {
+
+			const Meshlet& meshlet = meshlets[m];
+			const unsigned int* triangle = &indices[meshlet.firstIndex];
+
+			glm::vec3 boxMin(1e30f), boxMax(-1e30f), normalSum(0.0f);
+			std::vector<glm::vec3> normals;
+			for (unsigned int t = 0; t < meshlet.triangleCount; t++) {
+				glm::vec3 p[3];
+				for (int c = 0; c < 3; c++) {
+					const float* v = positions + (size_t)triangle[t * 3 + c] * stride;
+					p[c] = glm::vec3(v[0], v[1], v[2]);
+					boxMin = glm::min(boxMin, p[c]);
+					boxMax = glm::max(boxMax, p[c]);
+				}
+				glm::vec3 n = glm::cross(p[1] - p[0], p[2] - p[0]);
+				float length = glm::length(n);
+				if (length > 0.0f) {
+					normals.push_back(n / length);
+					normalSum += n / length;
+				}
+			}
+
+			glm::vec3 center = (boxMin + boxMax) * 0.5f;
+			float r = 0.0f;
+			for (unsigned int i = 0; i < meshlet.triangleCount * 3; i++) {
+				const float* v = positions + (size_t)triangle[i] * stride;
+				r = std::max(r, glm::length(glm::vec3(v[0], v[1], v[2]) - center));
+			}
+			centerX[m] = center.x; centerY[m] = center.y; centerZ[m] = center.z;
+			radius[m] = r;
+
+			//the cone around the average normal that holds every triangle normal
+			float axisLength = glm::length(normalSum);
+			if (axisLength <= 0.0f)
+				continue;
+			glm::vec3 axis = normalSum / axisLength;
+			float minDot = 1.0f;
+			for (const glm::vec3& n : normals)
+				minDot = std::min(minDot, glm::dot(axis, n));
+
+			//wider than a hemisphere can never be entirely backfacing; leave cutoff at 2
+			if (minDot <= 0.0f)
+				continue;
+			coneX[m] = axis.x; coneY[m] = axis.y; coneZ[m] = axis.z;
+			coneCutoff[m] = std::sqrt(1.0f - minDot * minDot); //sine of the cone half angle
+		}
+	}
+
+	void emit(ChunkOutput& output, unsigned int m) const {
+		const Meshlet& meshlet = meshlets[m];
+		output.indices.insert(output.indices.end(), indices.begin() + meshlet.firstIndex,
+			indices.begin() + meshlet.firstIndex + meshlet.triangleCount * 3);
+	}
+
+	//a meshlet is backfacing when the camera sits outside its cone:
+	//dot(center - camera, axis) >= cutoff * |center - camera| + radius
+	void cullChunk(unsigned int chunk, unsigned int end, const Frustum& frustum, const glm::vec3& camera) {
+
+		ChunkOutput& output = chunks[chunk];
+		output.indices.clear();
+		output.frustumCulled = 0;
+		output.backfaceCulled = 0;
+
+		unsigned int begin = chunk * CHUNK;
+
+#ifdef MESHLETS_SSE
+		__m128 camX = _mm_set1_ps(camera.x), camY = _mm_set1_ps(camera.y), camZ = _mm_set1_ps(camera.z);
+		__m128 zero = _mm_setzero_ps();
+
+		for (unsigned int m = begin; m < end; m += 4) {
+
+			__m128 x = _mm_loadu_ps(&centerX[m]), y = _mm_loadu_ps(&centerY[m]), z = _mm_loadu_ps(&centerZ[m]);
+			__m128 r = _mm_loadu_ps(&radius[m]);
+			__m128 negR = _mm_sub_ps(zero, r);
+
+			__m128 inside = _mm_cmpeq_ps(zero, zero);
+			for (int p = 0; p < 6; p++) {
+				const glm::vec4& plane = frustum.planes[p];
+				__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_mul_ps(y, _mm_set1_ps(plane.y))),
+					_mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(d, negR));
+			}
+
+			__m128 dx = _mm_sub_ps(x, camX), dy = _mm_sub_ps(y, camY), dz = _mm_sub_ps(z, camZ);
+			__m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+			__m128 along = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, _mm_loadu_ps(&coneX[m])), _mm_mul_ps(dy, _mm_loadu_ps(&coneY[m]))),
+				_mm_mul_ps(dz, _mm_loadu_ps(&coneZ[m])));
+			__m128 backfacing = _mm_cmpge_ps(along, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&coneCutoff[m]), distance), r));
+
+			int insideMask = _mm_movemask_ps(inside);
+			int backMask = _mm_movemask_ps(backfacing) & insideMask;
+
+			for (unsigned int lane = 0; lane < 4 && m + lane < end; lane++) {
+				if (!(insideMask & (1 << lane)))
+					output.frustumCulled++;
+				else if (backMask & (1 << lane))
+					output.backfaceCulled++;
+				else
+					emit(output, m + lane);
+			}
+		}
+#else
+		for (unsigned int m = begin; m < end; m++) {
+			glm::vec3 center(centerX[m], centerY[m], centerZ[m]);
+			if (!frustum.intersectsSphere(center, radius[m])) {
+				output.frustumCulled++;
+				continue;
+			}
+			glm::vec3 toCenter = center - camera;
+			if (glm::dot(toCenter, glm::vec3(coneX[m], coneY[m], coneZ[m])) >= coneCutoff[m] * glm::length(toCenter) + radius[m]) {
+				output.backfaceCulled++;
+				continue;
+			}
+			emit(output, m);
+		}
+#endif
+	}
+};
+#endif
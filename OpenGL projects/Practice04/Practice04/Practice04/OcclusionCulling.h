@@ -0,0 +1,464 @@
+#pragma once
+
+#ifndef OCCLUSION_CULLING_H
+#define OCCLUSION_CULLING_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "FrustumCulling.h"
+#include "ThreadPool.h"
+
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define OCCLUSION_AVX2 1
+#define OCCLUSION_WIDTH 8
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OCCLUSION_SSE 1
+#define OCCLUSION_WIDTH 4
+#else
+#define OCCLUSION_WIDTH 1
+#endif
+
+
+//Low resolution software depth buffer for occlusion culling.
+//
+//Each frame a handful of large occluder meshes are transformed, clipped against the near plane
+//and binned into screen tiles, one bin list per thread. Tiles are then rasterized in parallel,
+//8 (AVX2) or 4 (SSE) pixels at a time, with a lane mask from the three edge functions deciding
+//which depths get written. Every tile also records the farthest depth of each 8x8 block and of
+//the whole tile, and occludee boxes are tested against that hierarchy: a box is hidden when its
+//nearest point lies behind the farthest occluder depth everywhere it covers.
+class OcclusionBuffer {
+
+public:
+
+	static const unsigned int TILE_WIDTH = 32;
+	static const unsigned int TILE_HEIGHT = 16;
+	static const unsigned int BLOCK_SIZE = 8;
+
+	struct Stats {
+		unsigned int occluders;
+		unsigned int triangles;          //binned after clipping and backface rejection
+		unsigned int occludeesTested;
+		unsigned int occludeesRejected;
+		double rasterizeMilliseconds;
+		double testMilliseconds;
+	};
+
+	//the resolution is rounded up to whole tiles
+	OcclusionBuffer(unsigned int bufferWidth = 320, unsigned int bufferHeight = 192) {
+		tilesX = (bufferWidth + TILE_WIDTH - 1) / TILE_WIDTH;
+		tilesY = (bufferHeight + TILE_HEIGHT - 1) / TILE_HEIGHT;
+		width = tilesX * TILE_WIDTH;
+		height = tilesY * TILE_HEIGHT;
+		blocksX = width / BLOCK_SIZE;
+		depth.resize(width * height);
+		blockMax.resize(blocksX * (height / BLOCK_SIZE));
+		tileMax.resize(tilesX * tilesY);
+		stats = Stats();
+	}
+
+	unsigned int getWidth() const { return width; }
+	unsigned int getHeight() const { return height; }
+	const Stats& getStats() const { return stats; }
+
+	//depth in [0, 1], 1 where no occluder was drawn
+	const std::vector<float>& getDepth() const { return depth; }
+
+	void beginFrame(const glm::mat4& viewProjectionMatrix) {
+		viewProjection = viewProjectionMatrix;
+		occluders.clear();
+		stats = Stats();
+	}
+
+	//Queue a mesh for rasterize(). positions hold xyz at the start of each vertex, stride floats
+	//apart; indices may be NULL for unindexed triangles. The data must stay alive until rasterize().
+	void addOccluder(const float* positions, unsigned int stride, const unsigned int* indices, unsigned int count, const glm::mat4& model) {
+		Occluder occluder = { positions, stride, indices, count, viewProjection * model };
+		occluders.push_back(occluder);
+	}
+
+	void rasterize(ThreadPool* pool = NULL) {
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		unsigned int threads = pool ? pool->getThreadCount() : 1;
+		if (bins.size() < threads)
+			bins.resize(threads);
+		for (unsigned int t = 0; t < threads; t++) {
+			bins[t].resize(tilesX * tilesY);
+			for (std::vector<ScreenTriangle>& bin : bins[t])
+				bin.clear();
+		}
+
+		//transform and bin, one occluder per job
+		ThreadPool::RangeFunction binOccluders = [&](unsigned int begin, unsigned int end, unsigned int thread) {
+			for (unsigned int i = begin; i < end; i++)
+				binOccluder(occluders[i], bins[thread]);
+		};
+		if (pool)
+			pool->parallelFor((unsigned int)occluders.size(), 1, binOccluders);
+		else
+			binOccluders(0, (unsigned int)occluders.size(), 0);
+
+		//rasterize, one tile per job; tiles never share pixels
+		ThreadPool::RangeFunction rasterizeTiles = [&](unsigned int begin, unsigned int end, unsigned int) {
+			for (unsigned int tile = begin; tile < end; tile++)
+				rasterizeTile(tile, threads);
+		};
+		if (pool)
+			pool->parallelFor(tilesX * tilesY, 2, rasterizeTiles);
+		else
+			rasterizeTiles(0, tilesX * tilesY, 0);
+
+		stats.occluders = (unsigned int)occluders.size();
+		for (unsigned int t = 0; t < threads; t++) {
+			for (const std::vector<ScreenTriangle>& bin : bins[t])
+				stats.triangles += (unsigned int)bin.size();
+		}
+		stats.rasterizeMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	//false when the world space box is hidden behind the occluders drawn this frame
+	bool isVisible(const glm::vec3& boxMin, const glm::vec3& boxMax) {
+		stats.occludeesTested++;
+		bool visible = testBox(boxMin, boxMax);
+		if (!visible)
+			stats.occludeesRejected++;
+		return visible;
+	}
+
+	//drop the occluded boxes from a list of box indices, e.g. the survivors of CullingSet::cullBoxes
+	void cullBoxes(const CullingSet& set, std::vector<unsigned int>& visible) {
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		size_t kept = 0;
+		for (size_t i = 0; i < visible.size(); i++) {
+			unsigned int box = visible[i];
+			glm::vec3 center(set.boxCenterX[box], set.boxCenterY[box], set.boxCenterZ[box]);
+			glm::vec3 extent(set.boxExtentX[box], set.boxExtentY[box], set.boxExtentZ[box]);
+			if (isVisible(center - extent, center + extent))
+				visible[kept++] = box;
+		}
+		visible.resize(kept);
+
+		stats.testMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void printStats() const {
+		std::cout << "OCCLUSION_CULLING::FRAME occluders " << stats.occluders
+			<< ", triangles " << stats.triangles
+			<< ", occludees rejected " << stats.occludeesRejected << "/" << stats.occludeesTested
+			<< ", rasterize " << stats.rasterizeMilliseconds << " ms"
+			<< ", test " << stats.testMilliseconds << " ms" << std::endl;
+	}
+
+	//A city block of box buildings hiding a field of small boxes, single threaded and on the
+	//default pool. No GL needed.
+	static void benchmark(unsigned int occludeeCount = 100000, unsigned int runs = 20) {
+
+		//unit cube, 12 triangles
+		const float cube[] = {
+			-0.5f, -0.5f, -0.5f,   0.5f, -0.5f, -0.5f,   0.5f,  0.5f, -0.5f,  -0.5f,  0.5f, -0.5f,
+			-0.5f, -0.5f,  0.5f,   0.5f, -0.5f,  0.5f,   0.5f,  0.5f,  0.5f,  -0.5f,  0.5f,  0.5f
+		};
+		const unsigned int cubeIndices[] = {
+			0, 2, 1,  0, 3, 2,   4, 5, 6,  4, 6, 7,   0, 1, 5,  0, 5, 4,
+			3, 6, 2,  3, 7, 6,   0, 4, 7,  0, 7, 3,   1, 2, 6,  1, 6, 5
+		};
+
+		std::vector<glm::mat4> buildings;
+		for (int x = -5; x <= 5; x++) {
+			for (int z = 1; z <= 6; z++)
+				buildings.push_back(glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(x * 12.0f, 10.0f, -z * 20.0f)), glm::vec3(10.0f, 20.0f, 10.0f)));
+		}
+
+		CullingSet occludees;
+		for (unsigned int i = 0; i < occludeeCount; i++) {
+			glm::vec3 center(-60.0f + (i % 400) * 0.3f, 0.5f + (i / 400 % 10) * 3.0f, -5.0f - (i / 4000) * 6.0f);
+			occludees.addBox(center - glm::vec3(0.4f), center + glm::vec3(0.4f));
+		}
+
+		glm::mat4 viewProjection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 400.0f)
+			* glm::lookAt(glm::vec3(0.0f, 5.0f, 10.0f), glm::vec3(0.0f, 5.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		Frustum frustum = Frustum::fromMatrix(viewProjection);
+
+		std::cout << "OCCLUSION_CULLING::BENCHMARK " << buildings.size() << " occluders, " << occludeeCount << " occludees, "
+			<< OCCLUSION_WIDTH << " pixels per instruction" << std::endl;
+
+		OcclusionBuffer buffer;
+		std::vector<unsigned int> visible;
+		ThreadPool* pools[2] = { NULL, &defaultThreadPool() };
+		for (int p = 0; p < 2; p++) {
+
+			double rasterizeTime = 0.0, testTime = 0.0;
+			size_t inFrustum = 0;
+			for (unsigned int run = 0; run < runs; run++) {
+				occludees.cullBoxes(frustum, visible);
+				inFrustum = visible.size();
+
+				buffer.beginFrame(viewProjection);
+				for (const glm::mat4& building : buildings)
+					buffer.addOccluder(cube, 3, cubeIndices, 36, building);
+				buffer.rasterize(pools[p]);
+				buffer.cullBoxes(occludees, visible);
+
+				rasterizeTime += buffer.getStats().rasterizeMilliseconds;
+				testTime += buffer.getStats().testMilliseconds;
+			}
+
+			std::cout << "    " << (pools[p] ? pools[p]->getThreadCount() : 1) << " thread(s): rasterize "
+				<< rasterizeTime / runs << " ms, test " << testTime / runs << " ms, "
+				<< visible.size() << "/" << inFrustum << " in-frustum occludees pass" << std::endl;
+		}
+		buffer.printStats();
+	}
+
+private:
+
+	struct Occluder {
+		const float* positions;
+		unsigned int stride;
+		const unsigned int* indices;
+		unsigned int count;
+		glm::mat4 mvp;
+	};
+
+	//screen space, counter-clockwise after setup
+	struct ScreenTriangle {
+		float x[3], y[3], z[3];
+	};
+
+	unsigned int width, height;
+	unsigned int tilesX, tilesY;
+	unsigned int blocksX;
+	std::vector<float> depth;
+	std::vector<float> blockMax; //farthest depth per 8x8 block
+	std::vector<float> tileMax;  //farthest depth per tile
+
+	glm::mat4 viewProjection;
+	std::vector<Occluder> occluders;
+	std::vector<std::vector<std::vector<ScreenTriangle> > > bins; //[thread][tile]
+	Stats stats;
+
+	void binOccluder(const Occluder& occluder, std::vector<std::vector<ScreenTriangle> >& tileBins) const {
+
+		for (unsigned int i = 0; i + 2 < occluder.count; i += 3) {
+
+			glm::vec4 clip[3];
+			for (int v = 0; v < 3; v++) {
+				unsigned int index = occluder.indices ? occluder.indices[i + v] : i + v;
+				const float* p = occluder.positions + (size_t)index * occluder.stride;
+				clip[v] = occluder.mvp * glm::vec4(p[0], p[1], p[2], 1.0f);
+			}
+
+			//clip against the near plane (z >= -w); one triangle becomes at most two
+			glm::vec4 polygon[4];
+			int count = 0;
+			for (int v = 0; v < 3; v++) {
+				const glm::vec4& a = clip[v];
+				const glm::vec4& b = clip[(v + 1) % 3];
+				float da = a.z + a.w, db = b.z + b.w;
+				if (da >= 0.0f)
+					polygon[count++] = a;
+				if ((da >= 0.0f) != (db >= 0.0f))
+					polygon[count++] = a + (b - a) * (da / (da - db));
+			}
+
+			for (int t = 1; t + 1 < count; t++)
+				binTriangle(polygon[0], polygon[t], polygon[t + 1], tileBins);
+		}
+	}
+
+	void binTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c, std::vector<std::vector<ScreenTriangle> >& tileBins) const {
+
+		const glm::vec4* clip[3] = { &a, &b, &c };
+		ScreenTriangle triangle;
+		for (int v = 0; v < 3; v++) {
+			float w = std::max(clip[v]->w, 1e-6f);
+			triangle.x[v] = (clip[v]->x / w * 0.5f + 0.5f) * width;
+			triangle.y[v] = (clip[v]->y / w * 0.5f + 0.5f) * height;
+			triangle.z[v] = clip[v]->z / w * 0.5f + 0.5f;
+		}
+
+		//occluders are closed meshes, so only front faces (counter-clockwise) need drawing
+		float area = (triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0]) - (triangle.x[2] - triangle.x[0]) * (triangle.y[1] - triangle.y[0]);
+		if (!(area > 0.0f))
+			return;
+
+		float minX = std::min(triangle.x[0], std::min(triangle.x[1], triangle.x[2]));
+		float maxX = std::max(triangle.x[0], std::max(triangle.x[1], triangle.x[2]));
+		float minY = std::min(triangle.y[0], std::min(triangle.y[1], triangle.y[2]));
+		float maxY = std::max(triangle.y[0], std::max(triangle.y[1], triangle.y[2]));
+		if (maxX < 0.0f || maxY < 0.0f || minX >= (float)width || minY >= (float)height)
+			return;
+
+		int tileX0 = std::max(0, (int)minX / (int)TILE_WIDTH), tileX1 = std::min((int)tilesX - 1, (int)maxX / (int)TILE_WIDTH);
+		int tileY0 = std::max(0, (int)minY / (int)TILE_HEIGHT), tileY1 = std::min((int)tilesY - 1, (int)maxY / (int)TILE_HEIGHT);
+		for (int ty = tileY0; ty <= tileY1; ty++) {
+			for (int tx = tileX0; tx <= tileX1; tx++)
+				tileBins[ty * tilesX + tx].push_back(triangle);
+		}
+	}
+
+	void rasterizeTile(unsigned int tile, unsigned int threads) {
+
+		unsigned int tileX = (tile % tilesX) * TILE_WIDTH;
+		unsigned int tileY = (tile / tilesX) * TILE_HEIGHT;
+
+		for (unsigned int y = 0; y < TILE_HEIGHT; y++)
+			std::fill(&depth[(tileY + y) * width + tileX], &depth[(tileY + y) * width + tileX] + TILE_WIDTH, 1.0f);
+
+		for (unsigned int t = 0; t < threads; t++) {
+			for (const ScreenTriangle& triangle : bins[t][tile])
+				rasterizeTriangle(triangle, tileX, tileY);
+		}
+
+		//farthest depth per block, then per tile
+		float farthest = 0.0f;
+		for (unsigned int by = tileY; by < tileY + TILE_HEIGHT; by += BLOCK_SIZE) {
+			for (unsigned int bx = tileX; bx < tileX + TILE_WIDTH; bx += BLOCK_SIZE) {
+				float blockFarthest = 0.0f;
+				for (unsigned int y = by; y < by + BLOCK_SIZE; y++) {
+					const float* row = &depth[y * width + bx];
+					for (unsigned int x = 0; x < BLOCK_SIZE; x++)
+						blockFarthest = std::max(blockFarthest, row[x]);
+				}
+				blockMax[(by / BLOCK_SIZE) * blocksX + bx / BLOCK_SIZE] = blockFarthest;
+				farthest = std::max(farthest, blockFarthest);
+			}
+		}
+		tileMax[tile] = farthest;
+	}
+
+	//Edge functions and depth are planes in screen space, stepped across each row one SIMD
+	//register of pixels at a time. Lanes outside any edge keep their old depth.
+	void rasterizeTriangle(const ScreenTriangle& t, unsigned int tileX, unsigned int tileY) {
+
+		float edgeA[3], edgeB[3], edgeC[3];
+		for (int e = 0; e < 3; e++) {
+			int a = (e + 1) % 3, b = (e + 2) % 3; //edge e is opposite vertex e
+			edgeA[e] = t.y[a] - t.y[b];
+			edgeB[e] = t.x[b] - t.x[a];
+			edgeC[e] = t.x[a] * t.y[b] - t.x[b] * t.y[a];
+		}
+		float area = edgeC[0] + edgeC[1] + edgeC[2];
+		float depthA = (edgeA[0] * t.z[0] + edgeA[1] * t.z[1] + edgeA[2] * t.z[2]) / area;
+		float depthB = (edgeB[0] * t.z[0] + edgeB[1] * t.z[1] + edgeB[2] * t.z[2]) / area;
+		float depthC = (edgeC[0] * t.z[0] + edgeC[1] * t.z[1] + edgeC[2] * t.z[2]) / area;
+
+		int minX = std::max((int)tileX, (int)std::floor(std::min(t.x[0], std::min(t.x[1], t.x[2]))));
+		int maxX = std::min((int)(tileX + TILE_WIDTH) - 1, (int)std::ceil(std::max(t.x[0], std::max(t.x[1], t.x[2]))));
+		int minY = std::max((int)tileY, (int)std::floor(std::min(t.y[0], std::min(t.y[1], t.y[2]))));
+		int maxY = std::min((int)(tileY + TILE_HEIGHT) - 1, (int)std::ceil(std::max(t.y[0], std::max(t.y[1], t.y[2]))));
+		if (minX > maxX || minY > maxY)
+			return;
+		minX &= ~(OCCLUSION_WIDTH - 1); //tiles are a multiple of the SIMD width
+
+		for (int y = minY; y <= maxY; y++) {
+
+			float py = y + 0.5f;
+			float* row = &depth[y * width];
+
+#if defined(OCCLUSION_AVX2)
+			__m256 lane = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+			__m256 rowE0 = _mm256_set1_ps(edgeB[0] * py + edgeC[0]), rowE1 = _mm256_set1_ps(edgeB[1] * py + edgeC[1]), rowE2 = _mm256_set1_ps(edgeB[2] * py + edgeC[2]);
+			__m256 rowZ = _mm256_set1_ps(depthB * py + depthC);
+			for (int x = minX; x <= maxX; x += 8) {
+				__m256 px = _mm256_add_ps(_mm256_set1_ps((float)x), lane);
+				__m256 e0 = _mm256_add_ps(_mm256_mul_ps(px, _mm256_set1_ps(edgeA[0])), rowE0);
+				__m256 e1 = _mm256_add_ps(_mm256_mul_ps(px, _mm256_set1_ps(edgeA[1])), rowE1);
+				__m256 e2 = _mm256_add_ps(_mm256_mul_ps(px, _mm256_set1_ps(edgeA[2])), rowE2);
+				__m256 inside = _mm256_cmp_ps(_mm256_min_ps(e0, _mm256_min_ps(e1, e2)), _mm256_setzero_ps(), _CMP_GE_OQ);
+				if (_mm256_movemask_ps(inside) == 0)
+					continue;
+				__m256 z = _mm256_add_ps(_mm256_mul_ps(px, _mm256_set1_ps(depthA)), rowZ);
+				__m256 old = _mm256_loadu_ps(row + x);
+				_mm256_storeu_ps(row + x, _mm256_blendv_ps(old, _mm256_min_ps(old, z), inside));
+			}
+#elif defined(OCCLUSION_SSE)
+			__m128 lane = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+			__m128 rowE0 = _mm_set1_ps(edgeB[0] * py + edgeC[0]), rowE1 = _mm_set1_ps(edgeB[1] * py + edgeC[1]), rowE2 = _mm_set1_ps(edgeB[2] * py + edgeC[2]);
+			__m128 rowZ = _mm_set1_ps(depthB * py + depthC);
+			for (int x = minX; x <= maxX; x += 4) {
+				__m128 px = _mm_add_ps(_mm_set1_ps((float)x), lane);
+				__m128 e0 = _mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(edgeA[0])), rowE0);
+				__m128 e1 = _mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(edgeA[1])), rowE1);
+				__m128 e2 = _mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(edgeA[2])), rowE2);
+				__m128 inside = _mm_cmpge_ps(_mm_min_ps(e0, _mm_min_ps(e1, e2)), _mm_setzero_ps());
+				if (_mm_movemask_ps(inside) == 0)
+					continue;
+				__m128 z = _mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(depthA)), rowZ);
+				__m128 old = _mm_loadu_ps(row + x);
+				__m128 nearer = _mm_min_ps(old, z);
+				_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, old)));
+			}
+#else
+			for (int x = minX; x <= maxX; x++) {
+				float px = x + 0.5f;
+				float e0 = edgeA[0] * px + edgeB[0] * py + edgeC[0];
+				float e1 = edgeA[1] * px + edgeB[1] * py + edgeC[1];
+				float e2 = edgeA[2] * px + edgeB[2] * py + edgeC[2];
+				if (e0 >= 0.0f && e1 >= 0.0f && e2 >= 0.0f)
+					row[x] = std::min(row[x], depthA * px + depthB * py + depthC);
+			}
+#endif
+		}
+	}
+
+	bool testBox(const glm::vec3& boxMin, const glm::vec3& boxMax) const {
+
+		//corners are the min corner plus any mix of the three edge vectors, already in clip space
+		glm::vec4 base = viewProjection * glm::vec4(boxMin, 1.0f);
+		glm::vec4 edgeX = viewProjection[0] * (boxMax.x - boxMin.x);
+		glm::vec4 edgeY = viewProjection[1] * (boxMax.y - boxMin.y);
+		glm::vec4 edgeZ = viewProjection[2] * (boxMax.z - boxMin.z);
+
+		float minX = (float)width, maxX = 0.0f, minY = (float)height, maxY = 0.0f, nearest = 1.0f;
+		for (int corner = 0; corner < 8; corner++) {
+			glm::vec4 clip = base;
+			if (corner & 1) clip += edgeX;
+			if (corner & 2) clip += edgeY;
+			if (corner & 4) clip += edgeZ;
+			if (clip.z < -clip.w)
+				return true; //crosses the near plane, too close to judge
+			float x = (clip.x / clip.w * 0.5f + 0.5f) * width;
+			float y = (clip.y / clip.w * 0.5f + 0.5f) * height;
+			minX = std::min(minX, x); maxX = std::max(maxX, x);
+			minY = std::min(minY, y); maxY = std::max(maxY, y);
+			nearest = std::min(nearest, clip.z / clip.w * 0.5f + 0.5f);
+		}
+
+		int x0 = std::max(0, (int)std::floor(minX)), x1 = std::min((int)width - 1, (int)std::floor(maxX));
+		int y0 = std::max(0, (int)std::floor(minY)), y1 = std::min((int)height - 1, (int)std::floor(maxY));
+		if (x0 > x1 || y0 > y1)
+			return true; //off screen; that is the frustum test's call
+
+		//whole tiles first, then the 8x8 blocks of the tiles that are not conclusive
+		for (int ty = y0 / (int)TILE_HEIGHT; ty <= y1 / (int)TILE_HEIGHT; ty++) {
+			for (int tx = x0 / (int)TILE_WIDTH; tx <= x1 / (int)TILE_WIDTH; tx++) {
+				if (nearest > tileMax[ty * tilesX + tx])
+					continue;
+
+				int bx0 = std::max(x0, tx * (int)TILE_WIDTH) / BLOCK_SIZE, bx1 = std::min(x1, (tx + 1) * (int)TILE_WIDTH - 1) / BLOCK_SIZE;
+				int by0 = std::max(y0, ty * (int)TILE_HEIGHT) / BLOCK_SIZE, by1 = std::min(y1, (ty + 1) * (int)TILE_HEIGHT - 1) / BLOCK_SIZE;
+				for (int by = by0; by <= by1; by++) {
+					for (int bx = bx0; bx <= bx1; bx++) {
+						if (nearest <= blockMax[by * blocksX + bx])
+							return true;
+					}
+				}
+			}
+		}
+		return false;
+	}
+};
+#endif
@@ -4,7 +4,33 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
+#include <cstring>
+#include <cstdlib>
 #include "Shader.h"
+#include "GLExtensions.h"
+#include "GLStateCache.h"
+#include "GLMemoryHooks.h"
+#include "MemoryTracker.h"
+#include "GPUProfiler.h"
+#include "CPUProfiler.h"
+#include "RenderQueue.h"
+#include "CommandRecorder.h"
+#include "FrustumCulling.h"
+#include "OcclusionCulling.h"
+#include "DynamicBVH.h"
+#include "HeadlessContext.h"
+#include "BufferArena.h"
+#include "StaticBatch.h"
+#include "MeshGenerator.h"
+#include "MeshSimplifier.h"
+#include "Meshlets.h"
+#include "IndirectRenderer.h"
+#include "BenchmarkRunner.h"
+#include "RegressionRunner.h"
+#include "TransformHierarchy.h"
+#include "ECS.h"
+#include "GlmBenchmark.h"
+#include "PerfHUD.h"
 #include "stb_image.h"
 
 //Method Declaration
@@ -12,31 +38,126 @@
 //----input forward declaration
 void processInput(GLFWwindow* window);
 
-//Variable Declaration
+//----performance overlay, F3 shows and hides it
+PerfHUD perfHUD;
+
+//Component Declaration
 
 //----Time
-float deltaTime = 0.0f; //I've done enough work in Unity to know what this is lol.
-float lastFrame = 0.0f;
+struct FrameClock {
+    float deltaTime; //I've done enough work in Unity to know what this is lol.
+    float lastFrame;
+};
 
 //----Camera Manipulation
-glm::vec3 cameraPos = glm::vec3(0.0f, 0.0f, 3.0f);
-glm::vec3 cameraFront = glm::vec3(0.0f, 0.0f, -1.0f);
-glm::vec3 cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
+struct Camera {
+    glm::vec3 position;
+    glm::vec3 front;
+    glm::vec3 up;
+    float yaw;
+    float pitch;
+};
+
+
+int main(int argc, char** argv) {
+
+    //----benchmarks that need no window
+    if (argc > 1 && strcmp(argv[1], "--bench-sort") == 0) {
+        RenderQueue::benchmarkSort();
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-record") == 0) {
+        ParallelRecorder::benchmark();
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-cull") == 0) {
+        CullingSet::benchmark();
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-occlusion") == 0) {
+        OcclusionBuffer::benchmark();
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-meshlets") == 0) {
+        MeshletMesh::benchmark();
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-bvh") == 0) {
+        DynamicBVH::benchmark();
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-ecs") == 0) {
+        World::benchmark();
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-profiler") == 0) {
+        return CPUProfiler::benchmark() ? 0 : 1;
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-glm") == 0) {
+        GlmBenchmark::run();
+        return 0;
+    }
+
+    //----the buffer arena needs GL, but no window
+    if (argc > 1 && strcmp(argv[1], "--bench-arena") == 0) {
+        HeadlessContext context;
+        if (!context.create(64, 64, 3, 3))
+            return -1;
+        BufferArena::benchmark();
+        context.destroy();
+        return 0;
+    }
 
-float yaw = -90.0f;
-float pitch = 0.0f;
+    //----offscreen run of a scripted scene: --bench-headless [scene] [frames] [output.json]
+    if (argc > 1 && strcmp(argv[1], "--bench-headless") == 0) {
+        BenchmarkOptions options;
+        if (argc > 2)
+            options.scene = argv[2];
+        if (argc > 3)
+            options.frames = (unsigned int)std::max(1, atoi(argv[3]));
+        if (argc > 4)
+            options.output = argv[4];
+        return BenchmarkRunner::run(options);
+    }
 
+    //----golden images and budgets for the same scenes: --regress [references dir] [frame budget ms] [--update-references]
+    if (argc > 1 && strcmp(argv[1], "--regress") == 0) {
+        RegressionOptions options;
+        int position = 0;
+        for (int i = 2; i < argc; i++) {
+            if (strcmp(argv[i], "--update-references") == 0)
+                options.updateReferences = true;
+            else if (position++ == 0)
+                options.references = argv[i];
+            else
+                options.frameBudgetMs = atof(argv[i]);
+        }
+        return RegressionRunner::run(options);
+    }
 
-int main() {
+    //----optional switches
+    bool gpuDriven = false; //cull and draw a grid of cubes on the GPU (needs GL 4.3)
+    bool traceCpu = false;  //write a Chrome trace of the CPU side to cpu_trace.json
+    for (int i = 1; i < argc; i++) {
+        gpuDriven = gpuDriven || strcmp(argv[i], "--gpu-driven") == 0;
+        traceCpu = traceCpu || strcmp(argv[i], "--trace-cpu") == 0;
+    }
 
     //----initialize glfw library and set contexts
     glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, gpuDriven ? 4 : 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
     //----create window object
     GLFWwindow* window = glfwCreateWindow(1600, 1200, "OpenGL Practice 04", NULL, NULL);
+    if (window == NULL && gpuDriven)
+    {
+        //----no 4.3 context on this driver; a 3.3 one still runs everything but the GPU driven grid
+        std::cout << "Failed to create a GL 4.3 window, retrying with 3.3" << std::endl;
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        window = glfwCreateWindow(1600, 1200, "OpenGL Practice 04", NULL, NULL);
+    }
     if (window == NULL)
     {
         std::cout << "Failed to create GLFW window" << std::endl;
@@ -53,17 +174,27 @@ int main() {
         return -1;
     }
 
-    //----Set Up the Viewport-------------------------------------------------------
-        //----create the viewport. Viewport exists within the window.
-    glViewport(0, 0, 1600, 1200);
+    //----load the entry points newer than the 3.3 core glad was generated for (used when the driver has them)
+    loadGLExtensions((GLADloadproc)glfwGetProcAddress);
 
-    //----define callback function that resizes viewport when window resizes.
-    void framebuffer_size_callback(GLFWwindow * window, int width, int height);
+    //----sizes of every buffer, texture and renderbuffer, for the HUD
+    glMemoryHooks().install();
 
-    //----register viewport resize callback
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    //----GPU time per pass, read back a few frames late so it never stalls
+    GPUProfiler gpuProfiler;
+
+    //----every per-frame state change goes through the cache so redundant calls never reach the driver
+    GLStateCache glState;
+#ifdef _DEBUG
+    glState.debug = true; //check the shadow state against glGet* after every change
+#endif
+
+    //----Set Up the Viewport-------------------------------------------------------
+        //----the viewport follows the framebuffer size: the render loop sets it through glState
+        //----every frame, so a resize needs no callback changing it behind the cache's back
 
     Shader practice04Shader("_vertexShader.vs", "_fragmentShader.fs");
+    RenderQueue::bindObjectBlock(practice04Shader.ID);
 
     //----Create the rectangle's vertices
     float vertices[] = {
@@ -111,24 +242,65 @@ int main() {
     };
 
 
-    unsigned int VBO, VAO;
-
-    //----Create the vertex buffer object
-    glGenBuffers(1, &VBO);
-    //----Create the vertex array to hold buffers
-    glGenVertexArrays(1, &VAO);
-
+    //----all static geometry lives in one vertex and one index buffer, carved up by BufferArena
+    BufferArena meshVertices(GL_ARRAY_BUFFER, 4 << 20);
+    BufferArena meshIndices(GL_ELEMENT_ARRAY_BUFFER, 1 << 20);
+
+    //----per object uniform blocks (the model matrices), one slot per draw
+    GLint uniformAlignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+    BufferArena objectUniforms(GL_UNIFORM_BUFFER, 1 << 20, (unsigned int)uniformAlignment);
+
+    //----Batch static geometry by vertex format. Every mesh with this layout shares one VAO and
+    //----one allocation in each arena, and is drawn with glDrawElementsBaseVertex.
+    VertexFormat cubeFormat = { 5, { { 0, 3, 0 }, { 1, 2, 3 } } };
+
+    StaticBatchSet sceneBatches;
+    BatchedMesh cube = sceneBatches.addMesh(cubeFormat, vertices, 36, NULL, 0);
+
+    //----a sphere with a chain of simplified levels. Every level is another index range over the
+    //----same vertices; each frame draws the coarsest one that stays within a pixel of the source.
+    std::vector<float> sphereVertices;
+    std::vector<unsigned int> sphereIndices;
+    generateSphere(48, 96, 0.5f, sphereVertices, sphereIndices);
+    unsigned int sphereVertexCount = (unsigned int)sphereVertices.size() / cubeFormat.floatsPerVertex;
+    LodChain sphereLods = MeshSimplifier(sphereVertices.data(), sphereVertexCount, cubeFormat).buildLodChain(sphereIndices);
+    std::vector<BatchedMesh> sphereLevels;
+    sphereLevels.push_back(sceneBatches.addMesh(cubeFormat, sphereVertices.data(), sphereVertexCount, sphereIndices.data(), (unsigned int)sphereIndices.size()));
+    for (size_t level = 1; level < sphereLods.levels.size(); level++) {
+        const std::vector<unsigned int>& levelIndices = sphereLods.levels[level].indices;
+        sphereLevels.push_back(sceneBatches.addIndexRange(sphereLevels[0], levelIndices.data(), (unsigned int)levelIndices.size()));
+    }
+    for (size_t level = 0; level < sphereLods.levels.size(); level++)
+        std::cout << "Sphere LOD " << level << ": " << sphereLods.levels[level].indices.size() / 3 << " triangles, error " << sphereLods.levels[level].error << std::endl;
 
-    //----Bind the vertex array object first, then bind and set vertex buffers, then configure vertex attributes
-    glBindVertexArray(VAO);
+    sceneBatches.build(meshVertices, meshIndices);
 
-    //----copy our vertices array in a vertex buffer for OpenGL to use
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    unsigned int VBO = sceneBatches.batches[cube.batch].getVBO();
+    size_t cubeVertexOffset = sceneBatches.batches[cube.batch].getVertexByteOffset();
 
-    //----Define the vertex position
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
+    //----GPU driven path: one compute dispatch and one multi-draw for the whole grid
+    if (gpuDriven && !IndirectRenderer::isSupported()) {
+        std::cout << "GPU driven rendering needs GL 4.3, using the regular path" << std::endl;
+        gpuDriven = false;
+    }
+    BufferArena* instanceArena = NULL;
+    IndirectRenderer* indirectRenderer = NULL;
+    Shader* indirectShader = NULL;
+    if (gpuDriven) {
+        //----per cube object data, draw command and object index, 120 bytes for each of the 100000
+        instanceArena = new BufferArena(GL_SHADER_STORAGE_BUFFER, 16 << 20, IndirectRenderer::instanceGranularity());
+        indirectRenderer = new IndirectRenderer(sceneBatches.batches[cube.batch], *instanceArena);
+        indirectShader = new Shader("_indirectVertexShader.vs", "_fragmentShader.fs");
+        StaticBatch::Range cubeRange = sceneBatches.batches[cube.batch].getRange(cube.mesh);
+        for (int x = -50; x < 50; x++) {
+            for (int y = -10; y < 10; y++) {
+                for (int z = 1; z <= 50; z++)
+                    indirectRenderer->addObject(cubeRange, glm::translate(glm::mat4(1.0f), glm::vec3(x * 2.0f, y * 2.0f, -z * 2.0f)), glm::vec3(0.0f), 0.866f);
+            }
+        }
+        std::cout << "GPU driven: " << indirectRenderer->getObjectCount() << " cubes" << std::endl;
+    }
 
     //----------Light initializiation----------------------
 
@@ -139,12 +311,10 @@ int main() {
     //We can reuse the VBO cuz it has all the data we need.
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)cubeVertexOffset);
     glEnableVertexAttribArray(0);
     //-----------------------------------------------------
 
-    glEnable(GL_DEPTH_TEST);
-
 
     //----Projection matrix (initialized early on account of it not changing every frame)
     glm::mat4 projection = glm::mat4(1.0f);
@@ -155,53 +325,203 @@ int main() {
 
 
 
+    RenderQueue renderQueue;
+
+    //----scene objects live as entities instead of globals
+    World scene;
+    Camera startCamera = { glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, 0.0f };
+    FrameClock startClock = { 0.0f, 0.0f };
+    Entity camera = scene.create(startCamera);
+    Entity clock = scene.create(startClock);
+
+    //----scene transforms; only nodes that change get their world matrix recomputed
+    TransformHierarchy sceneTransforms;
+    TransformHierarchy::Node sceneRoot = sceneTransforms.create();
+    TransformHierarchy::Node cubeNode = sceneTransforms.create(sceneRoot);
+
+    //----bounding spheres of everything in the scene, culled against the view frustum each frame
+    CullingSet cullingSet;
+    unsigned int cubeBounds = cullingSet.addSphere(glm::vec3(0.0f), 0.866f); //half the cube's diagonal
+    glm::vec3 spherePosition(1.5f, 0.0f, -1.0f);
+    unsigned int sphereBounds = cullingSet.addSphere(spherePosition, 0.5f);
+    std::vector<unsigned int> visibleObjects;
+
+    perfHUD.init();
+
+    if (traceCpu && cpuProfiler().start("cpu_trace.json"))
+        cpuProfiler().setThreadName("main");
+
     //----MAIN RENDER LOOP-----------------------------------------------------------------------
     while (!glfwWindowShouldClose(window))
     {
+        PROFILE_SCOPE("frame");
+
         //----Calculate deltaTime
+        FrameClock& frameClock = *scene.get<FrameClock>(clock);
         float currentFrame = glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
-
-        processInput(window);
+        frameClock.deltaTime = currentFrame - frameClock.lastFrame;
+        frameClock.lastFrame = currentFrame;
+
+        glState.beginFrame();
+        gpuProfiler.beginFrame();
+        gpuProfiler.beginScope("frame");
+        perfHUD.beginFrame();
+        HUDCounters hudCounters;
+
+        {
+            PROFILE_SCOPE("input");
+            processInput(window);
+        }
+
+        //----the HUD leaves its own state set, so the scene sets what it needs every frame; the cache
+        //----only lets through what differs
+        int framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        glState.viewport(0, 0, framebufferWidth, framebufferHeight);
+        glState.setDepthTest(true);
+        glState.setBlend(false);
 
         //----Define the color of the viewport when cleared
-        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+        glState.clearColor(0.2f, 0.3f, 0.3f, 1.0f);
         //----Clear the viewport
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 
         //Model View Projection matrices are the true MVP
 
-        //----Model matrix
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::rotate(model, (float)glfwGetTime() * glm::radians(50.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-
-        int modelLoc = glGetUniformLocation(practice04Shader.ID, "model");
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+        const Camera& viewer = *scene.get<Camera>(camera);
+        glm::mat4 model;
+        glm::mat4 view;
+        {
+            PROFILE_SCOPE("matrix setup");
 
-        //----View matrix
-        glm::mat4 view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
-        int viewLoc = glGetUniformLocation(practice04Shader.ID, "view");
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
+            //----Model matrix
+            sceneTransforms.setRotation(cubeNode, glm::angleAxis((float)glfwGetTime() * glm::radians(50.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+            sceneTransforms.update();
+            model = sceneTransforms.world(cubeNode);
 
+            //----View matrix
+            view = glm::lookAt(viewer.position, viewer.position + viewer.front, viewer.up);
+        }
 
-        practice04Shader.use();
-        practice04Shader.setVec3("objectColor", 1.0f, 0.5f, 0.31f);
-        practice04Shader.setVec3("lightColor", 1.0f, 1.0f, 1.0f);
-
-        glBindVertexArray(VAO);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        int modelLoc = glGetUniformLocation(practice04Shader.ID, "model");
+        {
+            PROFILE_SCOPE("uniform upload");
+            glState.useProgram(practice04Shader.ID);
+            int viewLoc = glGetUniformLocation(practice04Shader.ID, "view");
+            glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
+
+            practice04Shader.setVec3("objectColor", 1.0f, 0.5f, 0.31f);
+            practice04Shader.setVec3("lightColor", 1.0f, 1.0f, 1.0f);
+        }
+
+        {
+            PROFILE_SCOPE("draw");
+
+            //----Cull, record the visible draws, sort them by state and depth, then issue them
+            cullingSet.setSphere(cubeBounds, glm::vec3(model[3]), 0.866f);
+            cullingSet.cullSpheres(Frustum::fromMatrix(projection * view), visibleObjects);
+
+            renderQueue.clear();
+
+            const StaticBatch& cubeBatch = sceneBatches.batches[cube.batch];
+            StaticBatch::Range cubeRange = cubeBatch.getRange(cube.mesh);
+            float cubeDepth = glm::length(glm::vec3(model[3]) - viewer.position) / 100.0f; //normalized by the far plane
+
+            RenderCommand cubeCommand = {
+                RenderKey::opaque(0, practice04Shader.ID, 0, cubeBatch.getVAO(), cubeDepth),
+                practice04Shader.ID, cubeBatch.getVAO(), 0,
+                modelLoc, renderQueue.addTransform(model),
+                cubeRange.firstIndex, cubeRange.count, cubeRange.baseVertex, true
+            };
+
+            //----the sphere's level follows its projected size; the fade is not drawn, the level switches
+            float sphereDistance = glm::length(spherePosition - viewer.position);
+            LodSelection sphereLod = selectLod(sphereLods, sphereDistance, glm::radians(45.0f), (float)framebufferHeight, 1.0f, 0.0f);
+            BatchedMesh sphereMesh = sphereLevels[sphereLod.level];
+            StaticBatch::Range sphereRange = sceneBatches.batches[sphereMesh.batch].getRange(sphereMesh.mesh);
+            RenderCommand sphereCommand = {
+                RenderKey::opaque(0, practice04Shader.ID, 0, cubeBatch.getVAO(), sphereDistance / 100.0f),
+                practice04Shader.ID, cubeBatch.getVAO(), 0,
+                modelLoc, renderQueue.addTransform(glm::translate(glm::mat4(1.0f), spherePosition)),
+                sphereRange.firstIndex, sphereRange.count, sphereRange.baseVertex, true
+            };
+
+            hudCounters.drawCalls = 0;
+            hudCounters.triangles = 0;
+            for (unsigned int visible : visibleObjects) {
+                const RenderCommand& command = visible == sphereBounds ? sphereCommand : cubeCommand;
+                renderQueue.push(command);
+                hudCounters.drawCalls++;
+                hudCounters.triangles += command.count / 3;
+            }
+
+            renderQueue.sort();
+            renderQueue.uploadTransforms(objectUniforms);
+            gpuProfiler.beginScope("render queue");
+            renderQueue.execute(glState);
+            gpuProfiler.endScope();
+
+            if (gpuDriven) {
+                glState.useProgram(indirectShader->ID);
+                glUniformMatrix4fv(glGetUniformLocation(indirectShader->ID, "view"), 1, GL_FALSE, glm::value_ptr(view));
+                glUniformMatrix4fv(glGetUniformLocation(indirectShader->ID, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+                indirectShader->setVec3("objectColor", 0.31f, 0.5f, 1.0f);
+                indirectShader->setVec3("lightColor", 1.0f, 1.0f, 1.0f);
+                GPUProfileScope scope(gpuProfiler, "gpu driven");
+                indirectRenderer->draw(glState, projection * view, indirectShader->ID);
+                hudCounters.drawCalls++;
+                hudCounters.triangles = -1; //culled on the GPU, the survivors are never read back
+            }
+        }
+        gpuProfiler.endScope();
+
+        {
+            PROFILE_SCOPE("hud");
+            hudCounters.stateChanges = glState.getCurrentFrame().totalIssued();
+            hudCounters.cpuMemoryBytes = 0;
+            for (int tag = 0; tag < MEMORY_TAG_COUNT; tag++)
+                hudCounters.cpuMemoryBytes += (long long)cpuMemory().getStats(tag).liveBytes;
+            hudCounters.gpuMemoryBytes = 0;
+            for (int category = 0; category < GPU_MEMORY_CATEGORY_COUNT; category++)
+                hudCounters.gpuMemoryBytes += (long long)gpuMemory().getStats(category).liveBytes;
+            perfHUD.setCounters(hudCounters);
+            perfHUD.render(framebufferWidth, framebufferHeight, glState);
+        }
 
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        {
+            PROFILE_SCOPE("swap");
+            glfwSwapBuffers(window);
+        }
+        {
+            PROFILE_SCOPE("poll");
+            glfwPollEvents();
+        }
     }
 
 
     //exit
+    cpuProfiler().stop();
+    gpuProfiler.printReport();
+    gpuProfiler.printTimeline();
+    gpuProfiler.destroy();
+    perfHUD.destroy();
+    if (indirectRenderer) {
+        indirectRenderer->destroy();
+        delete indirectRenderer;
+        delete indirectShader;
+        instanceArena->destroy();
+        delete instanceArena;
+    }
+    sceneBatches.destroy();
+    renderQueue.releaseTransforms();
+    objectUniforms.destroy();
+    meshVertices.destroy();
+    meshIndices.destroy();
+    glMemoryHooks().uninstall();
     glfwTerminate();
     return 0;
 }
@@ -211,12 +531,11 @@ int main() {
 
 
 
-void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
-    glViewport(0, 0, width, height);
-}
 void processInput(GLFWwindow* window)
 {
     
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
+
+    perfHUD.handleToggleKey(glfwGetKey(window, GLFW_KEY_F3) == GLFW_PRESS);
 }
\ No newline at end of file
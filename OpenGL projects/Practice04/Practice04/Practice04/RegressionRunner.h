@@ -0,0 +1,177 @@
+#pragma once
+
+#ifndef REGRESSION_RUNNER_H
+#define REGRESSION_RUNNER_H
+
+#include <glad/glad.h>
+#include "BenchmarkRunner.h"
+#include "GoldenImage.h"
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <algorithm>
+#include <iostream>
+
+
+struct RegressionOptions {
+	std::string references = "golden"; //directory of <scene>_<frame>.ppm; must exist
+	unsigned int frames = 240;          //one orbit of the scripted camera
+	unsigned int checkpointEvery = 60;  //frames compared against their reference
+	int width = 640;
+	int height = 480;
+	float threshold = 0.01f;            //GoldenImage perceived difference a pixel may have
+	float maxMismatchFraction = 0.001f; //of the pixels, may exceed it
+	double frameBudgetMs = -1.0;        //replaces every scene's frame budget when >= 0; 0 turns it off
+	bool updateReferences = false;      //write every checkpoint as the new reference instead of comparing
+};
+
+
+//Checks in one run that the benchmark scenes still draw what they drew and still fit their budgets.
+//
+//Each scene is rendered offscreen along BenchmarkRunner's scripted orbit. At every checkpoint the
+//framebuffer is read back and compared with the stored reference through GoldenImage. A missing
+//reference fails the checkpoint like a wrong image would: the references are committed under
+//golden/, and only an explicit updateReferences run (--update-references) writes them. Over the
+//whole orbit the most draw calls in any frame must stay inside the scene's budget, and so must
+//the p95 frame time on a GPU. On a software rasterizer (llvmpipe on a CI box) frame times say
+//nothing about the GPU budget, so the time budget is off there unless frameBudgetMs asks for one.
+//A change meant to make a scene faster (batching, culling, compression) is therefore shown to be
+//both correct and within budget by the same command.
+//
+//Failing checkpoints leave <scene>_<frame>.actual.ppm and <scene>_<frame>.diff.ppm next to the reference.
+class RegressionRunner {
+
+public:
+
+	struct Budget {
+		const char* scene;
+		double frameMsP95;         //60 Hz with room to spare on the GPUs we develop on
+		unsigned int maxDrawCalls; //more means culling or batching broke
+	};
+
+	static const Budget* getBudgets(size_t& count) {
+		static const Budget budgets[] = {
+			{ "cubes", 16.0, 7800 }, //7747 at worst along the orbit; all 8192 means culling stopped
+			{ "gpu-driven", 16.0, 1 }
+		};
+		count = sizeof(budgets) / sizeof(budgets[0]);
+		return budgets;
+	}
+
+	//0 when every scene passes, like main()
+	static int run(const RegressionOptions& options) {
+
+		size_t budgetCount;
+		const Budget* budgets = getBudgets(budgetCount);
+
+		unsigned int failed = 0;
+		for (size_t i = 0; i < budgetCount; i++)
+			failed += runScene(options, budgets[i]) ? 0 : 1;
+
+		std::cout << "REGRESSION::" << (failed ? "FAILED " : "PASSED ") << budgetCount - failed << "/" << budgetCount << " scenes" << std::endl;
+		return failed ? 1 : 0;
+	}
+
+private:
+
+	static bool runScene(const RegressionOptions& options, const Budget& sceneBudget) {
+
+		std::string scene = sceneBudget.scene;
+		bool gpuDriven = scene == "gpu-driven";
+
+		HeadlessContext context;
+		if (!context.create(options.width, options.height, gpuDriven ? 4 : 3, 3)) {
+			std::cout << "REGRESSION::" << scene << " FAIL no context" << std::endl;
+			return false;
+		}
+		loadGLExtensions(context.getLoader());
+		std::string renderer = (const char*)glGetString(GL_RENDERER);
+		Budget budget = sceneBudget;
+		if (options.frameBudgetMs >= 0.0)
+			budget.frameMsP95 = options.frameBudgetMs;
+		else if (HeadlessContext::isSoftwareRenderer())
+			budget.frameMsP95 = 0.0;
+		if (gpuDriven && !IndirectRenderer::isSupported()) {
+			//not a failure: the driver can't run the scene at all
+			std::cout << "REGRESSION::" << scene << " SKIPPED needs GL 4.3" << std::endl;
+			context.destroy();
+			return true;
+		}
+
+		bool passed = true;
+		std::vector<double> frameMs;
+		unsigned int maxDrawCalls = 0;
+		Image rendered(options.width, options.height);
+		{
+			BenchmarkRunner::Scene benchmarkScene(gpuDriven);
+			float aspect = (float)options.width / options.height;
+
+			for (unsigned int frame = 0; frame < options.frames; frame++) {
+				BenchmarkRunner::FrameSample sample = benchmarkScene.render(frame, options.frames, aspect);
+				frameMs.push_back(sample.frameMs);
+				maxDrawCalls = std::max(maxDrawCalls, sample.drawCalls);
+
+				if (frame % options.checkpointEvery == 0) {
+					context.readPixels(rendered.pixels.data());
+					passed = checkImage(options, scene, frame, rendered) && passed;
+				}
+			}
+			benchmarkScene.destroy();
+		}
+		context.destroy();
+
+		std::sort(frameMs.begin(), frameMs.end());
+		double p95 = frameMs[std::min(frameMs.size() - 1, frameMs.size() * 95 / 100)];
+
+		bool withinTime = budget.frameMsP95 <= 0.0 || p95 <= budget.frameMsP95;
+		bool withinDraws = maxDrawCalls <= budget.maxDrawCalls;
+		std::ostringstream timeBudget;
+		if (budget.frameMsP95 > 0.0)
+			timeBudget << budget.frameMsP95;
+		else if (options.frameBudgetMs < 0.0)
+			timeBudget << "off on " << renderer;
+		else
+			timeBudget << "off";
+		std::cout << "REGRESSION::" << scene
+			<< " frame p95 " << p95 << " ms (budget " << timeBudget.str() << ")" << (withinTime ? "" : " OVER")
+			<< ", draws " << maxDrawCalls << " (budget " << budget.maxDrawCalls << ")" << (withinDraws ? "" : " OVER") << std::endl;
+
+		passed = passed && withinTime && withinDraws;
+		std::cout << "REGRESSION::" << scene << (passed ? " PASS" : " FAIL") << std::endl;
+		return passed;
+	}
+
+	static bool checkImage(const RegressionOptions& options, const std::string& scene, unsigned int frame, const Image& rendered) {
+
+		std::string name = options.references + "/" + scene + "_" + std::to_string(frame);
+		if (options.updateReferences) {
+			bool written = rendered.writePPM(name + ".ppm");
+			std::cout << "    " << name << ".ppm " << (written ? "reference written" : "FAIL reference not writable") << std::endl;
+			return written;
+		}
+
+		Image reference;
+		if (!reference.readPPM(name + ".ppm")) {
+			rendered.writePPM(name + ".actual.ppm");
+			std::cout << "    " << name << ".ppm FAIL reference missing; rerun with --update-references to record it" << std::endl;
+			return false;
+		}
+
+		ImageComparison comparison = GoldenImage::compare(reference, rendered, options.threshold);
+		bool passed = comparison.passes(options.maxMismatchFraction);
+		if (!comparison.sizeMatches)
+			std::cout << "    " << name << ".ppm FAIL reference is " << reference.width << "x" << reference.height << std::endl;
+		else
+			std::cout << "    " << name << ".ppm " << (passed ? "ok " : "FAIL ") << comparison.mismatched << "/" << comparison.total
+				<< " pixels off, max difference " << comparison.maxDifference << std::endl;
+
+		if (!passed) {
+			rendered.writePPM(name + ".actual.ppm");
+			if (comparison.sizeMatches)
+				comparison.difference.writePPM(name + ".diff.ppm");
+		}
+		return passed;
+	}
+};
+#endif
@@ -0,0 +1,280 @@
+#pragma once
+
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include "GLStateCache.h"
+#include "BufferArena.h"
+
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+
+
+//One draw, recorded instead of issued. Plain data so it can be copied and sorted freely.
+struct RenderCommand {
+	uint64_t key;
+	unsigned int program;
+	unsigned int vertexArray;
+	unsigned int texture;       //bound to unit 0, 0 for none
+	int modelLocation;          //uniform receiving the transform, -1 for none; unused once transforms are in a uniform arena
+	unsigned int transform;     //index into RenderQueue::transforms
+	unsigned int firstIndex;    //first vertex when not indexed
+	unsigned int count;
+	int baseVertex;
+	bool indexed;
+};
+
+
+//Sort key layout, most significant first. Opaque draws group by state and then go front to
+//back for early-z; translucent draws go back to front before anything else.
+//
+//   opaque:      layer:4 | 0 | program:10 | texture:12 | vertex array:10 | depth:24 | 3 spare
+//   translucent: layer:4 | 1 | inverted depth:24 | program:10 | texture:12 | vertex array:10 | 3 spare
+//
+//GL names are masked into their fields; a collision only affects ordering, never correctness.
+namespace RenderKey {
+
+	const unsigned int DEPTH_BITS = 24;
+
+	inline uint64_t quantizeDepth(float depth01) {
+		depth01 = std::min(std::max(depth01, 0.0f), 1.0f);
+		return (uint64_t)(depth01 * (float)((1u << DEPTH_BITS) - 1));
+	}
+
+	inline uint64_t opaque(unsigned int layer, unsigned int program, unsigned int texture, unsigned int vertexArray, float depth01) {
+		return ((uint64_t)(layer & 0xf) << 60)
+			| ((uint64_t)(program & 0x3ff) << 49)
+			| ((uint64_t)(texture & 0xfff) << 37)
+			| ((uint64_t)(vertexArray & 0x3ff) << 27)
+			| (quantizeDepth(depth01) << 3);
+	}
+
+	inline uint64_t translucent(unsigned int layer, unsigned int program, unsigned int texture, unsigned int vertexArray, float depth01) {
+		uint64_t inverted = ((1u << DEPTH_BITS) - 1) - quantizeDepth(depth01);
+		return ((uint64_t)(layer & 0xf) << 60)
+			| ((uint64_t)1 << 59)
+			| (inverted << 35)
+			| ((uint64_t)(program & 0x3ff) << 25)
+			| ((uint64_t)(texture & 0xfff) << 13)
+			| ((uint64_t)(vertexArray & 0x3ff) << 3);
+	}
+}
+
+
+//Per-frame list of draws. Commands are pushed in any order, sorted by key with an LSD radix
+//sort and then executed through the state cache, so neighbouring draws share state.
+//
+//Transforms reach the shaders one of two ways. By default execute() sets each draw's model
+//uniform with glUniformMatrix4fv. After uploadTransforms() they come from a uniform-block arena
+//instead: the frame's transforms sit in one allocation, one slot per transform, written with a
+//single upload, and each draw binds its slot to OBJECT_BLOCK_BINDING, which the shaders read as
+//"ObjectBlock" (see bindObjectBlock()).
+class RenderQueue {
+
+public:
+
+	static const GLuint OBJECT_BLOCK_BINDING = 0;
+
+	std::vector<RenderCommand> commands;
+	std::vector<glm::mat4> transforms;
+
+	RenderQueue() : uniforms(NULL), transformHandle(BufferArena::INVALID_HANDLE), transformStride(0) {}
+
+	//point a program's ObjectBlock at OBJECT_BLOCK_BINDING; once, after linking
+	static void bindObjectBlock(GLuint program) {
+		GLuint block = glGetUniformBlockIndex(program, "ObjectBlock");
+		if (block == GL_INVALID_INDEX) {
+			std::cout << "ERROR::RENDER_QUEUE::NO_OBJECT_BLOCK program " << program << std::endl;
+			return;
+		}
+		glUniformBlockBinding(program, block, OBJECT_BLOCK_BINDING);
+	}
+
+	//Writes this frame's transforms into the arena, which needs GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+	//as its granularity. The allocation is kept and only replaced when the frame needs more; the
+	//driver orders the upload after last frame's draws that still read it.
+	void uploadTransforms(BufferArena& arena) {
+
+		size_t granularity = arena.getGranularity();
+		transformStride = (sizeof(glm::mat4) + granularity - 1) / granularity * granularity;
+		size_t bytes = std::max<size_t>(transforms.size(), 1) * transformStride;
+
+		if (uniforms != &arena || transformHandle == BufferArena::INVALID_HANDLE || arena.sizeOf(transformHandle) < bytes) {
+			if (uniforms)
+				uniforms->free(transformHandle);
+			uniforms = &arena;
+			transformHandle = arena.allocate(bytes * 2); //room to grow before the next reallocation
+			if (transformHandle == BufferArena::INVALID_HANDLE) {
+				uniforms = NULL;
+				return;
+			}
+		}
+
+		staging.resize(bytes);
+		for (size_t i = 0; i < transforms.size(); i++)
+			memcpy(&staging[i * transformStride], glm::value_ptr(transforms[i]), sizeof(glm::mat4));
+		arena.upload(transformHandle, staging.data(), transforms.size() * transformStride);
+	}
+
+	//back to glUniformMatrix4fv, giving the arena its space back
+	void releaseTransforms() {
+		if (uniforms)
+			uniforms->free(transformHandle);
+		uniforms = NULL;
+		transformHandle = BufferArena::INVALID_HANDLE;
+	}
+
+	void clear() {
+		commands.clear();
+		transforms.clear();
+	}
+
+	unsigned int addTransform(const glm::mat4& transform) {
+		transforms.push_back(transform);
+		return (unsigned int)transforms.size() - 1;
+	}
+
+	void push(const RenderCommand& command) {
+		commands.push_back(command);
+	}
+
+	//order the commands by key. Only the 16 byte (key, index) pairs are moved around.
+	void sort() {
+
+		size_t count = commands.size();
+		entries.resize(count);
+		scratch.resize(count);
+		for (size_t i = 0; i < count; i++) {
+			entries[i].key = commands[i].key;
+			entries[i].index = (unsigned int)i;
+		}
+
+		radixSort(entries, scratch);
+	}
+
+	void execute(GLStateCache& state) const {
+
+		for (const SortEntry& entry : entries) {
+
+			const RenderCommand& command = commands[entry.index];
+
+			state.useProgram(command.program);
+			if (command.texture)
+				state.bindTexture(0, GL_TEXTURE_2D, command.texture);
+			state.bindVertexArray(command.vertexArray);
+
+			if (uniforms)
+				state.bindBufferRange(GL_UNIFORM_BUFFER, OBJECT_BLOCK_BINDING, uniforms->getBuffer(),
+					uniforms->offsetOf(transformHandle) + command.transform * transformStride, sizeof(glm::mat4));
+			else if (command.modelLocation >= 0)
+				glUniformMatrix4fv(command.modelLocation, 1, GL_FALSE, glm::value_ptr(transforms[command.transform]));
+
+			if (command.indexed)
+				glDrawElementsBaseVertex(GL_TRIANGLES, command.count, GL_UNSIGNED_INT, (void*)(command.firstIndex * sizeof(unsigned int)), command.baseVertex);
+			else
+				glDrawArrays(GL_TRIANGLES, command.firstIndex, command.count);
+		}
+	}
+
+	//time the radix sort against std::sort on random keys; no GL needed
+	static void benchmarkSort(unsigned int count = 100000, unsigned int runs = 20) {
+
+		std::mt19937_64 random(1234);
+		std::vector<SortEntry> source(count), entries(count), scratch(count);
+		for (unsigned int i = 0; i < count; i++) {
+			source[i].key = RenderKey::opaque(random() & 3, random() & 31, random() & 255, random() & 63, (random() & 0xffff) / 65535.0f);
+			source[i].index = i;
+		}
+
+		double radixTime = 0.0, stdTime = 0.0;
+		for (unsigned int run = 0; run < runs; run++) {
+
+			entries = source;
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			radixSort(entries, scratch);
+			radixTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			std::vector<SortEntry> reference = source;
+			start = std::chrono::steady_clock::now();
+			std::stable_sort(reference.begin(), reference.end(), [](const SortEntry& a, const SortEntry& b) { return a.key < b.key; });
+			stdTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			for (unsigned int i = 0; i < count; i++) {
+				if (reference[i].index != entries[i].index) {
+					std::cout << "ERROR::RENDER_QUEUE::SORT_MISMATCH at " << i << std::endl;
+					return;
+				}
+			}
+		}
+
+		std::cout << "RENDER_QUEUE::BENCHMARK " << count << " commands"
+			<< ": radix sort " << radixTime / runs << " ms"
+			<< ", std::stable_sort " << stdTime / runs << " ms" << std::endl;
+	}
+
+private:
+
+	struct SortEntry {
+		uint64_t key;
+		unsigned int index;
+	};
+
+	std::vector<SortEntry> entries;
+	std::vector<SortEntry> scratch;
+
+	BufferArena* uniforms; //set by uploadTransforms()
+	unsigned int transformHandle;
+	size_t transformStride;
+	std::vector<unsigned char> staging;
+
+	//Stable LSD radix sort, 8 bits per pass. All histograms come from a single read of the keys,
+	//and passes where every key shares the same byte are skipped.
+	static void radixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch) {
+
+		size_t count = entries.size();
+		if (count < 2)
+			return;
+		scratch.resize(count);
+
+		size_t histograms[8][256] = {};
+		for (size_t i = 0; i < count; i++) {
+			uint64_t key = entries[i].key;
+			for (int pass = 0; pass < 8; pass++)
+				histograms[pass][(key >> (pass * 8)) & 0xff]++;
+		}
+
+		SortEntry* from = entries.data();
+		SortEntry* to = scratch.data();
+
+		for (int pass = 0; pass < 8; pass++) {
+
+			size_t* histogram = histograms[pass];
+			if (histogram[(from[0].key >> (pass * 8)) & 0xff] == count)
+				continue;
+
+			size_t offset = 0;
+			for (int bucket = 0; bucket < 256; bucket++) {
+				size_t size = histogram[bucket];
+				histogram[bucket] = offset;
+				offset += size;
+			}
+
+			for (size_t i = 0; i < count; i++)
+				to[histogram[(from[i].key >> (pass * 8)) & 0xff]++] = from[i];
+
+			std::swap(from, to);
+		}
+
+		if (from != entries.data())
+			std::copy(from, from + count, entries.data());
+	}
+};
+#endif
@@ -0,0 +1,351 @@
+#pragma once
+
+#ifndef STATIC_BATCH_H
+#define STATIC_BATCH_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
+#include "BufferArena.h"
+
+#include <vector>
+#include <iostream>
+
+
+//one attribute inside an interleaved vertex made of floats
+struct VertexAttribute {
+	unsigned int location;
+	int components;
+	int offset; //in floats from the start of the vertex
+};
+
+//layout of an interleaved float vertex. Meshes with equal formats can share a batch.
+struct VertexFormat {
+	int floatsPerVertex;
+	std::vector<VertexAttribute> attributes;
+	int positionOffset = 0;  //where the vec3 position lives, used when pre-transforming
+	int normalOffset = -1;   //where the vec3 normal lives, -1 if the format has none
+
+	bool operator==(const VertexFormat& other) const {
+		if (floatsPerVertex != other.floatsPerVertex || attributes.size() != other.attributes.size())
+			return false;
+		//addStaticMesh rewrites positions and normals where these say, so they are part of the layout
+		if (positionOffset != other.positionOffset || normalOffset != other.normalOffset)
+			return false;
+		for (size_t i = 0; i < attributes.size(); i++) {
+			if (attributes[i].location != other.attributes[i].location ||
+				attributes[i].components != other.attributes[i].components ||
+				attributes[i].offset != other.attributes[i].offset)
+				return false;
+		}
+		return true;
+	}
+};
+
+
+//Merges every mesh that shares a vertex format into one vertex and one index allocation
+//behind a single VAO. The allocations come from BufferArenas shared by all batches, so the
+//whole static scene lives in two GL buffers. Each mesh keeps its own index range and is drawn
+//with glDrawElementsBaseVertex, so its indices stay local to the mesh and no rebasing is
+//needed when meshes are appended. Meshes added after build() are appended by the next
+//build(); what was uploaded before stays.
+class StaticBatch {
+
+public:
+
+	//where a mesh lives inside the batch
+	struct Range {
+		unsigned int firstIndex;
+		int baseVertex;
+		unsigned int count;
+	};
+
+	VertexFormat format;
+	std::vector<Range> ranges; //relative to the batch's own allocations; getRange() is what GL needs
+
+	StaticBatch(const VertexFormat& vertexFormat)
+		: format(vertexFormat), VAO(0), vertexArena(NULL), indexArena(NULL),
+		  vertexHandle(BufferArena::INVALID_HANDLE), indexHandle(BufferArena::INVALID_HANDLE) {}
+
+	//append a mesh. indices may be NULL for non-indexed triangle lists. Returns the mesh index.
+	unsigned int addMesh(const float* meshVertices, unsigned int vertexCount, const unsigned int* meshIndices, unsigned int indexCount) {
+
+		Range range;
+		range.firstIndex = builtIndexCount + (unsigned int)indices.size();
+		range.baseVertex = (int)(builtVertexCount + vertices.size() / format.floatsPerVertex);
+
+		vertices.insert(vertices.end(), meshVertices, meshVertices + (size_t)vertexCount * format.floatsPerVertex);
+
+		if (meshIndices) {
+			indices.insert(indices.end(), meshIndices, meshIndices + indexCount);
+			range.count = indexCount;
+		}
+		else {
+			for (unsigned int i = 0; i < vertexCount; i++)
+				indices.push_back(i);
+			range.count = vertexCount;
+		}
+
+		ranges.push_back(range);
+		return (unsigned int)ranges.size() - 1;
+	}
+
+	//append a mesh that never moves, baking its model matrix into the vertices so it can be
+	//drawn without a per-mesh model uniform
+	unsigned int addStaticMesh(const float* meshVertices, unsigned int vertexCount, const unsigned int* meshIndices, unsigned int indexCount, const glm::mat4& model) {
+
+		size_t first = vertices.size();
+		unsigned int mesh = addMesh(meshVertices, vertexCount, meshIndices, indexCount);
+
+		glm::mat3 normalMatrix = glm::inverseTranspose(glm::mat3(model));
+
+		for (size_t v = first; v < vertices.size(); v += format.floatsPerVertex) {
+
+			float* p = &vertices[v + format.positionOffset];
+			glm::vec4 position = model * glm::vec4(p[0], p[1], p[2], 1.0f);
+			p[0] = position.x; p[1] = position.y; p[2] = position.z;
+
+			if (format.normalOffset >= 0) {
+				float* n = &vertices[v + format.normalOffset];
+				glm::vec3 normal = glm::normalize(normalMatrix * glm::vec3(n[0], n[1], n[2]));
+				n[0] = normal.x; n[1] = normal.y; n[2] = normal.z;
+			}
+		}
+		return mesh;
+	}
+
+	//append another index range over the vertices of an existing mesh, e.g. a simplified LOD.
+	//Returns the new range's mesh index.
+	unsigned int addIndexRange(unsigned int mesh, const unsigned int* meshIndices, unsigned int indexCount) {
+
+		Range range;
+		range.firstIndex = builtIndexCount + (unsigned int)indices.size();
+		range.baseVertex = ranges[mesh].baseVertex;
+		range.count = indexCount;
+
+		indices.insert(indices.end(), meshIndices, meshIndices + indexCount);
+
+		ranges.push_back(range);
+		return (unsigned int)ranges.size() - 1;
+	}
+
+	//Upload everything added since the last build into the arenas and set up the VAO. The CPU
+	//copies are dropped. A later build moves what is already on the GPU into larger allocations
+	//and appends behind it. The index arena's granularity must be a multiple of 4 so index
+	//allocations start on a whole index. Returns false, leaving the batch as it was, when either
+	//arena is full.
+	bool build(BufferArena& sharedVertices, BufferArena& sharedIndices) {
+
+		if (vertices.empty() && indices.empty())
+			return true;
+		if (vertexArena && (vertexArena != &sharedVertices || indexArena != &sharedIndices)) {
+			std::cout << "ERROR::STATIC_BATCH::ARENA_CHANGED a batch stays in the arenas it was first built in" << std::endl;
+			return false;
+		}
+
+		size_t oldVertexBytes = (size_t)builtVertexCount * format.floatsPerVertex * sizeof(float);
+		size_t oldIndexBytes = (size_t)builtIndexCount * sizeof(unsigned int);
+		size_t newVertexBytes = vertices.size() * sizeof(float);
+		size_t newIndexBytes = indices.size() * sizeof(unsigned int);
+
+		//both allocations first, so a full arena leaves nothing half moved
+		unsigned int grownVertices = vertexHandle, grownIndices = indexHandle;
+		if (newVertexBytes)
+			grownVertices = sharedVertices.allocate(oldVertexBytes + newVertexBytes);
+		if (newIndexBytes)
+			grownIndices = sharedIndices.allocate(oldIndexBytes + newIndexBytes);
+		if (grownVertices == BufferArena::INVALID_HANDLE || grownIndices == BufferArena::INVALID_HANDLE) {
+			if (grownVertices != vertexHandle)
+				sharedVertices.free(grownVertices);
+			if (grownIndices != indexHandle)
+				sharedIndices.free(grownIndices);
+			return false;
+		}
+
+		vertexArena = &sharedVertices;
+		indexArena = &sharedIndices;
+		vertexHandle = moveAndAppend(sharedVertices, vertexHandle, grownVertices, oldVertexBytes, vertices.data(), newVertexBytes);
+		indexHandle = moveAndAppend(sharedIndices, indexHandle, grownIndices, oldIndexBytes, indices.data(), newIndexBytes);
+
+		if (VAO == 0)
+			glGenVertexArrays(1, &VAO);
+		relink();
+
+		builtVertexCount += (unsigned int)(vertices.size() / format.floatsPerVertex);
+		builtIndexCount += (unsigned int)indices.size();
+
+		std::vector<float>().swap(vertices);
+		std::vector<unsigned int>().swap(indices);
+		return true;
+	}
+
+	//point the VAO at the current arena buffers and offsets; needed after either arena's
+	//defragment(). build() does it itself.
+	void relink() {
+
+		if (VAO == 0)
+			return;
+		glBindVertexArray(VAO);
+
+		glBindBuffer(GL_ARRAY_BUFFER, vertexArena->getBuffer());
+		GLsizei stride = format.floatsPerVertex * sizeof(float);
+		size_t base = getVertexByteOffset();
+		for (const VertexAttribute& attribute : format.attributes) {
+			glVertexAttribPointer(attribute.location, attribute.components, GL_FLOAT, GL_FALSE, stride, (void*)(base + attribute.offset * sizeof(float)));
+			glEnableVertexAttribArray(attribute.location);
+		}
+
+		//the element buffer binding is part of the VAO state
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexArena->getBuffer());
+
+		glBindVertexArray(0);
+	}
+
+	void bind() const {
+		glBindVertexArray(VAO);
+	}
+
+	//a mesh's range as GL sees it through this batch's VAO: firstIndex counts from the start of
+	//the index arena, baseVertex from the start of the batch's vertices. Changes when the batch is
+	//rebuilt or an arena defragmented.
+	Range getRange(unsigned int mesh) const {
+		Range range = ranges[mesh];
+		if (indexHandle != BufferArena::INVALID_HANDLE)
+			range.firstIndex += (unsigned int)(indexArena->offsetOf(indexHandle) / sizeof(unsigned int));
+		return range;
+	}
+
+	//draw one mesh. The batch must already be bound.
+	void draw(unsigned int mesh) const {
+		Range range = getRange(mesh);
+		glDrawElementsBaseVertex(GL_TRIANGLES, range.count, GL_UNSIGNED_INT, (void*)(range.firstIndex * sizeof(unsigned int)), range.baseVertex);
+	}
+
+	//draw every mesh in the batch with a single VAO bind
+	void drawAll() const {
+		bind();
+		for (unsigned int mesh = 0; mesh < ranges.size(); mesh++)
+			draw(mesh);
+	}
+
+	unsigned int getVAO() const { return VAO; }
+	unsigned int getVBO() const { return vertexArena ? vertexArena->getBuffer() : 0; } //the whole vertex arena
+	unsigned int getEBO() const { return indexArena ? indexArena->getBuffer() : 0; }   //the whole index arena
+	size_t getVertexByteOffset() const { return vertexHandle != BufferArena::INVALID_HANDLE ? vertexArena->offsetOf(vertexHandle) : 0; }
+	unsigned int getVertexCount() const { return builtVertexCount; }
+	unsigned int getIndexCount() const { return builtIndexCount; }
+
+	//GL objects are not released in a destructor because batches usually outlive the context.
+	//The space goes back to the arenas; the arenas themselves belong to the caller.
+	void destroy() {
+		glDeleteVertexArrays(1, &VAO);
+		VAO = 0;
+		if (vertexArena)
+			vertexArena->free(vertexHandle);
+		if (indexArena)
+			indexArena->free(indexHandle);
+		vertexHandle = indexHandle = BufferArena::INVALID_HANDLE;
+		builtVertexCount = builtIndexCount = 0;
+	}
+
+private:
+
+	unsigned int VAO;
+	BufferArena* vertexArena;
+	BufferArena* indexArena;
+	unsigned int vertexHandle;
+	unsigned int indexHandle;
+	unsigned int builtVertexCount = 0; //already on the GPU
+	unsigned int builtIndexCount = 0;
+
+	std::vector<float> vertices;        //added since the last build
+	std::vector<unsigned int> indices;
+
+	//copy the old contents into the grown allocation, free the old one and write the new data behind
+	static unsigned int moveAndAppend(BufferArena& arena, unsigned int oldHandle, unsigned int grownHandle, size_t oldBytes, const void* data, size_t bytes) {
+		if (grownHandle == oldHandle)
+			return oldHandle; //nothing new of this kind
+		if (oldHandle != BufferArena::INVALID_HANDLE) {
+			arena.copy(oldHandle, grownHandle, oldBytes);
+			arena.free(oldHandle);
+		}
+		arena.upload(grownHandle, data, bytes, oldBytes);
+		return grownHandle;
+	}
+};
+
+
+//handle to a mesh stored in a StaticBatchSet
+struct BatchedMesh {
+	unsigned int batch;
+	unsigned int mesh;
+};
+
+//Routes meshes to the StaticBatch matching their vertex format, so a whole static level
+//costs one VAO bind per distinct format and lives in the two arenas it is built into.
+class StaticBatchSet {
+
+public:
+
+	std::vector<StaticBatch> batches;
+
+	BatchedMesh addMesh(const VertexFormat& format, const float* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount) {
+		unsigned int batch = findBatch(format);
+		BatchedMesh handle = { batch, batches[batch].addMesh(vertices, vertexCount, indices, indexCount) };
+		return handle;
+	}
+
+	BatchedMesh addStaticMesh(const VertexFormat& format, const float* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount, const glm::mat4& model) {
+		unsigned int batch = findBatch(format);
+		BatchedMesh handle = { batch, batches[batch].addStaticMesh(vertices, vertexCount, indices, indexCount, model) };
+		return handle;
+	}
+
+	//another index range over an existing mesh's vertices, in the same batch
+	BatchedMesh addIndexRange(BatchedMesh mesh, const unsigned int* indices, unsigned int indexCount) {
+		BatchedMesh handle = { mesh.batch, batches[mesh.batch].addIndexRange(mesh.mesh, indices, indexCount) };
+		return handle;
+	}
+
+	//false when an arena ran out of space; the batches that fit are built
+	bool build(BufferArena& vertexArena, BufferArena& indexArena) {
+		bool built = true;
+		for (StaticBatch& batch : batches)
+			built = batch.build(vertexArena, indexArena) && built;
+		return built;
+	}
+
+	//after defragmenting either arena
+	void relink() {
+		for (StaticBatch& batch : batches)
+			batch.relink();
+	}
+
+	//bind the owning batch and draw one mesh
+	void draw(BatchedMesh handle) const {
+		batches[handle.batch].bind();
+		batches[handle.batch].draw(handle.mesh);
+	}
+
+	void drawAll() const {
+		for (const StaticBatch& batch : batches)
+			batch.drawAll();
+	}
+
+	void destroy() {
+		for (StaticBatch& batch : batches)
+			batch.destroy();
+	}
+
+private:
+
+	unsigned int findBatch(const VertexFormat& format) {
+		for (unsigned int i = 0; i < batches.size(); i++) {
+			if (batches[i].format == format)
+				return i;
+		}
+		batches.push_back(StaticBatch(format));
+		return (unsigned int)batches.size() - 1;
+	}
+};
+#endif
@@ -0,0 +1,203 @@
+#pragma once
+
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <glad/glad.h>
+#include "GLExtensions.h"
+
+#include <vector>
+#include <iostream>
+#include <chrono>
+
+
+//Ring buffer for geometry that is rewritten every frame (particles, debug lines, UI).
+//The buffer is split into one section per frame in flight and each section is protected
+//by a fence, so the CPU only ever writes memory the GPU has finished reading.
+//
+//With GL 4.4 / ARB_buffer_storage the whole buffer is mapped once, persistent and coherent,
+//and writes go straight to driver memory. Without it each section is mapped with
+//GL_MAP_UNSYNCHRONIZED_BIT, and if its fence has not signalled yet the buffer is orphaned
+//instead of waited on.
+//
+//Per frame: beginFrame(), allocate() and write, commit() before drawing, endFrame() after
+//the draws that read the section have been issued.
+class StreamBuffer {
+
+public:
+
+	struct Slice {
+		void* data;     //CPU pointer to write to, NULL if the section is full
+		size_t offset;  //byte offset in the GL buffer to source the data from
+	};
+
+	struct Stats {
+		size_t bytesWritten;    //this frame
+		unsigned int fenceWaits;
+		unsigned int orphans;
+		double waitMilliseconds;
+	};
+
+	StreamBuffer(GLenum bufferTarget, size_t bytesPerFrame, unsigned int framesInFlight = 3)
+		: target(bufferTarget), sectionSize(bytesPerFrame), sectionCount(framesInFlight), buffer(0),
+		  persistent(glExtensions().bufferStorage), mapped(NULL), fences(framesInFlight, (GLsync)0),
+		  section(0), head(0), mappedFrom(0) {
+
+		glGenBuffers(1, &buffer);
+		glBindBuffer(target, buffer);
+
+		if (persistent) {
+			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glExtensions().BufferStorage(target, sectionSize * sectionCount, NULL, flags);
+			mapped = (char*)glMapBufferRange(target, 0, sectionSize * sectionCount, flags);
+			if (!mapped) {
+				std::cout << "ERROR::STREAM_BUFFER::PERSISTENT_MAP_FAILED" << std::endl;
+				persistent = false;
+				glDeleteBuffers(1, &buffer);
+				glGenBuffers(1, &buffer);
+				glBindBuffer(target, buffer);
+			}
+		}
+		if (!persistent)
+			glBufferData(target, sectionSize * sectionCount, NULL, GL_STREAM_DRAW);
+
+		resetStats();
+	}
+
+	//move to the next section, making sure the GPU is done with it
+	void beginFrame() {
+
+		resetStats();
+		head = 0;
+
+		GLsync& fence = fences[section];
+		if (!fence)
+			return;
+
+		//an unsynchronized mapping can dodge the wait by orphaning the storage
+		if (!persistent && glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+			glBindBuffer(target, buffer);
+			glBufferData(target, sectionSize * sectionCount, NULL, GL_STREAM_DRAW);
+			for (unsigned int i = 0; i < sectionCount; i++) {
+				if (fences[i])
+					glDeleteSync(fences[i]);
+				fences[i] = 0;
+			}
+			stats.orphans++;
+			return;
+		}
+
+		waitForFence(fence);
+		glDeleteSync(fence);
+		fence = 0;
+	}
+
+	//bump-allocate bytes from this frame's section
+	Slice allocate(size_t bytes, size_t alignment = 16) {
+
+		Slice slice = { NULL, 0 };
+
+		size_t start = (head + alignment - 1) / alignment * alignment;
+		if (start + bytes > sectionSize) {
+			std::cout << "ERROR::STREAM_BUFFER::SECTION_FULL " << bytes << " bytes requested" << std::endl;
+			return slice;
+		}
+
+		if (!persistent && !mapped) {
+			glBindBuffer(target, buffer);
+			mappedFrom = start;
+			mapped = (char*)glMapBufferRange(target, sectionBase() + start, sectionSize - start,
+				GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+			if (!mapped)
+				return slice;
+		}
+
+		slice.offset = sectionBase() + start;
+		slice.data = persistent ? mapped + slice.offset : mapped + (start - mappedFrom);
+
+		head = start + bytes;
+		stats.bytesWritten += bytes;
+		return slice;
+	}
+
+	//make the writes so far visible to GL. Coherent persistent mappings need nothing.
+	void commit() {
+		if (!persistent && mapped) {
+			glBindBuffer(target, buffer);
+			glUnmapBuffer(target);
+			mapped = NULL;
+		}
+	}
+
+	//fence the section once every draw reading from it has been issued
+	void endFrame() {
+		commit();
+		fences[section] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		section = (section + 1) % sectionCount;
+	}
+
+	unsigned int getBuffer() const { return buffer; }
+	bool isPersistent() const { return persistent; }
+	size_t getSectionSize() const { return sectionSize; }
+	const Stats& getStats() const { return stats; }
+
+	void destroy() {
+		for (unsigned int i = 0; i < sectionCount; i++) {
+			if (fences[i])
+				glDeleteSync(fences[i]);
+		}
+		fences.assign(sectionCount, (GLsync)0);
+
+		if (mapped) {
+			glBindBuffer(target, buffer);
+			glUnmapBuffer(target);
+			mapped = NULL;
+		}
+		glDeleteBuffers(1, &buffer);
+		buffer = 0;
+	}
+
+private:
+
+	GLenum target;
+	size_t sectionSize;
+	unsigned int sectionCount;
+	unsigned int buffer;
+	bool persistent;
+
+	char* mapped;
+	std::vector<GLsync> fences; //one per section, 0 once waited on
+
+	unsigned int section;
+	size_t head;
+	size_t mappedFrom;
+
+	Stats stats;
+
+	size_t sectionBase() const {
+		return section * sectionSize;
+	}
+
+	void resetStats() {
+		stats.bytesWritten = 0;
+		stats.fenceWaits = 0;
+		stats.orphans = 0;
+		stats.waitMilliseconds = 0.0;
+	}
+
+	void waitForFence(GLsync fence) {
+
+		GLenum result = glClientWaitSync(fence, 0, 0);
+		if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED)
+			return;
+
+		//the GPU is a whole ring behind; block, flushing so the fence is guaranteed to arrive
+		stats.fenceWaits++;
+		std::chrono::steady_clock::time_point before = std::chrono::steady_clock::now();
+		do {
+			result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+		} while (result == GL_TIMEOUT_EXPIRED);
+		stats.waitMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - before).count();
+	}
+};
+#endif
@@ -0,0 +1,126 @@
+#pragma once
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <vector>
+#include <algorithm>
+
+
+//Persistent worker threads for data-parallel loops. parallelFor() hands out chunks of an
+//index range from an atomic counter; the calling thread works too and returns once every
+//chunk is done. Calls must not be nested.
+class ThreadPool {
+
+public:
+
+	//body(begin, end, threadIndex), threadIndex 0 being the calling thread
+	typedef std::function<void(unsigned int, unsigned int, unsigned int)> RangeFunction;
+
+	//threadCount includes the calling thread, 0 picks one per hardware thread
+	ThreadPool(unsigned int threadCount = 0) : job(NULL), count(0), grain(1), next(0), generation(0), busy(0), stopping(false) {
+
+		if (threadCount == 0)
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+		for (unsigned int i = 1; i < threadCount; i++)
+			workers.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+	}
+
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (std::thread& worker : workers)
+			worker.join();
+	}
+
+	unsigned int getThreadCount() const {
+		return (unsigned int)workers.size() + 1;
+	}
+
+	void parallelFor(unsigned int itemCount, unsigned int chunkSize, const RangeFunction& body) {
+
+		if (itemCount == 0)
+			return;
+		chunkSize = std::max(chunkSize, 1u);
+
+		//not worth waking anyone up
+		if (workers.empty() || itemCount <= chunkSize) {
+			body(0, itemCount, 0);
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			job = &body;
+			count = itemCount;
+			grain = chunkSize;
+			next = 0;
+			busy = (unsigned int)workers.size();
+			generation++;
+		}
+		wake.notify_all();
+
+		runChunks(0);
+
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [this] { return busy == 0; });
+		job = NULL;
+	}
+
+private:
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+
+	const RangeFunction* job;
+	unsigned int count;
+	unsigned int grain;
+	std::atomic<unsigned int> next;
+	unsigned int generation;
+	unsigned int busy;
+	bool stopping;
+
+	void runChunks(unsigned int threadIndex) {
+		unsigned int begin;
+		while ((begin = next.fetch_add(grain)) < count)
+			(*job)(begin, std::min(begin + grain, count), threadIndex);
+	}
+
+	void workerLoop(unsigned int threadIndex) {
+
+		unsigned int seen = 0;
+		for (;;) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [this, seen] { return stopping || generation != seen; });
+				if (stopping)
+					return;
+				seen = generation;
+			}
+
+			runChunks(threadIndex);
+
+			std::lock_guard<std::mutex> lock(mutex);
+			if (--busy == 0)
+				done.notify_one();
+		}
+	}
+};
+
+//shared pool for the engine systems that want one
+inline ThreadPool& defaultThreadPool() {
+	static ThreadPool pool;
+	return pool;
+}
+#endif
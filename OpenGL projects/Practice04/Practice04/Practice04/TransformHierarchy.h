@@ -0,0 +1,238 @@
+#pragma once
+
+#ifndef TRANSFORM_HIERARCHY_H
+#define TRANSFORM_HIERARCHY_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "ThreadPool.h"
+
+#include <vector>
+#include <algorithm>
+
+
+//Parent/child transforms with cached world matrices.
+//
+//Nodes are stored per depth level in structure-of-arrays form, and each level is kept sorted
+//by parent so a node's children are one contiguous range of the next level. Setting a local
+//transform only queues the node; update() then walks the levels top down and recomputes just
+//the queued nodes and the subtrees below them, each level in parallel. Nodes that did not move
+//cost nothing, so the work follows the number of changes rather than the size of the scene.
+class TransformHierarchy {
+
+public:
+
+	typedef unsigned int Node;
+	static const Node NONE = 0xffffffff;
+
+	TransformHierarchy() : frame(1), structureChanged(false) {}
+
+	Node create(Node parent = NONE, const glm::vec3& position = glm::vec3(0.0f), const glm::quat& rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f), const glm::vec3& scale = glm::vec3(1.0f)) {
+
+		unsigned int depth = parent == NONE ? 0 : locations[parent].level + 1;
+		if (levels.size() <= depth)
+			levels.resize(depth + 1);
+		Level& level = levels[depth];
+
+		Node node = (Node)locations.size();
+		Location location = { depth, (unsigned int)level.node.size() };
+		locations.push_back(location);
+
+		level.positionX.push_back(position.x); level.positionY.push_back(position.y); level.positionZ.push_back(position.z);
+		level.rotationX.push_back(rotation.x); level.rotationY.push_back(rotation.y); level.rotationZ.push_back(rotation.z); level.rotationW.push_back(rotation.w);
+		level.scaleX.push_back(scale.x); level.scaleY.push_back(scale.y); level.scaleZ.push_back(scale.z);
+		level.parent.push_back(depth > 0 ? locations[parent].slot : 0xffffffff);
+		level.firstChild.push_back(0);
+		level.childCount.push_back(0);
+		level.world.push_back(glm::mat4(1.0f));
+		level.node.push_back(node);
+		level.queuedFrame.push_back(0);
+
+		structureChanged = true;
+		markDirty(node);
+		return node;
+	}
+
+	void setPosition(Node node, const glm::vec3& position) {
+		Level& level = levels[locations[node].level];
+		unsigned int slot = locations[node].slot;
+		level.positionX[slot] = position.x; level.positionY[slot] = position.y; level.positionZ[slot] = position.z;
+		markDirty(node);
+	}
+
+	void setRotation(Node node, const glm::quat& rotation) {
+		Level& level = levels[locations[node].level];
+		unsigned int slot = locations[node].slot;
+		level.rotationX[slot] = rotation.x; level.rotationY[slot] = rotation.y; level.rotationZ[slot] = rotation.z; level.rotationW[slot] = rotation.w;
+		markDirty(node);
+	}
+
+	void setScale(Node node, const glm::vec3& scale) {
+		Level& level = levels[locations[node].level];
+		unsigned int slot = locations[node].slot;
+		level.scaleX[slot] = scale.x; level.scaleY[slot] = scale.y; level.scaleZ[slot] = scale.z;
+		markDirty(node);
+	}
+
+	//world matrix as of the last update()
+	const glm::mat4& world(Node node) const {
+		return levels[locations[node].level].world[locations[node].slot];
+	}
+
+	//nodes whose world matrix was recomputed by the last update()
+	unsigned int getUpdatedCount() const { return updatedCount; }
+
+	void update(ThreadPool* pool = NULL) {
+
+		if (structureChanged)
+			sortLevels();
+
+		updatedCount = 0;
+		for (unsigned int depth = 0; depth < levels.size(); depth++) {
+
+			Level& level = levels[depth];
+
+			//children of everything recomputed on the level above join this level's queue
+			if (depth > 0) {
+				const Level& above = levels[depth - 1];
+				for (unsigned int parentSlot : above.updated) {
+					for (unsigned int c = 0; c < above.childCount[parentSlot]; c++)
+						queue(level, above.firstChild[parentSlot] + c);
+				}
+			}
+
+			std::vector<unsigned int>& work = level.dirty;
+			const Level* parentLevel = depth > 0 ? &levels[depth - 1] : NULL;
+
+			ThreadPool::RangeFunction compute = [&](unsigned int begin, unsigned int end, unsigned int) {
+				for (unsigned int i = begin; i < end; i++) {
+					unsigned int slot = work[i];
+					glm::mat4 local = localMatrix(level, slot);
+					level.world[slot] = parentLevel ? parentLevel->world[level.parent[slot]] * local : local;
+				}
+			};
+			if (pool)
+				pool->parallelFor((unsigned int)work.size(), 1024, compute);
+			else
+				compute(0, (unsigned int)work.size(), 0);
+
+			updatedCount += (unsigned int)work.size();
+			level.updated.swap(work);
+			work.clear();
+		}
+
+		for (Level& level : levels)
+			level.updated.clear();
+		frame++;
+	}
+
+private:
+
+	struct Location {
+		unsigned int level;
+		unsigned int slot;
+	};
+
+	struct Level {
+		std::vector<float> positionX, positionY, positionZ;
+		std::vector<float> rotationX, rotationY, rotationZ, rotationW;
+		std::vector<float> scaleX, scaleY, scaleZ;
+		std::vector<unsigned int> parent;     //slot on the level above
+		std::vector<unsigned int> firstChild; //slot on the level below
+		std::vector<unsigned int> childCount;
+		std::vector<glm::mat4> world;
+		std::vector<Node> node;               //slot -> handle
+		std::vector<unsigned int> queuedFrame;
+
+		std::vector<unsigned int> dirty;      //slots waiting for the next update
+		std::vector<unsigned int> updated;    //slots recomputed by the current update
+	};
+
+	std::vector<Level> levels;
+	std::vector<Location> locations; //handle -> slot
+	unsigned int frame;
+	unsigned int updatedCount = 0;
+	bool structureChanged;
+
+	void markDirty(Node node) {
+		queue(levels[locations[node].level], locations[node].slot);
+	}
+
+	void queue(Level& level, unsigned int slot) {
+		if (level.queuedFrame[slot] == frame)
+			return;
+		level.queuedFrame[slot] = frame;
+		level.dirty.push_back(slot);
+	}
+
+	static glm::mat4 localMatrix(const Level& level, unsigned int slot) {
+		glm::quat rotation(level.rotationW[slot], level.rotationX[slot], level.rotationY[slot], level.rotationZ[slot]);
+		glm::mat4 local = glm::mat4_cast(rotation);
+		local[0] *= level.scaleX[slot];
+		local[1] *= level.scaleY[slot];
+		local[2] *= level.scaleZ[slot];
+		local[3] = glm::vec4(level.positionX[slot], level.positionY[slot], level.positionZ[slot], 1.0f);
+		return local;
+	}
+
+	template<typename T>
+	static void permute(std::vector<T>& items, const std::vector<unsigned int>& order) {
+		std::vector<T> sorted(items.size());
+		for (size_t i = 0; i < order.size(); i++)
+			sorted[i] = items[order[i]];
+		items.swap(sorted);
+	}
+
+	//Reorder every level by parent slot so siblings sit together, then rebuild the child ranges
+	//and every slot reference. Only runs after nodes were created.
+	void sortLevels() {
+
+		for (unsigned int depth = 0; depth < levels.size(); depth++) {
+
+			Level& level = levels[depth];
+			unsigned int count = (unsigned int)level.node.size();
+
+			std::vector<unsigned int> order(count);
+			for (unsigned int i = 0; i < count; i++)
+				order[i] = i;
+			if (depth > 0)
+				std::stable_sort(order.begin(), order.end(), [&level](unsigned int a, unsigned int b) { return level.parent[a] < level.parent[b]; });
+
+			std::vector<unsigned int> newSlot(count);
+			for (unsigned int i = 0; i < count; i++)
+				newSlot[order[i]] = i;
+
+			permute(level.positionX, order); permute(level.positionY, order); permute(level.positionZ, order);
+			permute(level.rotationX, order); permute(level.rotationY, order); permute(level.rotationZ, order); permute(level.rotationW, order);
+			permute(level.scaleX, order); permute(level.scaleY, order); permute(level.scaleZ, order);
+			permute(level.parent, order);
+			permute(level.world, order);
+			permute(level.node, order);
+			permute(level.queuedFrame, order);
+
+			for (unsigned int& slot : level.dirty)
+				slot = newSlot[slot];
+			for (unsigned int i = 0; i < count; i++)
+				locations[level.node[i]].slot = i;
+
+			//children on the level below still point at the old slots
+			if (depth + 1 < levels.size()) {
+				for (unsigned int& parent : levels[depth + 1].parent)
+					parent = newSlot[parent];
+			}
+
+			//siblings are contiguous now, so record each parent's range
+			if (depth > 0) {
+				Level& above = levels[depth - 1];
+				std::fill(above.childCount.begin(), above.childCount.end(), 0);
+				for (unsigned int i = 0; i < count; i++) {
+					unsigned int parent = level.parent[i];
+					if (above.childCount[parent]++ == 0)
+						above.firstChild[parent] = i;
+				}
+			}
+		}
+		structureChanged = false;
+	}
+};
+#endif
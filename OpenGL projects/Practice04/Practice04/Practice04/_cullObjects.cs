@@ -0,0 +1,52 @@
+#version 430 core
+
+layout (local_size_x = 64) in;
+
+struct ObjectData {
+   mat4 model;
+   vec4 sphere;  //object space bounding sphere, xyz center, w radius
+   uvec4 draw;   //first index, index count, base vertex, unused
+};
+
+//matches DrawElementsIndirectCommand, 20 bytes under std430
+struct DrawCommand {
+   uint count;
+   uint instanceCount;
+   uint firstIndex;
+   int baseVertex;
+   uint baseInstance;
+};
+
+layout (std430, binding = 0) readonly buffer Objects {
+   ObjectData objects[];
+};
+
+layout (std430, binding = 1) writeonly buffer Commands {
+   DrawCommand commands[];
+};
+
+uniform vec4 planes[6]; //world space frustum planes, pointing inwards
+uniform uint objectCount;
+
+//One invocation per object. Every object keeps its command slot; culled ones just draw zero instances.
+void main()
+{
+   uint i = gl_GlobalInvocationID.x;
+   if (i >= objectCount)
+      return;
+
+   ObjectData object = objects[i];
+   vec3 center = (object.model * vec4(object.sphere.xyz, 1.0)).xyz;
+   float scale = max(length(object.model[0].xyz), max(length(object.model[1].xyz), length(object.model[2].xyz)));
+   float radius = object.sphere.w * scale;
+
+   bool visible = true;
+   for (int p = 0; p < 6; p++)
+      visible = visible && dot(planes[p].xyz, center) + planes[p].w >= -radius;
+
+   commands[i].count = object.draw.y;
+   commands[i].instanceCount = visible ? 1u : 0u;
+   commands[i].firstIndex = object.draw.x;
+   commands[i].baseVertex = int(object.draw.z);
+   commands[i].baseInstance = i;
+}
@@ -0,0 +1,23 @@
+#version 430 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 7) in uint aObject; //per instance; the draw's baseInstance picks the object
+
+struct ObjectData {
+   mat4 model;
+   vec4 sphere;  //object space bounding sphere, xyz center, w radius
+   uvec4 draw;   //first index, index count, base vertex, unused
+};
+
+layout (std430, binding = 0) readonly buffer Objects {
+   ObjectData objects[];
+};
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+   gl_Position = projection * view * objects[aObject].model * vec4(aPos, 1.0);
+   
+}
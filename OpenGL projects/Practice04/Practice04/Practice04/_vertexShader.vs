@@ -2,7 +2,10 @@
 
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 model;
+//per object, one slot of RenderQueue's uniform arena bound to binding point 0
+layout (std140) uniform ObjectBlock {
+   mat4 model;
+};
 uniform mat4 view;
 uniform mat4 projection;
 